@@ -0,0 +1,40 @@
+#include <stdlib.h>
+#include "ins_allocator.h"
+#include "ins_file_format.h"
+
+static void* ins_default_allocate(void* ctx, size_t size) {
+  (void)ctx;
+  return malloc(size);
+}
+
+static void* ins_default_reallocate(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+  (void)ctx;
+  (void)old_size;
+  return realloc(ptr, new_size);
+}
+
+static void ins_default_release(void* ctx, void* ptr) {
+  (void)ctx;
+  free(ptr);
+}
+
+const InsAllocatorType kInsDefaultAllocator = {
+  ins_default_allocate,
+  ins_default_reallocate,
+  ins_default_release,
+  NULL
+};
+
+int ins_vector_grow(const InsAllocatorType* allocator, void** items, int32_t* capacity, size_t item_size, int32_t required) {
+  int32_t new_capacity = *capacity ? *capacity * 2 : 16;
+  if (new_capacity < required)
+    new_capacity = required;
+
+  void* new_items = ins_reallocate(allocator, *items, item_size * (size_t)*capacity, item_size * (size_t)new_capacity);
+  if (!new_items)
+    return kInsFileErrorNoMemory;
+
+  *items = new_items;
+  *capacity = new_capacity;
+  return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef INS_ALLOCATOR_HEADER
+#define INS_ALLOCATOR_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Memory allocator used by library functions, library does not call malloc directly */
+typedef struct _InsAllocatorType {
+  void* (*allocate)(void* ctx, size_t size);                                   /** Allocate block, NULL on fail */
+  void* (*reallocate)(void* ctx, void* ptr, size_t old_size, size_t new_size); /** Resize block, ptr may be NULL */
+  void (*release)(void* ctx, void* ptr);                                       /** Free block, ptr may be NULL */
+  void* ctx;                                                                   /** Allocator context */
+} InsAllocatorType;
+
+/** Allocator over malloc/realloc/free */
+extern const InsAllocatorType kInsDefaultAllocator;
+
+#define ins_allocate(allocator, size)  ((allocator)->allocate((allocator)->ctx, (size)))
+#define ins_reallocate(allocator, ptr, old_size, new_size)  ((allocator)->reallocate((allocator)->ctx, (ptr), (old_size), (new_size)))
+#define ins_release(allocator, ptr)  ((allocator)->release((allocator)->ctx, (ptr)))
+
+/**
+ * \brief    Grow vector_t storage so it holds at least required items. Capacity grows geometrically,
+ *           so reserving space for one item before each push is amortized O(1)
+ * \param    allocator   [in]      Allocator of vector storage
+ * \param    items       [in,out]  Vector items pointer
+ * \param    capacity    [in,out]  Vector capacity
+ * \param    item_size   [in]      Item size
+ * \param    required    [in]      Required capacity
+ * \return   0 - success, kInsFileErrorNoMemory - allocation failed, vector is not changed
+ */
+int ins_vector_grow(const InsAllocatorType* allocator, void** items, int32_t* capacity, size_t item_size, int32_t required);
+
+/** Make sure vector_t has space for count more items. Evaluates to 0 - success, negative - allocation failed */
+#define ins_vector_reserve(type, allocator, v, count) \
+  (((v)->n + (count) > (v)->m) ? ins_vector_grow((allocator), (void**)&(v)->a, &(v)->m, sizeof(type), (v)->n + (count)) : 0)
+
+/** Free vector_t storage allocated by ins_vector_reserve */
+#define ins_vector_destroy(allocator, v)  ins_release((allocator), (v)->a)
+
+#endif  // INS_ALLOCATOR_HEADER
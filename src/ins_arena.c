@@ -0,0 +1,130 @@
+#include <string.h>
+#include "ins_arena.h"
+
+struct _InsArenaBlockType {
+  InsArenaBlockType* previous;               /** Previous block, NULL for first block */
+  size_t size;                               /** Data size, data follows header */
+};
+
+#define kInsArenaBlockHeaderSize  ((sizeof(InsArenaBlockType) + kInsArenaAlignment - 1) & ~(size_t)(kInsArenaAlignment - 1))
+#define ins_arena_align(size)  (((size) + kInsArenaAlignment - 1) & ~(size_t)(kInsArenaAlignment - 1))
+#define ins_arena_block_data(block)  ((uint8_t*)(block) + kInsArenaBlockHeaderSize)
+
+static int ins_arena_add_block(InsArenaType* arena, size_t min_size) {
+  size_t size = arena->next_block_size;
+  while (size < min_size)
+    size *= 2;
+
+  InsArenaBlockType* block = (InsArenaBlockType*)ins_allocate(arena->backing, kInsArenaBlockHeaderSize + size);
+  if (!block)
+    return -1;
+
+  block->previous = arena->block;
+  block->size = size;
+
+  /* unused tail of previous block is counted as used, so high-water covers one block of all data */
+  if (arena->block)
+    arena->used += arena->block->size - arena->block_used;
+
+  arena->block = block;
+  arena->block_used = 0;
+  arena->next_block_size = size * 2;
+  arena->block_allocations++;
+
+  return 0;
+}
+
+static void* ins_arena_allocate(void* ctx, size_t size) {
+  InsArenaType* arena = (InsArenaType*)ctx;
+  size = ins_arena_align(size ? size : 1);
+
+  if (!arena->block || arena->block->size - arena->block_used < size) {
+    if (ins_arena_add_block(arena, size) < 0)
+      return NULL;
+  }
+
+  uint8_t* ptr = ins_arena_block_data(arena->block) + arena->block_used;
+  arena->block_used += size;
+  arena->used += size;
+
+  if (arena->used > arena->high_water)
+    arena->high_water = arena->used;
+
+  arena->last_allocation = ptr;
+  return ptr;
+}
+
+static void* ins_arena_reallocate(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+  InsArenaType* arena = (InsArenaType*)ctx;
+
+  if (!ptr)
+    return ins_arena_allocate(ctx, new_size);
+
+  /* last allocation grows in place when block has space */
+  if ((uint8_t*)ptr == arena->last_allocation) {
+    size_t old_aligned = ins_arena_align(old_size ? old_size : 1);
+    size_t new_aligned = ins_arena_align(new_size ? new_size : 1);
+
+    if (new_aligned <= old_aligned || arena->block->size - arena->block_used >= new_aligned - old_aligned) {
+      arena->block_used = arena->block_used - old_aligned + new_aligned;
+      arena->used = arena->used - old_aligned + new_aligned;
+
+      if (arena->used > arena->high_water)
+        arena->high_water = arena->used;
+
+      return ptr;
+    }
+  }
+
+  void* new_ptr = ins_arena_allocate(ctx, new_size);
+  if (new_ptr)
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+
+  return new_ptr;
+}
+
+static void ins_arena_release(void* ctx, void* ptr) {
+  /* memory is released by ins_arena_reset */
+  (void)ctx;
+  (void)ptr;
+}
+
+void ins_arena_init(InsArenaType* arena, size_t initial_size, const InsAllocatorType* backing) {
+  memset(arena, 0, sizeof(*arena));
+  arena->next_block_size = ins_arena_align(initial_size ? initial_size : 4096);
+  arena->backing = backing;
+
+  arena->allocator.allocate = ins_arena_allocate;
+  arena->allocator.reallocate = ins_arena_reallocate;
+  arena->allocator.release = ins_arena_release;
+  arena->allocator.ctx = arena;
+}
+
+static void ins_arena_free_blocks(InsArenaType* arena) {
+  while (arena->block) {
+    InsArenaBlockType* previous = arena->block->previous;
+    ins_release(arena->backing, arena->block);
+    arena->block = previous;
+  }
+}
+
+void ins_arena_destroy(InsArenaType* arena) {
+  ins_arena_free_blocks(arena);
+  arena->block_used = 0;
+  arena->used = 0;
+  arena->last_allocation = NULL;
+}
+
+void ins_arena_reset(InsArenaType* arena) {
+  arena->block_used = 0;
+  arena->used = 0;
+  arena->last_allocation = NULL;
+
+  if (!arena->block || !arena->block->previous)
+    return;
+
+  /* file did not fit in one block: replace blocks with one block of high-water size */
+  ins_arena_free_blocks(arena);
+  arena->next_block_size = ins_arena_align(arena->high_water);
+  ins_arena_add_block(arena, 0);
+}
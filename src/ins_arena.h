@@ -0,0 +1,55 @@
+#ifndef INS_ARENA_HEADER
+#define INS_ARENA_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+
+// Bump-pointer arena for per-file allocations. One arena belongs to one worker thread and is reset
+// between files. After reset the arena keeps one block large enough for the biggest file seen so far,
+// so in steady state processing a file does not call backing allocator at all.
+
+#define kInsArenaAlignment  16
+
+typedef struct _InsArenaBlockType InsArenaBlockType;
+
+/** Arena state */
+typedef struct _InsArenaType {
+  InsArenaBlockType* block;                  /** Current block, previous blocks are linked from it */
+  size_t block_used;                         /** Used bytes in current block */
+  size_t used;                               /** Used bytes in all blocks since last reset */
+  size_t high_water;                         /** Max used bytes between resets */
+  uint8_t* last_allocation;                  /** Last allocated block, may be resized or released in place */
+  size_t next_block_size;                    /** Size of next block allocated from backing allocator */
+  int64_t block_allocations;                 /** Blocks allocated from backing allocator */
+  const InsAllocatorType* backing;           /** Allocator for arena blocks */
+  InsAllocatorType allocator;                /** Allocator interface backed by this arena */
+} InsArenaType;
+
+/**
+ * \brief    Initialize arena, first block is allocated on first use
+ * \param    arena          [out] Arena
+ * \param    initial_size   [in]  First block size
+ * \param    backing        [in]  Allocator of arena blocks
+ */
+void ins_arena_init(InsArenaType* arena, size_t initial_size, const InsAllocatorType* backing);
+
+/**
+ * \brief    Free all arena blocks
+ * \param    arena   [in]  Arena
+ */
+void ins_arena_destroy(InsArenaType* arena);
+
+/**
+ * \brief    Release all allocations at once. O(1) when previous file fit in one block, otherwise blocks
+ *           are replaced by one block of high-water size
+ * \param    arena   [in]  Arena
+ */
+void ins_arena_reset(InsArenaType* arena);
+
+/** Allocator interface for library functions, valid while arena exists */
+static inline const InsAllocatorType* ins_arena_allocator(const InsArenaType* arena) {
+  return &arena->allocator;
+}
+
+#endif  // INS_ARENA_HEADER
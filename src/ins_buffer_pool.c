@@ -0,0 +1,124 @@
+#include <string.h>
+#include "ins_buffer_pool.h"
+
+#define kInsHugePageSize  (2*1024*1024)
+
+void ins_buffer_pool_init(InsBufferPoolType* pool, size_t buffer_size, int huge_pages) {
+  memset(pool, 0, sizeof(*pool));
+
+  if (huge_pages)
+    buffer_size = (buffer_size + kInsHugePageSize - 1) & ~(size_t)(kInsHugePageSize - 1);
+
+  pool->buffer_size = buffer_size;
+  pool->huge_pages = huge_pages;
+  ins_mutex_init(&pool->mutex);
+}
+
+void ins_buffer_pool_destroy(InsBufferPoolType* pool) {
+  while (pool->free_list) {
+    void* next;
+    memcpy(&next, pool->free_list, sizeof(next));
+    ins_free_pages(pool->free_list, pool->buffer_size);
+    pool->free_list = next;
+  }
+
+  ins_mutex_destroy(&pool->mutex);
+}
+
+static void* ins_buffer_pool_acquire(InsBufferPoolType* pool) {
+  ins_mutex_lock(&pool->mutex);
+
+  void* buffer = pool->free_list;
+  if (buffer) {
+    memcpy(&pool->free_list, buffer, sizeof(void*));
+    pool->hits++;
+  } else {
+    pool->misses++;
+  }
+
+  ins_mutex_unlock(&pool->mutex);
+
+  if (buffer)
+    return buffer;
+
+  /* page allocation is slow, do it outside lock */
+  int is_huge = 0;
+  buffer = ins_alloc_pages(pool->buffer_size, pool->huge_pages, &is_huge);
+
+  if (buffer) {
+    ins_mutex_lock(&pool->mutex);
+    pool->buffers_count++;
+    pool->huge_buffers_count += is_huge;
+    ins_mutex_unlock(&pool->mutex);
+  }
+
+  return buffer;
+}
+
+static void ins_buffer_pool_release(InsBufferPoolType* pool, void* buffer) {
+  ins_mutex_lock(&pool->mutex);
+  memcpy(buffer, &pool->free_list, sizeof(void*));
+  pool->free_list = buffer;
+  ins_mutex_unlock(&pool->mutex);
+}
+
+static void* ins_buffer_cache_allocate(void* ctx, size_t size) {
+  InsBufferCacheType* cache = (InsBufferCacheType*)ctx;
+  return size <= cache->pool->buffer_size ? ins_buffer_cache_acquire(cache) : NULL;
+}
+
+static void* ins_buffer_cache_reallocate(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+  InsBufferCacheType* cache = (InsBufferCacheType*)ctx;
+  (void)old_size;
+
+  if (new_size > cache->pool->buffer_size)
+    return NULL;
+
+  return ptr ? ptr : ins_buffer_cache_acquire(cache);
+}
+
+static void ins_buffer_cache_free(void* ctx, void* ptr) {
+  ins_buffer_cache_release((InsBufferCacheType*)ctx, ptr);
+}
+
+void ins_buffer_cache_init(InsBufferCacheType* cache, InsBufferPoolType* pool) {
+  memset(cache, 0, sizeof(*cache));
+  cache->pool = pool;
+
+  cache->allocator.allocate = ins_buffer_cache_allocate;
+  cache->allocator.reallocate = ins_buffer_cache_reallocate;
+  cache->allocator.release = ins_buffer_cache_free;
+  cache->allocator.ctx = cache;
+}
+
+void ins_buffer_cache_destroy(InsBufferCacheType* cache) {
+  while (cache->count > 0)
+    ins_buffer_pool_release(cache->pool, cache->buffers[--cache->count]);
+
+  ins_mutex_lock(&cache->pool->mutex);
+  cache->pool->hits += cache->hits;
+  ins_mutex_unlock(&cache->pool->mutex);
+
+  cache->hits = 0;
+}
+
+void* ins_buffer_cache_acquire(InsBufferCacheType* cache) {
+  if (cache->count > 0) {
+    cache->hits++;
+    return cache->buffers[--cache->count];
+  }
+
+  return ins_buffer_pool_acquire(cache->pool);
+}
+
+void ins_buffer_cache_release(InsBufferCacheType* cache, void* buffer) {
+  if (!buffer)
+    return;
+
+  if (cache->count < kInsBufferCacheSize) {
+    cache->buffers[cache->count++] = buffer;
+    return;
+  }
+
+  ins_buffer_pool_release(cache->pool, buffer);
+}
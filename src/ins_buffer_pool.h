@@ -0,0 +1,82 @@
+#ifndef INS_BUFFER_POOL_HEADER
+#define INS_BUFFER_POOL_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+#include "ins_platform.h"
+
+// Pool of large page-aligned I/O buffers shared by workers. Each worker checks buffers out through its own
+// cache, so pool lock is taken only when cache is empty or full. Buffers are returned to OS when pool
+// is destroyed only.
+
+#define kInsBufferCacheSize  4 /* Buffers kept by one worker cache */
+
+/** Buffer pool, shared by all workers */
+typedef struct _InsBufferPoolType {
+  size_t buffer_size;                        /** Buffer size, rounded to 2 MiB when huge pages are used */
+  int huge_pages;                            /** Try huge pages for new buffers */
+  InsMutexType mutex;                        /** Protects free list and counters */
+  void* free_list;                           /** Free buffers, next pointer is stored in buffer */
+  int64_t hits;                              /** Checkouts served without new buffer allocation */
+  int64_t misses;                            /** Checkouts which allocated new buffer */
+  int32_t buffers_count;                     /** Buffers allocated from OS */
+  int32_t huge_buffers_count;                /** Buffers backed by explicit huge pages */
+} InsBufferPoolType;
+
+/** Per-worker buffer cache, used by one thread only */
+typedef struct _InsBufferCacheType {
+  InsBufferPoolType* pool;                   /** Pool */
+  void* buffers[kInsBufferCacheSize];        /** Cached buffers */
+  int count;                                 /** Cached buffers count */
+  int64_t hits;                              /** Checkouts served from this cache, added to pool on destroy */
+  InsAllocatorType allocator;                /** Allocator interface for I/O buffers, see ins_buffer_cache_allocator */
+} InsBufferCacheType;
+
+/**
+ * \brief    Initialize empty pool
+ * \param    pool          [out] Pool
+ * \param    buffer_size   [in]  Buffer size
+ * \param    huge_pages    [in]  Non-zero - back buffers with huge pages where available
+ */
+void ins_buffer_pool_init(InsBufferPoolType* pool, size_t buffer_size, int huge_pages);
+
+/**
+ * \brief    Free all pool buffers, all caches must be destroyed before
+ * \param    pool   [in]  Pool
+ */
+void ins_buffer_pool_destroy(InsBufferPoolType* pool);
+
+/**
+ * \brief    Initialize worker cache
+ * \param    cache   [out] Cache
+ * \param    pool    [in]  Pool
+ */
+void ins_buffer_cache_init(InsBufferCacheType* cache, InsBufferPoolType* pool);
+
+/**
+ * \brief    Return cached buffers to pool and add cache counters to pool counters
+ * \param    cache   [in]  Cache
+ */
+void ins_buffer_cache_destroy(InsBufferCacheType* cache);
+
+/**
+ * \brief    Check out buffer of pool buffer size
+ * \param    cache   [in]  Worker cache
+ * \return   Buffer, NULL when OS cannot allocate new buffer
+ */
+void* ins_buffer_cache_acquire(InsBufferCacheType* cache);
+
+/**
+ * \brief    Return buffer checked out by ins_buffer_cache_acquire (by any cache of the same pool)
+ * \param    cache    [in]  Worker cache
+ * \param    buffer   [in]  Buffer, may be NULL
+ */
+void ins_buffer_cache_release(InsBufferCacheType* cache, void* buffer);
+
+/** Allocator interface for I/O buffers (for example ins_copy_file_region), serves requests up to buffer size */
+static inline const InsAllocatorType* ins_buffer_cache_allocator(const InsBufferCacheType* cache) {
+  return &cache->allocator;
+}
+
+#endif  // INS_BUFFER_POOL_HEADER
@@ -0,0 +1,237 @@
+#include <string.h>
+#include <ctype.h>
+#include "ins_calibration.h"
+#include "ins_file.h"
+#include "ins_hash.h"
+
+#define kInsCalibrationMaxFields  4
+
+void ins_calibration_table_init(InsCalibrationTableType* table, const InsAllocatorType* allocator) {
+  vector_init(&table->entries);
+  table->buckets = NULL;
+  table->buckets_count = 0;
+  table->text = NULL;
+  table->allocator = allocator;
+}
+
+void ins_calibration_table_destroy(InsCalibrationTableType* table) {
+  ins_vector_destroy(table->allocator, &table->entries);
+  ins_release(table->allocator, table->buckets);
+  ins_release(table->allocator, table->text);
+  ins_calibration_table_init(table, table->allocator);
+}
+
+/* cut next CSV field in place: unquote, trim spaces and zero-terminate. Cursor moves after separator */
+static char* ins_csv_next_field(char** cursor, char* end, int* out_line_end) {
+  char* p = *cursor;
+
+  while (p < end && (*p == ' ' || *p == '\t'))
+    p++;
+
+  char* field = p;
+  char* w = p;
+
+  if (p < end && *p == '"') {
+    for (p++; p < end; ) {
+      if (*p == '"') {
+        if (p + 1 < end && p[1] == '"') {
+          *w++ = '"';
+          p += 2;
+          continue;
+        }
+        p++;
+        break;
+      }
+      *w++ = *p++;
+    }
+  }
+
+  while (p < end && *p != ',' && *p != '\n')
+    *w++ = *p++;
+
+  *out_line_end = p >= end || *p == '\n';
+  *cursor = p < end ? p + 1 : end;
+
+  while (w > field && (w[-1] == '\r' || w[-1] == ' ' || w[-1] == '\t'))
+    w--;
+  *w = 0;
+
+  return field;
+}
+
+static int ins_is_header_field(const char* field) {
+  const char* header = "serial";
+
+  for (; *header; field++, header++) {
+    if (tolower((unsigned char)*field) != *header)
+      return 0;
+  }
+  return *field == 0;
+}
+
+static uint64_t ins_calibration_hash(const char* serial) {
+  return ins_fnv1a_update(kInsFnvOffsetBasis, serial, strlen(serial));
+}
+
+/* build hash chains, report duplicated lines */
+static int ins_calibration_table_index(InsCalibrationTableType* table, int* out_error_line) {
+  uint32_t buckets_count = 16;
+  while (buckets_count < (uint32_t)vector_size(&table->entries) * 2)
+    buckets_count *= 2;
+
+  table->buckets = (int32_t*)ins_allocate(table->allocator, buckets_count * sizeof(int32_t));
+  if (!table->buckets)
+    return kInsFileErrorNoMemory;
+
+  table->buckets_count = buckets_count;
+  memset(table->buckets, 0xFF, buckets_count * sizeof(int32_t));
+
+  /* entries are linked in reverse order, so chain keeps table order */
+  for (int32_t i = vector_size(&table->entries) - 1; i >= 0; i--) {
+    InsCalibrationEntryType* entry = &vector_at(&table->entries, i);
+    int32_t* bucket = &table->buckets[ins_calibration_hash(entry->serial) & (buckets_count - 1)];
+
+    for (int32_t j = *bucket; j >= 0; j = vector_at(&table->entries, j).next) {
+      const InsCalibrationEntryType* other = &vector_at(&table->entries, j);
+
+      if (!strcmp(other->serial, entry->serial) && !strcmp(other->model, entry->model) && !strcmp(other->firmware, entry->firmware)) {
+        if (out_error_line)
+          *out_error_line = other->line;
+        return kInsFileErrorInvalidArgument;
+      }
+    }
+
+    entry->next = *bucket;
+    *bucket = i;
+  }
+
+  return 0;
+}
+
+static int ins_calibration_table_parse(InsCalibrationTableType* table, char* text, char* end, int* out_error_line) {
+  char* cursor = text;
+  int line = 0;
+
+  while (cursor < end) {
+    char* fields[kInsCalibrationMaxFields];
+    int fields_count = 0;
+    int line_end = 0;
+
+    line++;
+
+    if (*cursor == '#') {
+      char* next = (char*)memchr(cursor, '\n', (size_t)(end - cursor));
+      cursor = next ? next + 1 : end;
+      continue;
+    }
+
+    while (!line_end) {
+      char* field = ins_csv_next_field(&cursor, end, &line_end);
+
+      if (fields_count == kInsCalibrationMaxFields) {
+        if (out_error_line)
+          *out_error_line = line;
+        return kInsFileErrorInvalidArgument;
+      }
+      fields[fields_count++] = field;
+    }
+
+    if (fields_count == 1 && !fields[0][0])
+      continue; /* empty line */
+
+    if (!vector_size(&table->entries) && ins_is_header_field(fields[0]))
+      continue; /* header before first calibration */
+
+    InsCalibrationEntryType entry;
+    const char* offset;
+
+    if (fields_count == 2) {
+      entry.model = entry.firmware = "";
+      offset = fields[1];
+    } else if (fields_count == 4) {
+      entry.model = fields[1];
+      entry.firmware = fields[2];
+      offset = fields[3];
+    } else {
+      offset = NULL;
+    }
+
+    entry.serial = fields[0];
+    entry.line = line;
+    entry.next = -1;
+
+    if (!offset || !entry.serial[0] ||
+        ins_parse_stitching_offset(offset, strlen(offset), &entry.offset) < 0 ||
+        ins_validate_stitching_offset(&entry.offset) < 0) {
+      if (out_error_line)
+        *out_error_line = line;
+      return kInsFileErrorInvalidArgument;
+    }
+
+    if (ins_vector_reserve(InsCalibrationEntryType, table->allocator, &table->entries, 1) < 0)
+      return kInsFileErrorNoMemory;
+    table->entries.a[table->entries.n++] = entry;
+  }
+
+  return 0;
+}
+
+int ins_calibration_table_load(InsCalibrationTableType* table, FILE* file, int* out_error_line) {
+  int64_t size = ins_get_file_size(file);
+
+  if (size < 0 || ins_fseek64(file, 0, SEEK_SET))
+    return kInsFileErrorIo;
+
+  /* fields are zero-terminated in place, one byte more for last field */
+  table->text = (char*)ins_allocate(table->allocator, (size_t)size + 1);
+  if (!table->text)
+    return kInsFileErrorNoMemory;
+
+  if (fread(table->text, 1, (size_t)size, file) != (size_t)size)
+    return kInsFileErrorIo;
+
+  int result = ins_calibration_table_parse(table, table->text, table->text + size, out_error_line);
+  if (result < 0)
+    return result;
+
+  result = ins_calibration_table_index(table, out_error_line);
+  if (result < 0)
+    return result;
+
+  return vector_size(&table->entries);
+}
+
+const InsCalibrationEntryType* ins_calibration_table_find(
+  const InsCalibrationTableType* table,
+  const char* serial,
+  const char* model,
+  const char* firmware) {
+
+  const InsCalibrationEntryType* best = NULL;
+  int best_score = -1;
+
+  if (!table->buckets_count)
+    return NULL;
+
+  int32_t index = table->buckets[ins_calibration_hash(serial) & (table->buckets_count - 1)];
+
+  for (; index >= 0; index = vector_at(&table->entries, index).next) {
+    const InsCalibrationEntryType* entry = &vector_at(&table->entries, index);
+
+    if (strcmp(entry->serial, serial))
+      continue;
+    if (entry->model[0] && strcmp(entry->model, model))
+      continue;
+    if (entry->firmware[0] && strcmp(entry->firmware, firmware))
+      continue;
+
+    /* chain keeps table order, so first line wins among equally specific */
+    int score = (entry->model[0] != 0) + (entry->firmware[0] != 0);
+    if (score > best_score) {
+      best = entry;
+      best_score = score;
+    }
+  }
+
+  return best;
+}
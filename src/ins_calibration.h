@@ -0,0 +1,69 @@
+#ifndef INS_CALIBRATION_HEADER
+#define INS_CALIBRATION_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "c_vector.h"
+#include "ins_allocator.h"
+#include "ins_stitching_offset.h"
+
+// Calibration table: camera serial (optionally model and firmware) mapped to stitching offset.
+// Table is CSV text (as exported from spreadsheet), one calibration per line:
+//   serial,offset
+//   serial,model,firmware,offset          empty model or firmware matches any value
+// Empty lines, lines starting with '#' and header line with first field "serial" are skipped.
+// Fields may be quoted, quote inside quoted field is doubled (RFC 4180).
+//
+// Lookup takes the most specific matching line: serial+model+firmware, then serial with model or firmware,
+// then serial only. When two lines are equally specific, the first line in table wins.
+
+/** Calibration table line */
+typedef struct _InsCalibrationEntryType {
+  const char* serial;                        /** Camera serial number */
+  const char* model;                         /** Camera model, empty - any */
+  const char* firmware;                      /** Firmware version, empty - any */
+  InsStitchingOffsetType offset;             /** Parsed and validated stitching offset */
+  int32_t next;                              /** Next entry in hash chain, -1 - last */
+  int line;                                  /** Line number in table text, from 1 */
+} InsCalibrationEntryType;
+
+typedef vector_t(InsCalibrationEntryType) InsCalibrationEntryVector;
+
+/** Calibration table, hash map by serial */
+typedef struct _InsCalibrationTableType {
+  InsCalibrationEntryVector entries;         /** Table lines */
+  int32_t* buckets;                          /** First entry index of each hash chain, -1 - empty chain */
+  uint32_t buckets_count;                    /** Hash chains count, power of two */
+  char* text;                                /** Table text, entry strings point into it */
+  const InsAllocatorType* allocator;         /** Allocator of entries, buckets and text */
+} InsCalibrationTableType;
+
+void ins_calibration_table_init(InsCalibrationTableType* table, const InsAllocatorType* allocator);
+void ins_calibration_table_destroy(InsCalibrationTableType* table);
+
+/**
+ * \brief    Load calibration table from CSV file. Offsets are parsed and validated, so wrong line is reported
+ *           before any media file is changed
+ * \param    table            [in,out] Table initialized by ins_calibration_table_init, must be empty
+ * \param    file             [in]  CSV file handle
+ * \param    out_error_line   [out] Function saves number of wrong line on kInsFileErrorInvalidArgument, may be NULL
+ * \return   Loaded lines count - success, kInsFileErrorInvalidArgument - wrong field count, wrong offset or
+ *           duplicated line, kInsFileErrorIo, kInsFileErrorNoMemory
+ */
+int ins_calibration_table_load(InsCalibrationTableType* table, FILE* file, int* out_error_line);
+
+/**
+ * \brief    Find calibration for camera
+ * \param    table      [in]  Calibration table
+ * \param    serial     [in]  Serial number from specific header (0x0A tag)
+ * \param    model      [in]  Camera model (0x12 tag)
+ * \param    firmware   [in]  Firmware version (0x1A tag)
+ * \return   Most specific matching entry, NULL - camera not found
+ */
+const InsCalibrationEntryType* ins_calibration_table_find(
+  const InsCalibrationTableType* table,
+  const char* serial,
+  const char* model,
+  const char* firmware);
+
+#endif  // INS_CALIBRATION_HEADER
@@ -0,0 +1,233 @@
+#include <string.h>
+#include "ins_columnar.h"
+#include "ins_file.h"
+#include "ins_trailer_streams.h"
+
+static const InsColumnFieldType kInsImuFields[] = {
+  { "imu.timecode",        kInsColumnValueUInt64, 8, 0  },
+  { "imu.accel_x",         kInsColumnValueDouble, 8, 8  },
+  { "imu.accel_y",         kInsColumnValueDouble, 8, 16 },
+  { "imu.accel_z",         kInsColumnValueDouble, 8, 24 },
+  { "imu.gyro_x",          kInsColumnValueDouble, 8, 32 },
+  { "imu.gyro_y",          kInsColumnValueDouble, 8, 40 },
+  { "imu.gyro_z",          kInsColumnValueDouble, 8, 48 }
+};
+
+static const InsColumnFieldType kInsExposureFields[] = {
+  { "exposure.timecode",   kInsColumnValueUInt64, 8, 0 },
+  { "exposure.exposure",   kInsColumnValueDouble, 8, 8 }
+};
+
+static const InsColumnFieldType kInsTimestampFields[] = {
+  { "timestamps.timestamp", kInsColumnValueUInt64, 8, 0 }
+};
+
+static const InsColumnFieldType kInsGpsFields[] = {
+  { "gps.unix_time",       kInsColumnValueUInt32, 4, 0  },
+  { "gps.unknown_4",       kInsColumnValueUInt32, 4, 4  },
+  { "gps.unknown_8",       kInsColumnValueUInt16, 2, 8  },
+  { "gps.fix",             kInsColumnValueUInt8,  1, 10 },
+  { "gps.latitude",        kInsColumnValueDouble, 8, 11 },
+  { "gps.latitude_ref",    kInsColumnValueUInt8,  1, 19 },
+  { "gps.longitude",       kInsColumnValueDouble, 8, 20 },
+  { "gps.longitude_ref",   kInsColumnValueUInt8,  1, 28 },
+  { "gps.speed",           kInsColumnValueDouble, 8, 29 },
+  { "gps.track",           kInsColumnValueDouble, 8, 37 },
+  { "gps.altitude",        kInsColumnValueDouble, 8, 45 }
+};
+
+#define INS_COLUMN_FIELDS(fields)  (int)(sizeof(fields) / sizeof(fields[0])), fields
+
+const InsColumnStreamType kInsColumnStreams[kInsColumnStreamsCount] = {
+  { kInsTrailerEntryTypeImu,         kInsImuRecordSize,        INS_COLUMN_FIELDS(kInsImuFields) },
+  { kInsTrailerEntryTypeExposure,    kInsExposureRecordSize,   INS_COLUMN_FIELDS(kInsExposureFields) },
+  { kInsTrailerEntryTypeTimestamps,  kInsTimestampRecordSize,  INS_COLUMN_FIELDS(kInsTimestampFields) },
+  { kInsTrailerEntryTypeGps,         kInsGpsRecordSize,        INS_COLUMN_FIELDS(kInsGpsFields) }
+};
+
+#define ins_column_align(offset)  (((offset) + kInsColumnAlignment - 1) & ~(uint64_t)(kInsColumnAlignment - 1))
+
+/* copy one field of each record to packed column array, records are not aligned */
+static void ins_gather_column(const uint8_t* records, uint32_t record_size, uint32_t count, const InsColumnFieldType* field, uint8_t* out) {
+  const uint8_t* src = records + field->record_offset;
+
+  /* constant memcpy sizes are compiled to single loads */
+  switch (field->value_size) {
+  case 8:
+    for (uint32_t i = 0; i < count; i++, src += record_size)
+      memcpy(out + (size_t)i * 8, src, 8);
+    break;
+  case 4:
+    for (uint32_t i = 0; i < count; i++, src += record_size)
+      memcpy(out + (size_t)i * 4, src, 4);
+    break;
+  case 2:
+    for (uint32_t i = 0; i < count; i++, src += record_size)
+      memcpy(out + (size_t)i * 2, src, 2);
+    break;
+  default:
+    for (uint32_t i = 0; i < count; i++, src += record_size)
+      out[i] = *src;
+    break;
+  }
+}
+
+static int ins_write_at(FILE* file_out, uint64_t offset, const void* data, size_t size) {
+  if (ins_fseek64(file_out, (int64_t)offset, SEEK_SET))
+    return kInsFileErrorIo;
+
+  return fwrite(data, 1, size, file_out) == size ? 0 : kInsFileErrorIo;
+}
+
+/* read stream entry by chunks and append records to stream columns */
+static int ins_export_entry_columns(
+  FILE* file,
+  const InsTrailerEntryLocationType* location,
+  const InsColumnStreamType* stream,
+  InsColumnDescType* columns,
+  uint64_t first_row,
+  uint8_t* records_chunk,
+  uint8_t* column_chunk,
+  FILE* file_out) {
+
+  uint32_t records_count = location->length / stream->record_size;
+
+  for (uint32_t done = 0; done < records_count; ) {
+    uint32_t count = records_count - done;
+    if (count > kInsColumnChunkRecords)
+      count = kInsColumnChunkRecords;
+
+    size_t chunk_size = (size_t)count * stream->record_size;
+
+    if (ins_fseek64(file, location->file_offset + (int64_t)done * stream->record_size, SEEK_SET) ||
+        fread(records_chunk, 1, chunk_size, file) != chunk_size)
+      return kInsFileErrorIo;
+
+    for (int i = 0; i < stream->fields_count; i++) {
+      const InsColumnFieldType* field = &stream->fields[i];
+      uint64_t row = first_row + done;
+
+      ins_gather_column(records_chunk, stream->record_size, count, field, column_chunk);
+
+      int result = ins_write_at(file_out, columns[i].data_offset + row * field->value_size, column_chunk, (size_t)count * field->value_size);
+      if (result < 0)
+        return result;
+    }
+
+    done += count;
+  }
+
+  return 0;
+}
+
+int ins_export_columns(FILE* file, uint32_t types_mask, FILE* file_out, const InsAllocatorType* allocator) {
+  InsTrailerReadPlanType plan;
+  InsColumnFileHeaderType header;
+  InsColumnDescType columns[kInsColumnMaxCount];
+  uint64_t stream_rows[kInsColumnStreamsCount];
+  int stream_first_column[kInsColumnStreamsCount];
+  uint8_t* records_chunk = NULL;
+  uint8_t* column_chunk = NULL;
+  uint32_t max_record_size = 0;
+  int columns_count = 0;
+
+  /* entry headers are enough, data is read by chunks below */
+  ins_trailer_read_plan_init(&plan, allocator);
+
+  int result = ins_plan_trailer_reads(file, 0, &plan);
+
+  const InsTrailerEntryLocationType* begin = ins_small_vector_begin(&plan.entries);
+  const InsTrailerEntryLocationType* end = ins_small_vector_end(&plan.entries);
+
+  for (int s = 0; s < kInsColumnStreamsCount; s++) {
+    stream_rows[s] = 0;
+    stream_first_column[s] = -1;
+  }
+
+  for (int s = 0; s < kInsColumnStreamsCount && !result; s++) {
+    const InsColumnStreamType* stream = &kInsColumnStreams[s];
+
+    if (!(types_mask & kInsTrailerEntryTypeBit(stream->entry_type)))
+      continue;
+
+    for (const InsTrailerEntryLocationType* location = begin; location != end && !result; location++) {
+      if (location->type != stream->entry_type)
+        continue;
+
+      if (location->length % stream->record_size)
+        result = kInsFileErrorCorrupted;
+      else
+        stream_rows[s] += location->length / stream->record_size;
+    }
+
+    if (result || !stream_rows[s])
+      continue;
+
+    stream_first_column[s] = columns_count;
+    if (stream->record_size > max_record_size)
+      max_record_size = stream->record_size;
+
+    for (int i = 0; i < stream->fields_count; i++) {
+      const InsColumnFieldType* field = &stream->fields[i];
+      InsColumnDescType* column = &columns[columns_count++];
+
+      memset(column, 0, sizeof(*column));
+      strncpy(column->name, field->name, kInsColumnNameLength - 1);
+      column->entry_type = stream->entry_type;
+      column->value_type = field->value_type;
+      column->value_size = field->value_size;
+      column->rows_count = stream_rows[s];
+      column->data_size = stream_rows[s] * field->value_size;
+    }
+  }
+
+  if (!result) {
+    /* columns follow descriptions, each column is aligned */
+    uint64_t data_offset = ins_column_align(sizeof(header) + (uint64_t)columns_count * sizeof(InsColumnDescType));
+    for (int i = 0; i < columns_count; i++) {
+      columns[i].data_offset = data_offset;
+      data_offset = ins_column_align(data_offset + columns[i].data_size);
+    }
+
+    memcpy(header.magic, kInsColumnFileMagic, kInsColumnFileMagicLength);
+    header.version = kInsColumnFileVersion;
+    header.columns_count = (uint32_t)columns_count;
+
+    result = ins_write_at(file_out, 0, &header, sizeof(header));
+  }
+
+  if (!result)
+    result = ins_write_at(file_out, sizeof(header), columns, (size_t)columns_count * sizeof(InsColumnDescType));
+
+  /* file without time-series entries gets header only */
+  if (!result && columns_count) {
+    records_chunk = (uint8_t*)ins_allocate(allocator, (size_t)kInsColumnChunkRecords * max_record_size);
+    column_chunk = (uint8_t*)ins_allocate(allocator, (size_t)kInsColumnChunkRecords * sizeof(uint64_t));
+    if (!records_chunk || !column_chunk)
+      result = kInsFileErrorNoMemory;
+  }
+
+  for (int s = 0; s < kInsColumnStreamsCount && !result; s++) {
+    if (stream_first_column[s] < 0)
+      continue;
+
+    uint64_t row = 0;
+
+    /* plan lists entries from file end, records are appended in file order */
+    for (const InsTrailerEntryLocationType* location = end; location != begin && !result; ) {
+      location--;
+      if (location->type != kInsColumnStreams[s].entry_type)
+        continue;
+
+      result = ins_export_entry_columns(file, location, &kInsColumnStreams[s], columns + stream_first_column[s], row,
+        records_chunk, column_chunk, file_out);
+
+      row += location->length / kInsColumnStreams[s].record_size;
+    }
+  }
+
+  ins_release(allocator, column_chunk);
+  ins_release(allocator, records_chunk);
+  ins_trailer_read_plan_destroy(&plan);
+  return result < 0 ? result : columns_count;
+}
@@ -0,0 +1,97 @@
+#ifndef INS_COLUMNAR_HEADER
+#define INS_COLUMNAR_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+#include "ins_file_format.h"
+
+// Columnar export of time-series trailer entries (0x300 IMU, 0x400 exposure, 0x600 timestamps, 0x700 GPS).
+// Each record field becomes column: packed array of raw little endian values, so file can be memory mapped
+// and columns used as arrays without parsing (numpy.memmap, Arrow buffers, etc). Values are not converted,
+// export is lossless.
+//
+// Columnar file structure (little endian)
+// 0         InsColumnFileHeaderType   (16 bytes)   magic "INSCOL01", format version, columns count
+// 16        InsColumnDescType         (64 bytes)   column 0 description
+// 80        InsColumnDescType         (64 bytes)   column 1 description
+// .........................
+// XXX       column data, each column starts at kInsColumnAlignment boundary, gaps are zero filled
+//
+// Column name is "<stream>.<field>", for example "imu.gyro_x", "gps.latitude". When trailer contains several
+// entries of one type, their records are concatenated in file order.
+
+#define kInsColumnFileMagic        "INSCOL01"
+#define kInsColumnFileMagicLength  8
+#define kInsColumnFileVersion      1
+#define kInsColumnNameLength       32
+#define kInsColumnAlignment        64   /* Cache line, enough for any SIMD load of column data */
+#define kInsColumnMaxCount         32
+#define kInsColumnChunkRecords     4096 /* Records decoded per read, bounds export memory */
+
+#pragma pack(push,1)
+
+/** Columnar file header */
+typedef struct _InsColumnFileHeaderType {
+  char magic[kInsColumnFileMagicLength];     /** kInsColumnFileMagic, not zero-terminated */
+  uint32_t version;                          /** kInsColumnFileVersion */
+  uint32_t columns_count;                    /** Column descriptions count */
+} InsColumnFileHeaderType;
+
+/** Column description */
+typedef struct _InsColumnDescType {
+  char name[kInsColumnNameLength];           /** Zero padded column name */
+  uint16_t entry_type;                       /** Source trailer entry type (0x300, 0x400, ...) */
+  uint8_t value_type;                        /** Value type, value from enum InsColumnValueTypes */
+  uint8_t value_size;                        /** Value size in bytes */
+  uint32_t reserved;                         /** Zero */
+  uint64_t rows_count;                       /** Values count */
+  uint64_t data_offset;                      /** Column data offset from file start */
+  uint64_t data_size;                        /** Column data size, rows_count * value_size */
+} InsColumnDescType;
+
+#pragma pack(pop)
+
+/** Column value types */
+enum InsColumnValueTypes {
+  kInsColumnValueUInt8                         = 1,
+  kInsColumnValueUInt16                        = 2,
+  kInsColumnValueUInt32                        = 3,
+  kInsColumnValueUInt64                        = 4,
+  kInsColumnValueDouble                        = 5
+};
+
+/** Record field exported as column */
+typedef struct _InsColumnFieldType {
+  const char* name;                          /** Column name */
+  uint8_t value_type;                        /** Value type, value from enum InsColumnValueTypes */
+  uint8_t value_size;                        /** Value size in bytes */
+  uint8_t record_offset;                     /** Field offset in record */
+} InsColumnFieldType;
+
+/** Exportable stream: trailer entry with fixed size records */
+typedef struct _InsColumnStreamType {
+  uint16_t entry_type;                       /** Trailer entry type */
+  uint32_t record_size;                      /** Record size */
+  int fields_count;                          /** Record fields count */
+  const InsColumnFieldType* fields;          /** Record fields */
+} InsColumnStreamType;
+
+#define kInsColumnStreamsCount  4
+
+/** Exportable streams: 0x300, 0x400, 0x600, 0x700 */
+extern const InsColumnStreamType kInsColumnStreams[kInsColumnStreamsCount];
+
+/**
+ * \brief    Export time-series entries of Insta360 file to columnar file. Entry data is read by chunks of
+ *           kInsColumnChunkRecords records and scattered to columns, so memory use does not depend on entry size
+ * \param    file         [in]  Input file handle
+ * \param    types_mask   [in]  Exported entry types, see kInsTrailerEntryTypeBit. Streams missing in file are skipped
+ * \param    file_out     [in]  Output file, must be seekable, columnar file is written from file start
+ * \param    allocator    [in]  Allocator of chunk buffers and read plan
+ * \return   Written columns count - success, kInsFileErrorCorrupted - entry size is not multiple of record size,
+ *           other negative - error code
+ */
+int ins_export_columns(FILE* file, uint32_t types_mask, FILE* file_out, const InsAllocatorType* allocator);
+
+#endif  // INS_COLUMNAR_HEADER
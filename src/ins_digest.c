@@ -0,0 +1,277 @@
+#include <string.h>
+#include "ins_digest.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define INS_DIGEST_X86_CRC32C
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define INS_TARGET_SSE42
+#else
+#include <cpuid.h>
+#define INS_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#define INS_DIGEST_ARM_CRC32C
+#include <arm_acle.h>
+#endif
+
+/** CRC-32C table, reflected polynomial 0x82F63B78 */
+static const uint32_t kInsCrc32cTable[256] = {
+  0x00000000, 0xF26B8303, 0xE13B70F7, 0x1350F3F4, 0xC79A971F, 0x35F1141C,
+  0x26A1E7E8, 0xD4CA64EB, 0x8AD958CF, 0x78B2DBCC, 0x6BE22838, 0x9989AB3B,
+  0x4D43CFD0, 0xBF284CD3, 0xAC78BF27, 0x5E133C24, 0x105EC76F, 0xE235446C,
+  0xF165B798, 0x030E349B, 0xD7C45070, 0x25AFD373, 0x36FF2087, 0xC494A384,
+  0x9A879FA0, 0x68EC1CA3, 0x7BBCEF57, 0x89D76C54, 0x5D1D08BF, 0xAF768BBC,
+  0xBC267848, 0x4E4DFB4B, 0x20BD8EDE, 0xD2D60DDD, 0xC186FE29, 0x33ED7D2A,
+  0xE72719C1, 0x154C9AC2, 0x061C6936, 0xF477EA35, 0xAA64D611, 0x580F5512,
+  0x4B5FA6E6, 0xB93425E5, 0x6DFE410E, 0x9F95C20D, 0x8CC531F9, 0x7EAEB2FA,
+  0x30E349B1, 0xC288CAB2, 0xD1D83946, 0x23B3BA45, 0xF779DEAE, 0x05125DAD,
+  0x1642AE59, 0xE4292D5A, 0xBA3A117E, 0x4851927D, 0x5B016189, 0xA96AE28A,
+  0x7DA08661, 0x8FCB0562, 0x9C9BF696, 0x6EF07595, 0x417B1DBC, 0xB3109EBF,
+  0xA0406D4B, 0x522BEE48, 0x86E18AA3, 0x748A09A0, 0x67DAFA54, 0x95B17957,
+  0xCBA24573, 0x39C9C670, 0x2A993584, 0xD8F2B687, 0x0C38D26C, 0xFE53516F,
+  0xED03A29B, 0x1F682198, 0x5125DAD3, 0xA34E59D0, 0xB01EAA24, 0x42752927,
+  0x96BF4DCC, 0x64D4CECF, 0x77843D3B, 0x85EFBE38, 0xDBFC821C, 0x2997011F,
+  0x3AC7F2EB, 0xC8AC71E8, 0x1C661503, 0xEE0D9600, 0xFD5D65F4, 0x0F36E6F7,
+  0x61C69362, 0x93AD1061, 0x80FDE395, 0x72966096, 0xA65C047D, 0x5437877E,
+  0x4767748A, 0xB50CF789, 0xEB1FCBAD, 0x197448AE, 0x0A24BB5A, 0xF84F3859,
+  0x2C855CB2, 0xDEEEDFB1, 0xCDBE2C45, 0x3FD5AF46, 0x7198540D, 0x83F3D70E,
+  0x90A324FA, 0x62C8A7F9, 0xB602C312, 0x44694011, 0x5739B3E5, 0xA55230E6,
+  0xFB410CC2, 0x092A8FC1, 0x1A7A7C35, 0xE811FF36, 0x3CDB9BDD, 0xCEB018DE,
+  0xDDE0EB2A, 0x2F8B6829, 0x82F63B78, 0x709DB87B, 0x63CD4B8F, 0x91A6C88C,
+  0x456CAC67, 0xB7072F64, 0xA457DC90, 0x563C5F93, 0x082F63B7, 0xFA44E0B4,
+  0xE9141340, 0x1B7F9043, 0xCFB5F4A8, 0x3DDE77AB, 0x2E8E845F, 0xDCE5075C,
+  0x92A8FC17, 0x60C37F14, 0x73938CE0, 0x81F80FE3, 0x55326B08, 0xA759E80B,
+  0xB4091BFF, 0x466298FC, 0x1871A4D8, 0xEA1A27DB, 0xF94AD42F, 0x0B21572C,
+  0xDFEB33C7, 0x2D80B0C4, 0x3ED04330, 0xCCBBC033, 0xA24BB5A6, 0x502036A5,
+  0x4370C551, 0xB11B4652, 0x65D122B9, 0x97BAA1BA, 0x84EA524E, 0x7681D14D,
+  0x2892ED69, 0xDAF96E6A, 0xC9A99D9E, 0x3BC21E9D, 0xEF087A76, 0x1D63F975,
+  0x0E330A81, 0xFC588982, 0xB21572C9, 0x407EF1CA, 0x532E023E, 0xA145813D,
+  0x758FE5D6, 0x87E466D5, 0x94B49521, 0x66DF1622, 0x38CC2A06, 0xCAA7A905,
+  0xD9F75AF1, 0x2B9CD9F2, 0xFF56BD19, 0x0D3D3E1A, 0x1E6DCDEE, 0xEC064EED,
+  0xC38D26C4, 0x31E6A5C7, 0x22B65633, 0xD0DDD530, 0x0417B1DB, 0xF67C32D8,
+  0xE52CC12C, 0x1747422F, 0x49547E0B, 0xBB3FFD08, 0xA86F0EFC, 0x5A048DFF,
+  0x8ECEE914, 0x7CA56A17, 0x6FF599E3, 0x9D9E1AE0, 0xD3D3E1AB, 0x21B862A8,
+  0x32E8915C, 0xC083125F, 0x144976B4, 0xE622F5B7, 0xF5720643, 0x07198540,
+  0x590AB964, 0xAB613A67, 0xB831C993, 0x4A5A4A90, 0x9E902E7B, 0x6CFBAD78,
+  0x7FAB5E8C, 0x8DC0DD8F, 0xE330A81A, 0x115B2B19, 0x020BD8ED, 0xF0605BEE,
+  0x24AA3F05, 0xD6C1BC06, 0xC5914FF2, 0x37FACCF1, 0x69E9F0D5, 0x9B8273D6,
+  0x88D28022, 0x7AB90321, 0xAE7367CA, 0x5C18E4C9, 0x4F48173D, 0xBD23943E,
+  0xF36E6F75, 0x0105EC76, 0x12551F82, 0xE03E9C81, 0x34F4F86A, 0xC69F7B69,
+  0xD5CF889D, 0x27A40B9E, 0x79B737BA, 0x8BDCB4B9, 0x988C474D, 0x6AE7C44E,
+  0xBE2DA0A5, 0x4C4623A6, 0x5F16D052, 0xAD7D5351
+};
+
+static uint32_t ins_crc32c_table(uint32_t crc, const uint8_t* data, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    crc = kInsCrc32cTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+#ifdef INS_DIGEST_X86_CRC32C
+INS_TARGET_SSE42 static uint32_t ins_crc32c_sse42(uint32_t crc, const uint8_t* data, size_t size) {
+  uint64_t crc64 = crc;
+
+  for (; size && ((uintptr_t)data & 7); size--)
+    crc64 = _mm_crc32_u8((uint32_t)crc64, *data++);
+
+  for (; size >= 8; size -= 8, data += 8) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    crc64 = _mm_crc32_u64(crc64, value);
+  }
+
+  for (; size; size--)
+    crc64 = _mm_crc32_u8((uint32_t)crc64, *data++);
+
+  return (uint32_t)crc64;
+}
+
+/** CPUID leaf 1, ECX bit 20 */
+static int ins_cpu_has_sse42(void) {
+#ifdef _MSC_VER
+  int registers[4];
+  __cpuid(registers, 1);
+  return (registers[2] >> 20) & 1;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  return __get_cpuid(1, &eax, &ebx, &ecx, &edx) ? (ecx >> 20) & 1 : 0;
+#endif
+}
+#endif
+
+#ifdef INS_DIGEST_ARM_CRC32C
+static uint32_t ins_crc32c_arm(uint32_t crc, const uint8_t* data, size_t size) {
+  for (; size >= 8; size -= 8, data += 8) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    crc = __crc32cd(crc, value);
+  }
+
+  for (; size; size--)
+    crc = __crc32cb(crc, *data++);
+
+  return crc;
+}
+#endif
+
+int ins_digest_crc32c_accelerated(void) {
+#if defined(INS_DIGEST_X86_CRC32C)
+  /* same value is computed by every thread, so unsynchronized cache is safe */
+  static int detected = -1;
+  if (detected < 0)
+    detected = ins_cpu_has_sse42();
+  return detected;
+#elif defined(INS_DIGEST_ARM_CRC32C)
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+static uint32_t ins_crc32c_update(uint32_t crc, const uint8_t* data, size_t size) {
+#if defined(INS_DIGEST_X86_CRC32C)
+  if (ins_digest_crc32c_accelerated())
+    return ins_crc32c_sse42(crc, data, size);
+#elif defined(INS_DIGEST_ARM_CRC32C)
+  return ins_crc32c_arm(crc, data, size);
+#endif
+  return ins_crc32c_table(crc, data, size);
+}
+
+static const uint32_t kInsSha256Initial[8] = {
+  0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint32_t kInsSha256Rounds[64] = {
+  0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+  0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+  0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+  0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+  0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+  0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+  0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+  0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+#define INS_ROTR32(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void ins_sha256_block(uint32_t* state, const uint8_t* block) {
+  uint32_t w[64];
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+  for (int i = 0; i < 16; i++)
+    w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) | ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = INS_ROTR32(w[i - 15], 7) ^ INS_ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = INS_ROTR32(w[i - 2], 17) ^ INS_ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (INS_ROTR32(e, 6) ^ INS_ROTR32(e, 11) ^ INS_ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + kInsSha256Rounds[i] + w[i];
+    uint32_t t2 = (INS_ROTR32(a, 2) ^ INS_ROTR32(a, 13) ^ INS_ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+static void ins_sha256_update(InsDigestType* digest, const uint8_t* data, size_t size) {
+  size_t used = (size_t)(digest->length % 64);
+
+  if (used) {
+    size_t fill = 64 - used < size ? 64 - used : size;
+    memcpy(digest->sha_block + used, data, fill);
+    data += fill;
+    size -= fill;
+
+    if (used + fill < 64)
+      return;
+    ins_sha256_block(digest->sha_state, digest->sha_block);
+  }
+
+  for (; size >= 64; size -= 64, data += 64)
+    ins_sha256_block(digest->sha_state, data);
+
+  memcpy(digest->sha_block, data, size);
+}
+
+void ins_digest_init(InsDigestType* digest, int algorithm) {
+  memset(digest, 0, sizeof(*digest));
+  digest->algorithm = algorithm;
+  digest->crc = 0xFFFFFFFF;
+  memcpy(digest->sha_state, kInsSha256Initial, sizeof(kInsSha256Initial));
+}
+
+void ins_digest_update(InsDigestType* digest, const void* data, size_t size) {
+  if (digest->algorithm == kInsDigestCrc32c)
+    digest->crc = ins_crc32c_update(digest->crc, (const uint8_t*)data, size);
+  else if (digest->algorithm == kInsDigestSha256)
+    ins_sha256_update(digest, (const uint8_t*)data, size);
+
+  digest->length += size;
+}
+
+int ins_digest_final(const InsDigestType* digest, uint8_t* out) {
+  if (digest->algorithm == kInsDigestCrc32c) {
+    uint32_t crc = ~digest->crc;
+    out[0] = (uint8_t)(crc >> 24);
+    out[1] = (uint8_t)(crc >> 16);
+    out[2] = (uint8_t)(crc >> 8);
+    out[3] = (uint8_t)crc;
+    return 4;
+  }
+
+  if (digest->algorithm != kInsDigestSha256)
+    return 0;
+
+  /* padding is added to copy of state, so digest may be continued */
+  InsDigestType last = *digest;
+  uint64_t bits = digest->length * 8;
+  uint8_t padding[72];
+  size_t padding_size = 64 - (size_t)((digest->length + 8) % 64);
+
+  memset(padding, 0, sizeof(padding));
+  padding[0] = 0x80;
+  for (int i = 0; i < 8; i++)
+    padding[padding_size + i] = (uint8_t)(bits >> (56 - i * 8));
+
+  ins_sha256_update(&last, padding, padding_size + 8);
+
+  for (int i = 0; i < 8; i++) {
+    out[i * 4] = (uint8_t)(last.sha_state[i] >> 24);
+    out[i * 4 + 1] = (uint8_t)(last.sha_state[i] >> 16);
+    out[i * 4 + 2] = (uint8_t)(last.sha_state[i] >> 8);
+    out[i * 4 + 3] = (uint8_t)last.sha_state[i];
+  }
+
+  return 32;
+}
+
+const char* ins_digest_name(int algorithm) {
+  switch (algorithm) {
+    case kInsDigestCrc32c: return "crc32c";
+    case kInsDigestSha256: return "sha256";
+  }
+  return NULL;
+}
+
+int ins_digest_parse_name(const char* name) {
+  if (!strcmp(name, "crc32c"))
+    return kInsDigestCrc32c;
+  if (!strcmp(name, "sha256"))
+    return kInsDigestSha256;
+  return 0;
+}
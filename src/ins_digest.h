@@ -0,0 +1,60 @@
+#ifndef INS_DIGEST_HEADER
+#define INS_DIGEST_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Content digests computed while data passes through copy buffers, so written files can be verified
+// without reading them again. CRC32C uses SSE4.2 (x86-64, detected at run time) or ARMv8 CRC instructions
+// (when compiler targets them), table lookup otherwise. SHA-256 is portable C.
+
+#define kInsDigestMaxSize  32
+
+/** Digest algorithms */
+typedef enum _InsDigestAlgorithm {
+  kInsDigestCrc32c = 1,                      /** CRC-32C (Castagnoli), 4 bytes, big endian */
+  kInsDigestSha256 = 2                       /** SHA-256, 32 bytes */
+} InsDigestAlgorithm;
+
+/** Running digest state, may be copied to continue one prefix with different data */
+typedef struct _InsDigestType {
+  int algorithm;                             /** InsDigestAlgorithm */
+  uint64_t length;                           /** Bytes added */
+  uint32_t crc;                              /** CRC32C state */
+  uint32_t sha_state[8];                     /** SHA-256 state */
+  uint8_t sha_block[64];                     /** SHA-256 incomplete block, length % 64 bytes */
+} InsDigestType;
+
+/**
+ * \brief    Start digest
+ * \param    digest      [out] Digest state
+ * \param    algorithm   [in]  InsDigestAlgorithm
+ */
+void ins_digest_init(InsDigestType* digest, int algorithm);
+
+/**
+ * \brief    Add bytes to digest
+ * \param    digest   [in]  Digest state
+ * \param    data     [in]  Data
+ * \param    size     [in]  Data size
+ */
+void ins_digest_update(InsDigestType* digest, const void* data, size_t size);
+
+/**
+ * \brief    Finish digest, state is not changed so more data may be added to it later
+ * \param    digest   [in]  Digest state
+ * \param    out      [out] Digest value, kInsDigestMaxSize bytes buffer
+ * \return   Digest value size
+ */
+int ins_digest_final(const InsDigestType* digest, uint8_t* out);
+
+/** Algorithm name ("crc32c", "sha256"), NULL for unknown algorithm */
+const char* ins_digest_name(int algorithm);
+
+/** Algorithm by name, 0 for unknown name */
+int ins_digest_parse_name(const char* name);
+
+/** Non-zero when CRC32C is computed by CPU instructions */
+int ins_digest_crc32c_accelerated(void);
+
+#endif  // INS_DIGEST_HEADER
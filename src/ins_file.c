@@ -0,0 +1,564 @@
+/*
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, 
+   BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. 
+   IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, 
+   OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, 
+   OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+   THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "ins_file.h"
+#include "ins_trailer_streams.h"
+
+struct InsHdrSpecificTagNameInfoType {
+  uint8_t type;
+  const char* name;
+};
+
+static const struct InsHdrSpecificTagNameInfoType kInsSpecificTagNameInfos[] = {
+  { kInsFileSpecificHeaderTagTypeSerial,          "serial" },
+  { kInsFileSpecificHeaderTagTypeFirmware,        "firmware" },
+  { kInsFileSpecificHeaderTagTypeModel,           "model" },
+  { kInsFileSpecificHeaderTagTypeOffset,          "stitching offset" },
+  { kInsFileSpecificHeaderTagTypeUnknown,         "unknown" }   /* 0xFF must be last item */
+};
+
+int64_t ins_get_file_size(FILE* file) {
+  ins_fseek64(file, 0, SEEK_END);
+  int64_t file_length = ins_ftell64(file);
+  return file_length;
+}
+
+const char* ins_get_header_field_name(uint8_t type_code) {
+  int i;
+  for (i = 0; ; i++) {
+    if (kInsSpecificTagNameInfos[i].type == kInsFileSpecificHeaderTagTypeUnknown)
+      return kInsSpecificTagNameInfos[i].name;
+
+    if (kInsSpecificTagNameInfos[i].type == type_code)
+      return kInsSpecificTagNameInfos[i].name;
+  }
+}
+
+const char* ins_file_error_string(int error) {
+  switch (error) {
+    case kInsFileOk:                       return "success";
+    case kInsFileErrorNotInsFile:          return "not Insta360 file";
+    case kInsFileErrorCorrupted:           return "trailer corrupted";
+    case kInsFileErrorNotFound:            return "not found";
+    case kInsFileErrorIo:                  return "read or write error";
+    case kInsFileErrorNoMemory:            return "not enough memory";
+    case kInsFileErrorInvalidArgument:     return "invalid argument";
+    case kInsFileErrorMediaCorrupted:      return "media corrupted";
+    default:                               return "unknown error";
+  }
+}
+
+int ins_find_and_read_minimal_header(FILE* file, uint8_t out_minimal_header[kInsFileMinHeaderLength]) {
+  int64_t file_length = ins_get_file_size(file);
+
+  if (file_length < kInsFileMinHeaderLength)
+    return kInsFileErrorNotInsFile;
+
+  if (ins_fseek64(file, -kInsFileMinHeaderLength, SEEK_END))
+    return kInsFileErrorIo;
+
+  /* signature is the last part of minimal header, read both in one call */
+  size_t actual_read = fread(out_minimal_header, 1, kInsFileMinHeaderLength, file);
+  if (actual_read != kInsFileMinHeaderLength)
+    return kInsFileErrorIo;
+
+  if (memcmp(out_minimal_header + kInsFileMinHeaderLength - kInsFileSignatureLength, kInsFileSignature, kInsFileSignatureLength))
+    return kInsFileErrorNotInsFile;
+
+  return 0;
+}
+
+int64_t ins_get_media_size(FILE* file) {
+  uint8_t minimal_header[kInsFileMinHeaderLength];
+  InsFileTrailerHeaderType trailer_info;
+
+  int result = ins_find_and_read_minimal_header(file, minimal_header);
+  if (result < 0)
+    return result;
+
+  memcpy(&trailer_info, minimal_header + kInsFileMinHeaderLength - kInsFileSignatureLength - sizeof(trailer_info), sizeof(trailer_info));
+
+  int64_t file_length = ins_get_file_size(file);
+  if (trailer_info.trailer_len < kInsFileMinHeaderLength || trailer_info.trailer_len > file_length)
+    return kInsFileErrorCorrupted;
+
+  return file_length - trailer_info.trailer_len;
+}
+
+void ins_free_trailer_buffer(const InsAllocatorType* allocator, uint8_t* trailer_buf) {
+  if (trailer_buf)
+    ins_release(allocator, trailer_buf);
+}
+
+int ins_read_allocate_trailer(
+  FILE* file, 
+  const InsAllocatorType* allocator, 
+  uint8_t** out_trailer_data, 
+  InsFileTrailerHeaderType* out_trailer_info) {
+
+  uint8_t minimal_ins_header_data[kInsFileMinHeaderLength];
+  size_t actual_read;
+
+  /* 1. Read and check minimal trailer information
+     2. Take full trailer size from minimal header, allocate buffer and read full trailer */
+
+  int result = ins_find_and_read_minimal_header(file, minimal_ins_header_data);
+  if (result < 0)
+    return result;  /* minimal header not found */
+  
+  InsFileTrailerHeaderType* trailer_info = (InsFileTrailerHeaderType*)(
+    minimal_ins_header_data + kInsFileMinHeaderLength - kInsFileSignatureLength - sizeof(InsFileTrailerHeaderType));
+
+  if (trailer_info->trailer_len < kInsFileMinHeaderLength || trailer_info->trailer_len > ins_get_file_size(file))
+    return kInsFileErrorCorrupted;
+
+  uint8_t* trailer_data = (uint8_t*)ins_allocate(allocator, trailer_info->trailer_len);
+  if (!trailer_data)
+    return kInsFileErrorNoMemory;
+
+  /* read full trailer data */
+  if (ins_fseek64(file, -((int64_t)trailer_info->trailer_len), SEEK_END))
+    actual_read = 0;
+  else
+    actual_read = fread(trailer_data, 1, trailer_info->trailer_len, file);
+
+  if (trailer_info->trailer_len > actual_read) {
+    ins_release(allocator, trailer_data);
+    return kInsFileErrorIo; // cannot read data
+  }
+
+  *out_trailer_info = *trailer_info;
+  *out_trailer_data = trailer_data;
+
+  return 0;
+}
+
+int ins_read_next_entry_location(
+  FILE* file, 
+  int64_t file_length, 
+  uint32_t trailer_len, 
+  int64_t* trailer_read_pos, 
+  InsTrailerEntryLocationType* out_location) {
+
+  InsFileTrailerEntryHeaderType entry_hdr;
+
+  if (*trailer_read_pos + (int64_t)sizeof(InsFileTrailerEntryHeaderType) > trailer_len)
+    return kInsFileErrorCorrupted;
+
+  if (ins_fseek64(file, -(*trailer_read_pos + (int64_t)sizeof(InsFileTrailerEntryHeaderType)), SEEK_END))
+    return kInsFileErrorIo;
+
+  if (fread(&entry_hdr, 1, sizeof(entry_hdr), file) != sizeof(entry_hdr))
+    return kInsFileErrorIo;
+
+  *trailer_read_pos += entry_hdr.length + sizeof(InsFileTrailerEntryHeaderType);
+
+  if (*trailer_read_pos > trailer_len)
+    return kInsFileErrorCorrupted;
+
+  out_location->type = entry_hdr.type;
+  out_location->length = entry_hdr.length;
+  out_location->file_offset = file_length - *trailer_read_pos;
+
+  return 0;
+}
+
+int ins_find_trailer_entry(FILE* file, uint16_t type, InsTrailerEntryLocationType* out_location) {
+  uint8_t minimal_ins_header_data[kInsFileMinHeaderLength];
+
+  int result = ins_find_and_read_minimal_header(file, minimal_ins_header_data);
+  if (result < 0)
+    return result;
+
+  int64_t file_length = ins_get_file_size(file);
+
+  const InsFileTrailerHeaderType* trailer_info = (const InsFileTrailerHeaderType*)(
+    minimal_ins_header_data + kInsFileMinHeaderLength - kInsFileSignatureLength - sizeof(InsFileTrailerHeaderType));
+
+  if (trailer_info->trailer_len < kInsFileMinHeaderLength || trailer_info->trailer_len > file_length)
+    return kInsFileErrorCorrupted;
+
+  int64_t trailer_read_pos = kInsFileMinHeaderLength;
+
+  while (trailer_read_pos < trailer_info->trailer_len) {
+    result = ins_read_next_entry_location(file, file_length, trailer_info->trailer_len, &trailer_read_pos, out_location);
+    if (result < 0)
+      return result;
+
+    if (out_location->type == type)
+      return 0;
+  }
+
+  return kInsFileErrorNotFound;
+}
+
+int64_t ins_extract_trailer_entry(FILE* file, uint16_t type, FILE* file_out, const InsAllocatorType* allocator) {
+  InsTrailerEntryLocationType location;
+
+  int result = ins_find_trailer_entry(file, type, &location);
+  if (result < 0)
+    return result;
+
+  result = ins_copy_file_region(file, location.file_offset, location.length, file_out, allocator);
+  if (result < 0)
+    return result;
+
+  return location.length;
+}
+
+static void ins_copy_tag_string(char* out, InsByteViewType data) {
+  memcpy(out, data.data, data.size);
+  out[data.size] = 0;
+}
+
+int ins_read_specific_info(FILE* file, const InsAllocatorType* allocator, InsSpecificInfoType* out_info) {
+  InsTrailerEntryLocationType location;
+  InsEntryViewType entry;
+  InsTagIteratorType iterator;
+  InsTagViewType tag;
+
+  out_info->serial[0] = out_info->model[0] = out_info->firmware[0] = out_info->offset_string[0] = 0;
+  out_info->offset_error = kInsFileErrorNotFound;
+
+  int result = ins_find_trailer_entry(file, kInsTrailerEntryTypeSpecific, &location);
+  if (result < 0)
+    return result;
+
+  uint8_t* data = (uint8_t*)ins_allocate(allocator, location.length ? location.length : 1);
+  if (!data)
+    return kInsFileErrorNoMemory;
+
+  if (ins_fseek64(file, location.file_offset, SEEK_SET) || fread(data, 1, location.length, file) != location.length) {
+    ins_release(allocator, data);
+    return kInsFileErrorIo;
+  }
+
+  entry.type = location.type;
+  entry.trailer_offset = 0;
+  entry.data = ins_byte_view(data, location.length);
+
+  ins_tag_iterator_begin(&iterator);
+
+  while ((result = ins_entry_view_next_tag(&entry, &iterator, &tag)) > 0) {
+    switch (tag.type_code) {
+    case kInsFileSpecificHeaderTagTypeSerial:    ins_copy_tag_string(out_info->serial, tag.data); break;
+    case kInsFileSpecificHeaderTagTypeModel:     ins_copy_tag_string(out_info->model, tag.data); break;
+    case kInsFileSpecificHeaderTagTypeFirmware:  ins_copy_tag_string(out_info->firmware, tag.data); break;
+    case kInsFileSpecificHeaderTagTypeOffset:
+      ins_copy_tag_string(out_info->offset_string, tag.data);
+      out_info->offset_error = ins_parse_stitching_offset((const char*)tag.data.data, tag.data.size, &out_info->offset) < 0 ? 
+        kInsFileErrorCorrupted : 0;
+      break;
+    }
+  }
+
+  ins_release(allocator, data);
+  return result < 0 ? result : 0;
+}
+
+int ins_write_trailer_entry_header(FILE* file_out, uint16_t type, uint32_t length) {
+  InsFileTrailerEntryHeaderType entry_hdr;
+  entry_hdr.type = type;
+  entry_hdr.length = length;
+
+  return fwrite(&entry_hdr, 1, sizeof(entry_hdr), file_out) == sizeof(entry_hdr) ? 0 : kInsFileErrorIo;
+}
+
+int ins_write_trailer_end(FILE* file_out, uint32_t entries_size, uint32_t trailer_version) {
+  uint8_t trailer_end[kInsFileMinHeaderLength];
+  InsFileTrailerHeaderType trailer_hdr;
+
+  trailer_hdr.trailer_version = trailer_version;
+  trailer_hdr.trailer_len = entries_size + kInsFileMinHeaderLength;
+
+  int zero_padding_size = kInsFileMinHeaderLength - kInsFileSignatureLength - sizeof(InsFileTrailerHeaderType);
+
+  memset(trailer_end, 0, zero_padding_size);
+  memcpy(trailer_end + zero_padding_size, &trailer_hdr, sizeof(trailer_hdr));
+  memcpy(trailer_end + zero_padding_size + sizeof(trailer_hdr), kInsFileSignature, kInsFileSignatureLength);
+
+  return fwrite(trailer_end, 1, sizeof(trailer_end), file_out) == sizeof(trailer_end) ? 0 : kInsFileErrorIo;
+}
+
+int ins_write_changed_specific_entry(const InsEntryViewType* entry, const char* new_offset, FILE* file_out, uint32_t* out_entry_size) {
+  size_t new_offset_size = strlen(new_offset);
+  if (new_offset_size > UINT8_MAX)
+    return kInsFileErrorInvalidArgument; /* tag data size is one byte */
+
+  InsTagIteratorType iterator;
+  InsTagViewType tag;
+  int offset_found = 0;
+  int result;
+
+  /* check format before writing anything */
+  ins_tag_iterator_begin(&iterator);
+  while ((result = ins_entry_view_next_tag(entry, &iterator, &tag)) > 0) {}
+
+  if (result < 0)
+    return result;
+
+  uint32_t entry_size = 0;
+  int error = 0;
+  InsFileSpecificDataTagHeaderType new_tag_hdr;
+
+  ins_tag_iterator_begin(&iterator);
+
+  while (!error && ins_entry_view_next_tag(entry, &iterator, &tag) > 0) {
+    InsByteViewType tag_data = tag.data;
+
+    if (tag.type_code == kInsFileSpecificHeaderTagTypeOffset) {
+      /* tag type is kInsHeaderFieldTypeStitchingOffset, replace with new value */
+      tag_data = ins_byte_view((const uint8_t*)new_offset, (uint32_t)new_offset_size);
+      offset_found = 1;
+    }
+
+    new_tag_hdr.type_code = tag.type_code;
+    new_tag_hdr.data_size = (uint8_t)tag_data.size;
+
+    error |= fwrite(&new_tag_hdr, 1, sizeof(new_tag_hdr), file_out) != sizeof(new_tag_hdr);
+    error |= fwrite(tag_data.data, 1, tag_data.size, file_out) != tag_data.size;
+    entry_size += sizeof(new_tag_hdr) + tag_data.size;
+  }
+
+  /* file did not contain stitching offset parameter - add it */
+  if (!offset_found) {
+    new_tag_hdr.type_code = kInsFileSpecificHeaderTagTypeOffset;
+    new_tag_hdr.data_size = (uint8_t)new_offset_size;
+
+    error |= fwrite(&new_tag_hdr, 1, sizeof(new_tag_hdr), file_out) != sizeof(new_tag_hdr);
+    error |= fwrite(new_offset, 1, new_offset_size, file_out) != new_offset_size;
+    entry_size += (uint32_t)(sizeof(new_tag_hdr) + new_offset_size);
+  }
+
+  InsByteViewType tail = ins_entry_view_tail(entry, &iterator);
+  error |= fwrite(tail.data, 1, tail.size, file_out) != tail.size;
+  entry_size += tail.size;
+
+  if (error)
+    return kInsFileErrorIo;
+
+  *out_entry_size = entry_size;
+  return 0;
+}
+
+int ins_write_trailer(
+  const InsTrailerViewType* trailer, 
+  const char* new_offset, 
+  FILE* file_out, 
+  const InsAllocatorType* allocator, 
+  uint32_t* out_trailer_len) {
+
+  ins_small_vector_t(InsEntryViewType, kInsTrailerEntriesInlineCapacity) entries;
+  InsEntryViewType entry;
+  uint32_t position = ins_trailer_view_begin(trailer);
+  int result;
+
+  ins_small_vector_init(&entries);
+
+  while ((result = ins_trailer_view_next_entry(trailer, &position, &entry)) > 0) {
+    if (ins_small_vector_push(allocator, &entries, entry) < 0) {
+      result = kInsFileErrorNoMemory;
+      break;
+    }
+  }
+
+  uint32_t entries_size = 0;
+
+  /* entries are found from file end, write them in file order */
+  if (!result) {
+    const InsEntryViewType* begin = ins_small_vector_begin(&entries);
+    const InsEntryViewType* it = ins_small_vector_end(&entries);
+
+    while (!result && it != begin) {
+      const InsEntryViewType* entry = --it;
+      uint32_t entry_size = entry->data.size;
+
+      if (entry->type == kInsTrailerEntryTypeSpecific && new_offset)
+        result = ins_write_changed_specific_entry(entry, new_offset, file_out, &entry_size);
+      else if (fwrite(entry->data.data, 1, entry->data.size, file_out) != entry->data.size)
+        result = kInsFileErrorIo;
+
+      if (!result && ins_write_trailer_entry_header(file_out, entry->type, entry_size) < 0)
+        result = kInsFileErrorIo;
+
+      entries_size += entry_size + sizeof(InsFileTrailerEntryHeaderType);
+    }
+  }
+
+  ins_small_vector_destroy(allocator, &entries);
+
+  if (result < 0)
+    return result;
+
+  if (ins_write_trailer_end(file_out, entries_size, trailer->info.trailer_version) < 0)
+    return kInsFileErrorIo;
+
+  if (out_trailer_len)
+    *out_trailer_len = entries_size + kInsFileMinHeaderLength;
+
+  return 0;
+}
+
+int ins_write_file_with_offset(
+  FILE* file, 
+  const char* new_offset, 
+  FILE* file_out, 
+  const InsAllocatorType* allocator, 
+  const InsAllocatorType* io_allocator) {
+
+  uint8_t* trailer_data;
+  InsFileTrailerHeaderType trailer_info;
+  InsTrailerViewType trailer;
+  InsEntryViewType entry;
+
+  int result = ins_read_allocate_trailer(file, allocator, &trailer_data, &trailer_info);
+  if (result < 0)
+    return result;
+
+  result = ins_trailer_view_init(&trailer, trailer_data, trailer_info.trailer_len);
+
+  /* check specific header exists before writing anything */
+  if (!result)
+    result = ins_trailer_view_find_entry(&trailer, kInsTrailerEntryTypeSpecific, &entry);
+
+  if (!result)
+    result = ins_copy_file_region(file, 0, ins_get_file_size(file) - trailer_info.trailer_len, file_out, 
+      io_allocator ? io_allocator : allocator);
+
+  if (!result)
+    result = ins_write_trailer(&trailer, new_offset, file_out, allocator, NULL);
+
+  ins_free_trailer_buffer(allocator, trailer_data);
+  return result;
+}
+
+/** Trailer entry descriptions, item index is entry type high byte. Item 0 is used for unknown types */
+const InsTrailerEntryDescType kInsTrailerEntryDescs[kInsTrailerEntryDescsCount] = {
+  { 0,                               "unknown",        kInsEntryLoadFlagNone,        0 },
+  { kInsTrailerEntryTypeSpecific,    "specific info",  kInsEntryLoadFlagFullPayload, 0 },
+  { kInsTrailerEntryTypePreview,     "preview image",  kInsEntryLoadFlagStreamable,  0 },
+  { kInsTrailerEntryTypeImu,         "imu",            kInsEntryLoadFlagStreamable,  kInsImuRecordSize },
+  { kInsTrailerEntryTypeExposure,    "exposure",       kInsEntryLoadFlagStreamable,  kInsExposureRecordSize },
+  { kInsTrailerEntryType500,         "unknown",        kInsEntryLoadFlagNone,        0 },
+  { kInsTrailerEntryTypeTimestamps,  "timestamps",     kInsEntryLoadFlagStreamable,  kInsTimestampRecordSize },
+  { kInsTrailerEntryTypeGps,         "gps",            kInsEntryLoadFlagStreamable,  kInsGpsRecordSize }
+};
+
+void ins_trailer_read_plan_init(InsTrailerReadPlanType* plan, const InsAllocatorType* allocator) {
+  memset(plan, 0, sizeof(*plan));
+  ins_small_vector_init(&plan->entries);
+  plan->allocator = allocator;
+}
+
+void ins_trailer_read_plan_destroy(InsTrailerReadPlanType* plan) {
+  ins_small_vector_destroy(plan->allocator, &plan->entries);
+  ins_trailer_read_plan_init(plan, plan->allocator);
+}
+
+int ins_plan_trailer_reads(FILE* file, uint32_t wanted_types_mask, InsTrailerReadPlanType* out_plan) {
+  uint8_t minimal_ins_header_data[kInsFileMinHeaderLength];
+
+  /* plan may be reused for many files, entries storage is kept */
+  ins_small_vector_clear(&out_plan->entries);
+
+  int result = ins_find_and_read_minimal_header(file, minimal_ins_header_data);
+  if (result < 0)
+    return result;
+
+  out_plan->trailer_info = *(const InsFileTrailerHeaderType*)(
+    minimal_ins_header_data + kInsFileMinHeaderLength - kInsFileSignatureLength - sizeof(InsFileTrailerHeaderType));
+  out_plan->file_length = ins_get_file_size(file);
+  out_plan->load_types_mask = 0;
+  out_plan->load_bytes = 0;
+
+  if (out_plan->trailer_info.trailer_len < kInsFileMinHeaderLength ||
+      out_plan->trailer_info.trailer_len > out_plan->file_length)
+    return kInsFileErrorCorrupted;
+
+  int64_t trailer_read_pos = kInsFileMinHeaderLength;
+
+  while (trailer_read_pos < out_plan->trailer_info.trailer_len) {
+    InsTrailerEntryLocationType location;
+
+    result = ins_read_next_entry_location(file, out_plan->file_length, out_plan->trailer_info.trailer_len, &trailer_read_pos, &location);
+    if (result < 0)
+      return result;
+
+    if (ins_small_vector_push(out_plan->allocator, &out_plan->entries, location) < 0)
+      return kInsFileErrorNoMemory;
+
+    const InsTrailerEntryDescType* desc = ins_get_trailer_entry_desc(location.type);
+    uint32_t type_bit = kInsTrailerEntryTypeBit(location.type);
+
+    if ((wanted_types_mask & type_bit) && desc->flags != kInsEntryLoadFlagNone) {
+      out_plan->load_types_mask |= type_bit;
+      out_plan->load_bytes += location.length;
+    }
+  }
+
+  return 0;
+}
+
+void ins_unmap_trailer(InsMappedTrailerType* trailer) {
+  ins_unmap_file_region(&trailer->region);
+  ins_free_trailer_buffer(trailer->allocator, trailer->buffer);
+  trailer->buffer = NULL;
+}
+
+int ins_map_trailer(FILE* file, const InsTrailerReadPlanType* plan, InsMappedTrailerType* out_trailer) {
+  uint32_t trailer_len = plan->trailer_info.trailer_len;
+  int populate = plan->load_bytes * 2 >= trailer_len;
+  const uint8_t* trailer_data;
+
+  out_trailer->file_offset = plan->file_length - trailer_len;
+  out_trailer->region.map_base = NULL;
+  out_trailer->buffer = NULL;
+  out_trailer->allocator = plan->allocator;
+
+  if (ins_map_file_region(file, out_trailer->file_offset, trailer_len, populate, &out_trailer->region) == 0) {
+    if (!populate) {
+      const InsTrailerEntryLocationType* location;
+
+      for (location = ins_small_vector_begin(&plan->entries); location != ins_small_vector_end(&plan->entries); location++) {
+        if (ins_plan_entry_needs_load(plan, location))
+          ins_advise_file_region(&out_trailer->region, location->file_offset - out_trailer->file_offset, location->length);
+      }
+    }
+
+    trailer_data = out_trailer->region.data;
+  } else {
+    /* mapping is not available, read full trailer */
+    InsFileTrailerHeaderType trailer_info;
+
+    int result = ins_read_allocate_trailer(file, plan->allocator, &out_trailer->buffer, &trailer_info);
+    if (result < 0)
+      return result;
+
+    trailer_data = out_trailer->buffer;
+  }
+
+  if (ins_trailer_view_init(&out_trailer->view, trailer_data, trailer_len) < 0) {
+    ins_unmap_trailer(out_trailer);
+    return kInsFileErrorCorrupted;
+  }
+
+  return 0;
+}
+
+int ins_map_trailer_entry(FILE* file, uint16_t type, InsMappedRegionType* out_region) {
+  InsTrailerEntryLocationType location;
+
+  int result = ins_find_trailer_entry(file, type, &location);
+  if (result < 0)
+    return result;
+
+  return ins_map_file_region(file, location.file_offset, location.length, 1, out_region);
+}
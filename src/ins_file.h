@@ -0,0 +1,335 @@
+#ifndef INS_FILE_HEADER
+#define INS_FILE_HEADER
+
+// libinsfile: Insta360 INSV/INSP trailer reading and editing.
+// Library functions do not print anything and allocate memory only through caller supplied allocator.
+// Functions return 0 or positive value on success, negative error code from enum InsFileErrorCodes on fail.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+#include "ins_file_format.h"
+#include "ins_platform.h"
+#include "ins_small_vector.h"
+#include "ins_stitching_offset.h"
+#include "ins_trailer_view.h"
+
+#define kInsTrailerEntriesInlineCapacity  8 /* Camera trailers have 6-7 entries, lists of them do not allocate */
+
+/** Trailer entry found by lazy lookup, entry data is not loaded */
+typedef struct _InsTrailerEntryLocationType {
+  uint16_t type;                             /** Trailer header data type */
+  uint32_t length;                           /** Entry data length */
+  int64_t file_offset;                       /** Offset to entry data from file start */
+} InsTrailerEntryLocationType;
+
+typedef ins_small_vector_t(InsTrailerEntryLocationType, kInsTrailerEntriesInlineCapacity) InsTrailerEntryLocationVector;
+
+/** Trailer read plan: locations of all entries and set of entries which data must be read */
+typedef struct _InsTrailerReadPlanType {
+  InsFileTrailerHeaderType trailer_info;     /** Trailer information from minimal header */
+  int64_t file_length;                       /** Input file size */
+  InsTrailerEntryLocationVector entries;     /** All trailer entries, from file end to start */
+  uint32_t load_types_mask;                  /** Entry types which data must be read, see kInsTrailerEntryTypeBit */
+  int64_t load_bytes;                        /** Total data size of entries which must be read */
+  const InsAllocatorType* allocator;         /** Allocator for entries vector and trailer read fallback */
+} InsTrailerReadPlanType;
+
+/** Trailer mapped to memory (or read to buffer when mapping is not available) */
+typedef struct _InsMappedTrailerType {
+  InsTrailerViewType view;                   /** View over mapped trailer */
+  int64_t file_offset;                       /** Trailer start position in file */
+  InsMappedRegionType region;                /** Mapped file tail, map_base is NULL when trailer was read to buffer */
+  uint8_t* buffer;                           /** Trailer buffer for read fallback */
+  const InsAllocatorType* allocator;         /** Allocator of trailer buffer */
+} InsMappedTrailerType;
+
+#define kInsSpecificTagMaxSize  256 /* Tag data size is one byte, plus terminating zero */
+
+/** Decoded specific header (0x101) tags, missing tags are empty strings */
+typedef struct _InsSpecificInfoType {
+  char serial[kInsSpecificTagMaxSize];       /** Camera serial number (0x0A) */
+  char model[kInsSpecificTagMaxSize];        /** Camera model (0x12) */
+  char firmware[kInsSpecificTagMaxSize];     /** Firmware version (0x1A) */
+  char offset_string[kInsSpecificTagMaxSize];  /** Stitching offset as stored in file (0x2A) */
+  int offset_error;                          /** 0 - offset parsed, kInsFileErrorNotFound, kInsFileErrorCorrupted */
+  InsStitchingOffsetType offset;             /** Parsed stitching offset, valid when offset_error is 0 */
+} InsSpecificInfoType;
+
+/** Bit for entry type in types mask, entry types differ in high byte */
+#define kInsTrailerEntryTypeBit(type)  (1u << (((type) >> 8) & 0x1F))
+
+/** Trailer entry load flags, tell loader how entry data must be read */
+enum InsTrailerEntryLoadFlags {
+  kInsEntryLoadFlagNone                        = 0,  /** Entry data is not decoded, header is enough */
+  kInsEntryLoadFlagFullPayload                 = 1,  /** Entry is decoded from full data in memory */
+  kInsEntryLoadFlagStreamable                  = 2   /** Entry data is records sequence, can be read and decoded by chunks */
+};
+
+/** Trailer entry description, entry data itself is decoded by ins_read_specific_info and ins_trailer_streams.h */
+typedef struct _InsTrailerEntryDescType {
+  uint16_t type;                             /** Trailer entry type */
+  const char* name;                          /** Entry name */
+  uint32_t flags;                            /** Flags from enum InsTrailerEntryLoadFlags */
+  uint32_t record_size;                      /** Record size for streamable entries, 0 - variable or unknown */
+} InsTrailerEntryDescType;
+
+#define kInsTrailerEntryDescsCount  8
+
+/** Trailer entry descriptions, item index is entry type high byte. Item 0 is used for unknown types */
+extern const InsTrailerEntryDescType kInsTrailerEntryDescs[kInsTrailerEntryDescsCount];
+
+/**
+ * \brief    Get error description
+ * \param    error   [in]  Error code from enum InsFileErrorCodes
+ * \return   Pointer to zero-terminated static string
+ */
+const char* ins_file_error_string(int error);
+
+/**
+ * \brief    Get file size help function
+ * \param    file   [in]   File handle
+ * \return   File size in bytes
+ */
+int64_t ins_get_file_size(FILE* file);
+
+/**
+ * \brief    Return tag name by tag type code
+ * \param    type_code      Tag type code
+ * \return   Pointer to zero-terminated string with tag name
+ */
+const char* ins_get_header_field_name(uint8_t type_code);
+
+/** 
+ * \brief    Check file signature and read minimal header (72 bytes)
+ * \param    file                 [in]  Input file handle
+ * \param    out_minimal_header   [out] Output buffer, function stores minimal header here
+ * \return   0 - success, kInsFileErrorNotInsFile, kInsFileErrorIo
+ */
+int ins_find_and_read_minimal_header(FILE* file, uint8_t out_minimal_header[kInsFileMinHeaderLength]);
+
+/**
+ * \brief    Get media region size (file data before Insta360 trailer), only minimal header is read
+ * \param    file   [in]  Input file handle
+ * \return   Media region size - success, kInsFileErrorNotInsFile, kInsFileErrorCorrupted, kInsFileErrorIo
+ */
+int64_t ins_get_media_size(FILE* file);
+
+/**
+ * \brief    Free trailer buffer
+ * \param    allocator      [in]   Allocator passed to ins_read_allocate_trailer
+ * \param    trailer_buf    [in]   Trailer buffer allocated by function ins_read_allocate_trailer, may be NULL
+ */
+void ins_free_trailer_buffer(const InsAllocatorType* allocator, uint8_t* trailer_buf);
+
+/**
+ * \brief    Find trailer size, allocate buffer and read full file trailer to allocated buffer
+ * \param    file   File descriptor
+ * \param    allocator          [in]   Allocator of trailer buffer
+ * \param    out_trailer_data   [out]  Function saves pointer to allocated buffer with trailer data
+ * \param    out_trailer_info   [out]  Function saves information structure about trailer
+ * \return   0 - success, negative - error code
+ */
+int ins_read_allocate_trailer(
+  FILE* file, 
+  const InsAllocatorType* allocator, 
+  uint8_t** out_trailer_data, 
+  InsFileTrailerHeaderType* out_trailer_info);
+
+/**
+ * \brief    Read next trailer entry header, walking from file end to start
+ * \param    file              [in]      Input file handle
+ * \param    file_length       [in]      Input file size
+ * \param    trailer_len       [in]      Trailer length from minimal header
+ * \param    trailer_read_pos  [in,out]  Position from file end, updated to next entry
+ * \param    out_location      [out]     Function saves entry type, length and data position in file
+ * \return   0 - success, kInsFileErrorCorrupted, kInsFileErrorIo
+ */
+int ins_read_next_entry_location(
+  FILE* file, 
+  int64_t file_length, 
+  uint32_t trailer_len, 
+  int64_t* trailer_read_pos, 
+  InsTrailerEntryLocationType* out_location);
+
+/**
+ * \brief    Find trailer entry by type without reading full trailer. Function reads minimal header and
+ *           entry headers only (6 bytes per entry), entry data is not read
+ * \param    file           [in]  Input file handle
+ * \param    type           [in]  Trailer entry type (0x101, 0x200, ...)
+ * \param    out_location   [out] Function saves entry type, length and data position in file
+ * \return   0 - success, kInsFileErrorNotFound - entry not found, other negative - error code
+ */
+int ins_find_trailer_entry(FILE* file, uint16_t type, InsTrailerEntryLocationType* out_location);
+
+/**
+ * \brief    Copy trailer entry data (for example 0x200 preview JPEG) to output file. Only this entry is read,
+ *           data is copied by kernel where possible (sendfile)
+ * \param    file       [in]  Input file handle
+ * \param    type       [in]  Trailer entry type
+ * \param    file_out   [in]  Output file handle
+ * \param    allocator  [in]  Allocator of copy buffer when kernel copy is not available
+ * \return   Copied bytes count - success, negative - error code
+ */
+int64_t ins_extract_trailer_entry(FILE* file, uint16_t type, FILE* file_out, const InsAllocatorType* allocator);
+
+/**
+ * \brief    Read and decode specific header (0x101) tags. Only entry headers and specific header data are read
+ * \param    file        [in]  Input file handle
+ * \param    allocator   [in]  Allocator of temporary entry buffer
+ * \param    out_info    [out] Decoded tags
+ * \return   0 - success, kInsFileErrorNotFound - file has no specific header, other negative - error code
+ */
+int ins_read_specific_info(FILE* file, const InsAllocatorType* allocator, InsSpecificInfoType* out_info);
+
+/**
+ * \brief    Write trailer entry header, header follows entry data in file
+ * \param    file_out   [in]  Output file
+ * \param    type       [in]  Trailer entry type
+ * \param    length     [in]  Entry data length
+ * \return   0 - success, kInsFileErrorIo
+ */
+int ins_write_trailer_entry_header(FILE* file_out, uint16_t type, uint32_t length);
+
+/**
+ * \brief    Write trailer end: zero padding, trailer header and signature
+ * \param    file_out         [in]  Output file
+ * \param    entries_size     [in]  Total size of written entries including entry headers
+ * \param    trailer_version  [in]  Trailer version
+ * \return   0 - success, kInsFileErrorIo
+ */
+int ins_write_trailer_end(FILE* file_out, uint32_t entries_size, uint32_t trailer_version);
+
+/**
+ * \brief    Write specific Insta360 trailer entry data with changed stitching offset tag value. 
+ *           Unchanged tags and tail are written directly from input entry view, without intermediate buffer
+ * \param    entry            [in]  Specific header entry view
+ * \param    new_offset       [in]  Zero-terminated string contains new stitching offset value
+ * \param    file_out         [in]  Output file
+ * \param    out_entry_size   [out] Function saves written entry data size
+ * \return   0 - success, kInsFileErrorInvalidArgument - offset too long, kInsFileErrorCorrupted, kInsFileErrorIo
+ */
+int ins_write_changed_specific_entry(const InsEntryViewType* entry, const char* new_offset, FILE* file_out, uint32_t* out_entry_size);
+
+/**
+ * \brief    Write trailer rebuilt from input trailer view. Unchanged entries are written directly from view,
+ *           specific header entry (0x101) gets new stitching offset value
+ * \param    trailer          [in]  Input trailer view
+ * \param    new_offset       [in]  New stitching offset value, NULL - keep specific header as is
+ * \param    file_out         [in]  Output file, trailer is written from current position
+ * \param    allocator        [in]  Allocator of entries list, used only for trailers with many entries
+ * \param    out_trailer_len  [out] Function saves written trailer length, may be NULL
+ * \return   0 - success, kInsFileErrorInvalidArgument - offset too long, kInsFileErrorCorrupted, kInsFileErrorIo,
+ *           kInsFileErrorNoMemory
+ */
+int ins_write_trailer(
+  const InsTrailerViewType* trailer, 
+  const char* new_offset, 
+  FILE* file_out, 
+  const InsAllocatorType* allocator, 
+  uint32_t* out_trailer_len);
+
+/**
+ * \brief    Write copy of Insta360 file with changed stitching offset: media data is copied as is,
+ *           trailer is rebuilt with new specific header. Allocates trailer buffer and copy buffer only
+ * \param    file           [in]  Input file handle
+ * \param    new_offset     [in]  New stitching offset value
+ * \param    file_out       [in]  Output file, data is written from current position
+ * \param    allocator      [in]  Allocator of trailer buffer
+ * \param    io_allocator   [in]  Allocator of copy buffer (for example ins_buffer_cache_allocator), NULL - use allocator
+ * \return   0 - success, kInsFileErrorNotFound - file has no specific header, other negative - error code
+ */
+int ins_write_file_with_offset(
+  FILE* file, 
+  const char* new_offset, 
+  FILE* file_out, 
+  const InsAllocatorType* allocator, 
+  const InsAllocatorType* io_allocator);
+
+/**
+ * \brief    Get description of trailer entry type, table lookup by type high byte
+ * \param    type   Trailer entry type
+ * \return   Pointer to entry description, never NULL
+ */
+static inline const InsTrailerEntryDescType* ins_get_trailer_entry_desc(uint16_t type) {
+  int index = type >> 8;
+
+  if (index < kInsTrailerEntryDescsCount && kInsTrailerEntryDescs[index].type == type)
+    return &kInsTrailerEntryDescs[index];
+
+  return &kInsTrailerEntryDescs[0];
+}
+
+/**
+ * \brief    Initialize empty read plan
+ * \param    plan        [out] Read plan
+ * \param    allocator   [in]  Allocator of plan entries and of trailer buffer in ins_map_trailer fallback
+ */
+void ins_trailer_read_plan_init(InsTrailerReadPlanType* plan, const InsAllocatorType* allocator);
+
+/**
+ * \brief    Free read plan storage
+ * \param    plan        [in]  Read plan
+ */
+void ins_trailer_read_plan_destroy(InsTrailerReadPlanType* plan);
+
+/**
+ * \brief    Walk trailer entry headers and plan reads: entry data is loaded only for wanted types 
+ *           which descriptions need payload
+ * \param    file               [in]  Input file handle
+ * \param    wanted_types_mask  [in]  Entry types required by caller, see kInsTrailerEntryTypeBit
+ * \param    out_plan           [in,out] Read plan initialized by ins_trailer_read_plan_init. Plan may be reused,
+ *                                       entries storage is kept, so repeated calls do not allocate
+ * \return   0 - success, negative - error code
+ */
+int ins_plan_trailer_reads(FILE* file, uint32_t wanted_types_mask, InsTrailerReadPlanType* out_plan);
+
+/**
+ * \brief    Check entry data must be read according to read plan
+ * \param    plan       [in]  Read plan
+ * \param    location   [in]  Entry from plan
+ * \return   1 - entry data must be read, 0 - header is enough
+ */
+static inline int ins_plan_entry_needs_load(const InsTrailerReadPlanType* plan, const InsTrailerEntryLocationType* location) {
+  return (plan->load_types_mask & kInsTrailerEntryTypeBit(location->type)) && 
+    ins_get_trailer_entry_desc(location->type)->type == location->type;
+}
+
+/**
+ * \brief    Release trailer mapped by ins_map_trailer
+ * \param    trailer   [in]  Mapped trailer
+ */
+void ins_unmap_trailer(InsMappedTrailerType* trailer);
+
+/**
+ * \brief    Map trailer to memory according to read plan. When plan loads most of trailer, all pages are
+ *           read during mapping, otherwise only entries from plan are read ahead. Falls back to 
+ *           ins_read_allocate_trailer when mapping is not available
+ * \param    file          [in]  Input file handle
+ * \param    plan          [in]  Read plan from ins_plan_trailer_reads
+ * \param    out_trailer   [out] Mapped trailer, must be released by ins_unmap_trailer
+ * \return   0 - success, negative - error code
+ */
+int ins_map_trailer(FILE* file, const InsTrailerReadPlanType* plan, InsMappedTrailerType* out_trailer);
+
+/**
+ * \brief    Get pointer to entry data in mapped trailer
+ * \param    trailer    [in]  Mapped trailer
+ * \param    location   [in]  Entry location from read plan
+ * \return   Pointer to entry data
+ */
+static inline const uint8_t* ins_mapped_trailer_entry_data(const InsMappedTrailerType* trailer, const InsTrailerEntryLocationType* location) {
+  return ins_byte_view_sub(trailer->view.bytes, (uint32_t)(location->file_offset - trailer->file_offset), location->length).data;
+}
+
+/**
+ * \brief    Map single trailer entry data to memory (for example 0x200 preview JPEG), so caller can use it
+ *           without copy. Only this entry pages are read
+ * \param    file         [in]  Input file handle
+ * \param    type         [in]  Trailer entry type
+ * \param    out_region   [out] Mapped entry data, must be released by ins_unmap_file_region
+ * \return   0 - success, negative - error code
+ */
+int ins_map_trailer_entry(FILE* file, uint16_t type, InsMappedRegionType* out_region);
+
+#endif  // INS_FILE_HEADER
@@ -0,0 +1,115 @@
+#ifndef INS_FILE_FORMAT_HEADER
+#define INS_FILE_FORMAT_HEADER
+
+#include <stdint.h>
+
+#define kInsFileSignature        "8db42d694ccc418790edff439fe026bf"
+#define kInsFileSignatureLength  32
+#define kInsFileMinHeaderLength  (kInsFileSignatureLength+40)
+
+// Some info about Insta360 metadata format can be found here
+// https://fossies.org/linux/Image-ExifTool/lib/Image/ExifTool/QuickTimeStream.pl
+
+// Stitching offset string examples:
+// 2_1497.030_1514.415_1501.982_0.0_0.00_0.000_1491.991_4555.739_1542.696_0.089_-0.077_179.891_6080_3040_2323
+// 2_1646.662_1440.499_1419.611_0.000_0.000_0.000_1654.103_4309.465_1412.394_0.000_0.000_180.000_5760_2880_19
+
+///////////////////
+// File global structure (from start file to end)
+// 0         Media file data (INSV: H.264 video in mp4 container, INSP: JPEG image)
+// NNNN      File trailer (Insta360 metainfo)
+//
+// INSV media data is sequence of ISO-BMFF (mp4) boxes, camera writes ftyp, mdat, moov. Last box must end
+// exactly at trailer start (see ins_mp4.h)
+
+///////////////////
+// Trailer structure (from end file to start)
+// 0         File signature       (32 bytes)    8db42d694ccc418790edff439fe026bf
+// 32        InsFileTrailerHeaderType  (8 bytes)
+// 40        padding zero         (32 bytes)
+// 72        InsFileTrailerEntryHeaderType     (6 bytes)
+// 72+N      trailer hdr data         (N bytes)
+// XXX       InsFileTrailerEntryHeaderType     (6 bytes)
+// MMM       trailer hdr data         (M bytes)
+// .........................
+// until trailer size == file pos
+
+
+// Trailer header data format depends on InsFileTrailerEntryHeaderType.type value:
+// 0x101     specific Insta360 info   (contains stitching offset data, serial, camera model, etc)
+// 0x200     preview image (JPEG)
+// 0x300     accelerometer and angular velocity info
+// 0x400     exposure time info (decoded in ins_trailer_streams.c)
+// 0x500     ???
+// 0x600     video timestamps (decoded in ins_trailer_streams.c)
+// 0x700     GPS data
+
+//////////////////
+// Specific Insta360 trailer header structure
+// 0         tag 0 type code  (1 byte)
+// 1         tag 0 data size  (1 byte)  (value does not include tag data size and type code fields)
+// 2         tag 0 data       (N bytes, tag 0 data size)
+// N+0       tag 1 type code  (1 byte)
+// N+1       tag 1 data size  (1 byte)
+// N+M       tag 1 data       (M bytes, tag 1 data size)
+// .........
+// Z+0       tag 3 type code  (1 byte)
+// Z+1       tag 3 data size  (1 byte)
+// Z+2       tag 3 data       (A bytes, tag 3 data size)
+// QQQQ      tail data      <- format unknown, usually starts from value 0x48, size calculates as (SpecificHeaderSize - 4_tags_size)
+
+
+// structures used directly in file
+#pragma pack(push,1)
+
+typedef struct _InsFileTrailerEntryHeaderType {
+  uint16_t type;              /** Trailer header data type (0x101, 0x200, 0x300, ...) */
+  uint32_t length;            /** Trailer data length, does not include this structure size */
+} InsFileTrailerEntryHeaderType;
+
+typedef struct _InsFileTrailerHeaderType {
+  uint32_t trailer_len;       /** Total length of all trailer data include signatures, headers, etc */
+  uint32_t trailer_version;   /** Trailer version, usually 3 */
+} InsFileTrailerHeaderType;
+
+/** Header for each tag in specific data header */
+typedef struct _InsFileSpecificDataTagHeaderType {
+  uint8_t type_code;          /** Tag type code, value from enum InsFileSpecificHeaderTagTypes */
+  uint8_t data_size;          /** Tag data size */
+} InsFileSpecificDataTagHeaderType;
+
+#pragma pack(pop)
+
+/** Trailer entry types */
+enum InsFileTrailerEntryTypes {
+  kInsTrailerEntryTypeSpecific                 = 0x0101,
+  kInsTrailerEntryTypePreview                  = 0x0200,
+  kInsTrailerEntryTypeImu                      = 0x0300,
+  kInsTrailerEntryTypeExposure                 = 0x0400,
+  kInsTrailerEntryType500                      = 0x0500,
+  kInsTrailerEntryTypeTimestamps               = 0x0600,
+  kInsTrailerEntryTypeGps                      = 0x0700
+};
+
+/** Specific header tag types */
+enum InsFileSpecificHeaderTagTypes {
+  kInsFileSpecificHeaderTagTypeSerial          = 0x0A,
+  kInsFileSpecificHeaderTagTypeModel           = 0x12,
+  kInsFileSpecificHeaderTagTypeFirmware        = 0x1A,
+  kInsFileSpecificHeaderTagTypeOffset          = 0x2A,
+  kInsFileSpecificHeaderTagTypeUnknown         = 0xFF
+};
+
+/** Library error codes */
+enum InsFileErrorCodes {
+  kInsFileOk                                   = 0,
+  kInsFileErrorNotInsFile                      = -1,  /** Insta360 signature not found */
+  kInsFileErrorCorrupted                       = -2,  /** Trailer, entry or tag has wrong format */
+  kInsFileErrorNotFound                        = -3,  /** Requested entry or tag not found */
+  kInsFileErrorIo                              = -4,  /** Read, write or mapping error */
+  kInsFileErrorNoMemory                        = -5,  /** Allocator returned NULL */
+  kInsFileErrorInvalidArgument                 = -6,  /** Wrong argument value */
+  kInsFileErrorMediaCorrupted                  = -7   /** Media region boxes have wrong format or overlap trailer */
+};
+
+#endif  // INS_FILE_FORMAT_HEADER
@@ -13,707 +13,2753 @@
 #include <stdint.h>
 #include <string.h>
 #include <inttypes.h>
-#include "c_vector.h"
-
-const char* kInsFileSignature = "8db42d694ccc418790edff439fe026bf";
-#define kInsFileSignatureLength  32
-#define kInsFileMinHeaderLength  (kInsFileSignatureLength+40)
-
-#define kCopyBufferSize  (512*1024) /* Buffer size for copy media data */
-
-// Some info about Insta360 metadata format can be found here
-// https://fossies.org/linux/Image-ExifTool/lib/Image/ExifTool/QuickTimeStream.pl
-
-// Stitching offset string examples:
-// 2_1497.030_1514.415_1501.982_0.0_0.00_0.000_1491.991_4555.739_1542.696_0.089_-0.077_179.891_6080_3040_2323
-// 2_1646.662_1440.499_1419.611_0.000_0.000_0.000_1654.103_4309.465_1412.394_0.000_0.000_180.000_5760_2880_19
-
-///////////////////
-// File global structure (from start file to end)
-// 0         Media file data (INSV: H.264 video in mp4 container, INSP: JPEG image)
-// NNNN      File trailer (Insta360 metainfo)
-
-///////////////////
-// Trailer structure (from end file to start)
-// 0         File signature       (32 bytes)    8db42d694ccc418790edff439fe026bf
-// 32        InsFileTrailerHeaderType  (8 bytes)
-// 40        padding zero         (32 bytes)
-// 72        InsFileTrailerEntryHeaderType     (6 bytes)
-// 72+N      trailer hdr data         (N bytes)
-// XXX       InsFileTrailerEntryHeaderType     (6 bytes)
-// MMM       trailer hdr data         (M bytes)
-// .........................
-// until trailer size == file pos
-
-
-// Trailer header data format depends on InsFileTrailerEntryHeaderType.type value:
-// 0x101     specific Insta360 info   (contains stitching offset data, serial, camera model, etc)
-// 0x200     ???
-// 0x300     accelerometer and angular velocity info
-// 0x400     exposure time info
-// 0x500     ???
-// 0x600     video timestamps
-// 0x700     GPS data
-
-//////////////////
-// Specific Insta360 trailer header structure
-// 0         tag 0 type code  (1 byte)
-// 1         tag 0 data size  (1 byte)  (value does not include tag data size and type code fields)
-// 2         tag 0 data       (N bytes, tag 0 data size)
-// N+0       tag 1 type code  (1 byte)
-// N+1       tag 1 data size  (1 byte)
-// N+M       tag 1 data       (M bytes, tag 1 data size)
-// .........
-// Z+0       tag 3 type code  (1 byte)
-// Z+1       tag 3 data size  (1 byte)
-// Z+2       tag 3 data       (A bytes, tag 3 data size)
-// QQQQ      tail data      <- format unknown, usually starts from value 0x48, size calculates as (SpecificHeaderSize - 4_tags_size)
-
-
-// structures used directly in file
-#pragma pack(push,1)
-
-typedef struct _InsFileTrailerEntryHeaderType {
-  uint16_t type;              /** Trailer header data type (0x101, 0x200, 0x300, ...) */
-  uint32_t length;            /** Trailer data length, does not include this structure size */
-} InsFileTrailerEntryHeaderType;
-
-typedef struct _InsFileTrailerHeaderType {
-  uint32_t trailer_len;       /** Total length of all trailer data include signatures, headers, etc */
-  uint32_t trailer_version;   /** Trailer version, usually 3 */
-} InsFileTrailerHeaderType;
-
-/** Header for each tag in specific data header */
-typedef struct _InsFileSpecificDataTagHeaderType {
-  uint8_t type_code;          /** Tag type code, value from enum InsFileSpecificHeaderTagTypes */
-  uint8_t data_size;          /** Tag data size */
-} InsFileSpecificDataTagHeaderType;
-
-#pragma pack(pop)
-
-
-// structures for work in RAM
-
-typedef struct _InsTrailerEntryHeaderInfoType {
-  const InsFileTrailerEntryHeaderType* hdr;  /** Pointer to original file entry header in trailer buffer */
-  uint64_t trailer_offset_to_data;           /** Offset to data in trailer buffer */
-} InsTrailerEntryHeaderInfoType;
-
-typedef struct _InsSpecificDataTagHeaderInfoType {
-  int32_t hdr_offset;                        /** Offset in specific data trailer header */
-  InsFileSpecificDataTagHeaderType *hdr;     /** Pointer to original file specific data tag header in trailer buffer */
-  const uint8_t* data;                       /** Pointer to tag data in trailer buffer */
-} InsSpecificDataTagHeaderInfoType;
-
-typedef vector_t(InsSpecificDataTagHeaderInfoType) InsSpecificDataTagHeaderInfoVector;
-typedef vector_t(InsTrailerEntryHeaderInfoType) InsTrailerEntryHeaderInfoVector;
-
-/** Specific header tag types */
-enum InsFileSpecificHeaderTagTypes {
-  kInsFileSpecificHeaderTagTypeSerial          = 0x0A,
-  kInsFileSpecificHeaderTagTypeModel           = 0x12,
-  kInsFileSpecificHeaderTagTypeFirmware        = 0x1A,
-  kInsFileSpecificHeaderTagTypeOffset          = 0x2A,
-  kInsFileSpecificHeaderTagTypeUnknown         = 0xFF
-};
+#include <math.h>
+#include <time.h>
+#include "ins_file.h"
+#include "ins_arena.h"
+#include "ins_buffer_pool.h"
+#include "ins_calibration.h"
+#include "ins_columnar.h"
+#include "ins_digest.h"
+#include "ins_hash.h"
+#include "ins_jpeg.h"
+#include "ins_keyframes.h"
+#include "ins_mp4.h"
+#include "ins_mp4_edit.h"
+#include "ins_output.h"
+#include "ins_stats.h"
+#include "ins_tee.h"
+#include "ins_trailer_delta.h"
+#include "ins_trailer_streams.h"
+
+#define kBatchArenaInitialSize  (64*1024) /* Typical trailer fits, arena grows for larger files */
+
+
+/** Show entry function, data is NULL when entry data was not loaded */
+typedef int (*ShowEntryFunc)(const InsTrailerEntryDescType* desc, const uint8_t* data, uint32_t length);
+
+/** Show entry header only */
+static int show_entry_generic(const InsTrailerEntryDescType* desc, const uint8_t* data, uint32_t length) {
+  (void)data;
+  printf("Found trailer header type %.4X (%s) size %d\n", desc->type, desc->name, length);
+  return 0;
+}
 
-struct InsHdrSpecificTagNameInfoType {
-  uint8_t type;
-  const char* name;
-};
+/** Show records count of time-series entry, computed from entry length */
+static int show_entry_records(const InsTrailerEntryDescType* desc, const uint8_t* data, uint32_t length) {
+  (void)data;
 
-const struct InsHdrSpecificTagNameInfoType kInsSpecificTagNameInfos[] = {
-  { kInsFileSpecificHeaderTagTypeSerial,          "serial" },
-  { kInsFileSpecificHeaderTagTypeFirmware,        "firmware" },
-  { kInsFileSpecificHeaderTagTypeModel,           "model" },
-  { kInsFileSpecificHeaderTagTypeOffset,          "stitching offset" },
-  { kInsFileSpecificHeaderTagTypeUnknown,         "unknown" }   /* 0xFF must be last item */
-};
+  if (length % desc->record_size) {
+    printf("Found trailer header type %.4X (%s) size %d, size is not multiple of record size %d\n", 
+      desc->type, desc->name, length, desc->record_size);
+    return 0;
+  }
 
-/**
- * \brief    Get file size help function
- * \param    file   [in]   File handle
- * \return   File size in bytes
- */
-int64_t get_file_size(FILE* file) {
-  fseek(file, 0, SEEK_END);
-  int64_t file_length = _ftelli64(file);
-  return file_length;
+  printf("Found trailer header type %.4X (%s) size %d, records %d\n", desc->type, desc->name, length, length / desc->record_size);
+  return 0;
 }
 
-/**
- * \brief    Return tag name by tag type code
- * \param    type_code      Tag type code
- * \return   Pointer to zero-terminated string with tag name
- */
-const char* ins_get_header_field_name(uint8_t type_code) {
-  int i;
-  for (i = 0; ; i++) {
-    if (kInsSpecificTagNameInfos[i].type == kInsFileSpecificHeaderTagTypeUnknown)
-      return kInsSpecificTagNameInfos[i].name;
+/** Show specific Insta360 info entry tags */
+int show_entry_specific(const InsTrailerEntryDescType* desc, const uint8_t* data, uint32_t length) {
+  InsEntryViewType entry;
+  InsTagIteratorType iterator;
+  InsTagViewType tag;
+  int tags_count = 0;
+  int result;
 
-    if (kInsSpecificTagNameInfos[i].type == type_code)
-      return kInsSpecificTagNameInfos[i].name;
-  }
-}
+  entry.type = desc->type;
+  entry.trailer_offset = 0;
+  entry.data = ins_byte_view(data, length);
 
-/** 
- * \brief    Check file signature and read minimal header (72 bytes)
- * \param    file                 [in]  Input file handle
- * \param    out_minimal_header   [out] Output buffer, function stores minimal header here
- * \return   0 - success, negative - fail
- */
-int ins_find_and_read_minimal_header(FILE* file, uint8_t out_minimal_header[kInsFileMinHeaderLength]) {
-  int64_t file_length = get_file_size(file);
+  printf("Found specific trailer header, type %.4X size %d\n", desc->type, length);
 
-  if (file_length < kInsFileMinHeaderLength)
-    return -1;
+  ins_tag_iterator_begin(&iterator);
+  while ((result = ins_entry_view_next_tag(&entry, &iterator, &tag)) > 0)
+    tags_count++;
 
-  char ins_signature_buffer[kInsFileSignatureLength];
+  if (result < 0) {
+    printf("Process header error, wrong file format\n");
+    return -3;
+  }
 
-  fseek(file, -kInsFileSignatureLength, SEEK_END);
-  size_t actual_read = fread(ins_signature_buffer, 1, kInsFileSignatureLength, file);
+  printf("Specific trailer decoded successully, tags count %d, tail size %d\n", tags_count, ins_entry_view_tail(&entry, &iterator).size);
 
-  if (actual_read != kInsFileSignatureLength)
-    return -1;
+  ins_tag_iterator_begin(&iterator);
+  while (ins_entry_view_next_tag(&entry, &iterator, &tag) > 0) {
+    printf("*** Tag type: %.2X (%s), size: %d, hdr offset: %d\n", 
+      tag.type_code, 
+      ins_get_header_field_name(tag.type_code), 
+      tag.data.size, 
+      tag.entry_offset);
 
-  if (memcmp(ins_signature_buffer, kInsFileSignature, kInsFileSignatureLength))
-    return -1;
+    printf("    Data: ");
 
-  fseek(file, -kInsFileMinHeaderLength, SEEK_END);
+    // show tag bytes
+    for (uint32_t k = 0; k < tag.data.size; k++)
+      printf("%c", tag.data.data[k]);
 
-  actual_read = fread(out_minimal_header, 1, kInsFileMinHeaderLength, file);
-  if (actual_read != kInsFileMinHeaderLength)
-    return -1;
+    printf("\n");
+  }
 
   return 0;
 }
 
-/**
- * \brief    Decode trailer specific header
- * \param    hdr_data           [in]  Input trailer header data
- * \param    hdr_size           [in]  Input trailer header data size
- * \param    out_hdr_elements   [out] Vector for save found specific header tags
- * \param    out_tail_ptr       [out] Function saves pointer to tail. Pointed to hdr_data buffer
- * \param    out_tail_size      [out] Function saves tail size
- * \return   0 - success, negative - fail
- */
-int ins_decode_trailer_specific_header(
-  const uint8_t* hdr_data, 
-  int32_t hdr_size, 
-  InsSpecificDataTagHeaderInfoVector* out_hdr_elements, 
-  const uint8_t** out_tail_ptr, 
-  int* out_tail_size) {
-
-  const int kMaxTagsCount = 4; /* Usually specific header contains 4 tags and tail data */
-  int32_t position = 0;
-  int hdr_elements_count = 0;
+/** Choose show function for entry description */
+ShowEntryFunc get_entry_show_func(const InsTrailerEntryDescType* desc) {
+  if (desc->type == kInsTrailerEntryTypeSpecific)
+    return show_entry_specific;
 
-  int bytes_left = hdr_size - position;
+  if (desc->record_size)
+    return show_entry_records;
 
-  for(int i=0; i<kMaxTagsCount; i++) {
-    InsSpecificDataTagHeaderInfoType hdr_elem;
-    int32_t element_offset = position;
+  return show_entry_generic;
+}
 
-    InsFileSpecificDataTagHeaderType* tag_hdr = (InsFileSpecificDataTagHeaderType*)(hdr_data + position);
-    position += sizeof(InsFileSpecificDataTagHeaderType);
+/** Duration in seconds, 0 when timescale is not set */
+double media_duration_seconds(uint64_t duration, uint32_t timescale) {
+  return timescale ? (double)duration / timescale : 0.0;
+}
 
-    /* check header */
-    if (tag_hdr->data_size > bytes_left)
-      return -1; /* tag size greater than bytes left in header buffer */
+/** Print GPano number property, missing property (-1) is not printed */
+void show_gpano_number(const char* name, int64_t value, int* shown_count) {
+  if (value < 0)
+    return;
 
-    hdr_elem.hdr = tag_hdr;
-    hdr_elem.hdr_offset = element_offset;
-    hdr_elem.data = hdr_data+position;
+  printf("%s %s %" PRId64, *shown_count ? "," : "", name, value);
+  (*shown_count)++;
+}
 
-    vector_push(InsSpecificDataTagHeaderInfoType, out_hdr_elements, hdr_elem);
-    ++hdr_elements_count;
+/** Show JPEG segments and metadata of INSP media region */
+int show_jpeg_info(FILE* file, int64_t media_size) {
+  InsJpegInfoType jpeg;
 
-    position += tag_hdr->data_size;
-    bytes_left = hdr_size - position;
+  int result = ins_jpeg_read_info(file, media_size, &kInsDefaultAllocator, &jpeg);
 
-    if (position >= hdr_size)
-      break;
+  if (result == kInsFileErrorNotFound) {
+    printf("Media data is not mp4 or jpeg, size %" PRId64 "\n", media_size);
+    return 0;
   }
 
-  *out_tail_size = bytes_left;
-  *out_tail_ptr = hdr_data + position;
-
-  return hdr_elements_count;
-}
-
-/**
- * \brief    Decode trailer data, save trailer entries information
- * \param    trailer_data    [in]  Trailer data buffer
- * \param    trailer_info    [in]  Trailer information structure
- * \param    out_trailer_hdr_iterms  [out]  Function saves found trailer entries information to vector
- * \return   0 - success, negative - fail
- */
-int ins_decode_trailer_data(
-  const uint8_t* trailer_data, 
-  const InsFileTrailerHeaderType* trailer_info, 
-  InsTrailerEntryHeaderInfoVector* out_trailer_hdr_items) {
+  if (result < 0) {
+    printf("Media check failed: %s\n", ins_file_error_string(result));
+    return -5;
+  }
 
-  const InsFileTrailerEntryHeaderType* trailer_hdr;
-  uint32_t trailer_read_pos = kInsFileMinHeaderLength;
+  printf("Media jpeg, size %" PRId64 ", segments %d, scan offset %" PRId64 ", %ux%u, %s\n", jpeg.media_size,
+    jpeg.segments_count, jpeg.scan_offset, jpeg.width, jpeg.height,
+    jpeg.ends_with_eoi ? "EOI at trailer start" : "no EOI at trailer start");
 
-  // find trailer headers
-  while (trailer_read_pos < trailer_info->trailer_len) {
-    const uint8_t* trailer_data_ptr = trailer_data + trailer_info->trailer_len - trailer_read_pos - sizeof(InsFileTrailerEntryHeaderType);
-    InsTrailerEntryHeaderInfoType hdr_info;
+  if (jpeg.has_exif)
+    printf("*** EXIF: make '%s', model '%s', capture time '%s'\n", jpeg.make, jpeg.model, jpeg.capture_time);
 
-    trailer_hdr = (const InsFileTrailerEntryHeaderType*)trailer_data_ptr;
+  if (jpeg.has_xmp) {
+    const InsJpegGPanoType* gpano = &jpeg.gpano;
 
-    hdr_info.hdr = trailer_hdr;
-    hdr_info.trailer_offset_to_data = trailer_info->trailer_len - trailer_read_pos - trailer_hdr->length - sizeof(InsFileTrailerEntryHeaderType);
+    int shown_count = 0;
 
-    vector_push(InsTrailerEntryHeaderInfoType, out_trailer_hdr_items, hdr_info);
-    trailer_read_pos += trailer_hdr->length + sizeof(InsFileTrailerEntryHeaderType);
+    printf("*** XMP GPano:");
+    if (gpano->projection_type[0]) {
+      printf(" projection '%s'", gpano->projection_type);
+      shown_count++;
+    }
+    show_gpano_number("full pano width", gpano->full_pano_width, &shown_count);
+    show_gpano_number("full pano height", gpano->full_pano_height, &shown_count);
+    show_gpano_number("cropped width", gpano->cropped_width, &shown_count);
+    show_gpano_number("cropped height", gpano->cropped_height, &shown_count);
+    show_gpano_number("cropped left", gpano->cropped_left, &shown_count);
+    show_gpano_number("cropped top", gpano->cropped_top, &shown_count);
+    printf(shown_count ? "\n" : " no properties\n");
   }
 
-  /* check that all headers was processed successfully: 
-     calculated size must be equal to length from trailer information */
-  if (trailer_read_pos != trailer_info->trailer_len)
-    return -1;
-
   return 0;
 }
 
-/**
- * \brief    Free trailer buffer
- * \param    trailer_buf    [in]   Trailer buffer allocated by function ins_read_allocate_trailer
- */
-void ins_free_trailer_buffer(uint8_t* trailer_buf) {
-  free(trailer_buf);
-}
+/** Show media region boxes and tracks */
+int show_media_info(FILE* file, int64_t media_size) {
+  InsMp4InfoType media;
+  char fourcc[5];
+  char codec[5];
 
-/**
- * \brief    Find trailer size, allocate buffer and read full file trailer to allocated buffer
- * \param    file   File descriptor
- * \param    out_trailer_data   [out]  Function saves pointer to allocated buffer with trailer data
- * \param    out_trailer_info   [out]  Function saves information structure about trailer
- * \return   0 - success, negative value - error
- */
-int ins_read_allocate_trailer(FILE* file, uint8_t** out_trailer_data, InsFileTrailerHeaderType* out_trailer_info) {
-  uint8_t minimal_ins_header_data[kInsFileMinHeaderLength];
-  size_t actual_read;
+  int result = ins_mp4_read_info(file, media_size, &kInsDefaultAllocator, &media);
 
-  /* 1. Read and check minimal trailer information
-     2. Take full trailer size from minimal header, allocate buffer and read full trailer */
+  if (result == kInsFileErrorNotFound)
+    return show_jpeg_info(file, media_size);
 
-  if (ins_find_and_read_minimal_header(file, minimal_ins_header_data) < 0)
-    return -1;  /* minimal header not found */
-  
-  InsFileTrailerHeaderType* trailer_info = (InsFileTrailerHeaderType*)(
-    minimal_ins_header_data + kInsFileMinHeaderLength - kInsFileSignatureLength - sizeof(InsFileTrailerHeaderType));
+  if (result < 0) {
+    printf("Media check failed: %s\n", ins_file_error_string(result));
+    return -5;
+  }
 
-  uint8_t* trailer_data = (uint8_t*)malloc(trailer_info->trailer_len);
-  fseek(file, -((int32_t)trailer_info->trailer_len), SEEK_END);
+  printf("Media mp4, brand %s, boxes %d, mdat offset %" PRId64 " size %" PRId64 ", moov offset %" PRId64 " size %" PRId64 "\n", 
+    ins_mp4_fourcc_string(media.major_brand, fourcc), media.boxes_count, media.mdat.offset, media.mdat.size, 
+    media.moov.offset, media.moov.size);
+  printf("Media duration %.3f s, tracks %d\n", media_duration_seconds(media.duration, media.timescale), media.tracks_count);
 
-  /* read full trailer data */
-  actual_read = fread(trailer_data, 1, trailer_info->trailer_len, file);
-  if (trailer_info->trailer_len > actual_read)
-    return -2; // cannot read data
+  for (int i = 0; i < media.tracks_count && i < kInsMp4MaxTracks; i++) {
+    const InsMp4TrackType* track = &media.tracks[i];
 
-  *out_trailer_info = *trailer_info;
-  *out_trailer_data = trailer_data;
+    printf("*** Track %d: %s, codec %s, %dx%d, duration %.3f s\n", track->track_id, 
+      ins_mp4_fourcc_string(track->handler, fourcc), ins_mp4_fourcc_string(track->codec, codec),
+      track->width, track->height, media_duration_seconds(track->duration, track->timescale));
+  }
 
   return 0;
 }
 
-/**
- * \brief    Change stitching offset tag value in specific Insta360 trailer entry. Function rebuilds trailer header, 
- *           new header buffer will be allocated and must be freed by caller
- * \param    in_trailer_hdr       [in]  Buffer contains specific trailer entry header data
- * \param    in_trailer_hdr_size  [in]  Size of specific trailer entry header data
- * \param    new_offset           [in]  Zero-terminated string contains new stitching offset value
- * \param    out_trailer_hdr      [out] Output trailer header buffer (allocated)
- * \param    out_trailer_hdr_size [out] Function saves output trailer header size
- * \return   0 - success, negative - fail
- */
-int ins_change_stitching_offset(
-  const uint8_t* in_trailer_hdr, 
-  int in_trailer_hdr_size, 
-  const char* new_offset, 
-  uint8_t** out_trailer_hdr, 
-  int* out_trailer_hdr_size) {
+/** Show info mode */
+int run_show_info(const char* param_file_in) {
+  printf("Use file: %s\n", param_file_in);
+
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file\n");
+    return -2;
+  }
 
-  InsSpecificDataTagHeaderInfoVector spec_hdr_elements;
-  vector_init(&spec_hdr_elements);
+  /* read data only for entries which descriptions need full payload, other entries are shown by header */
+  uint32_t wanted_types_mask = 0;
+  for (int i = 0; i < kInsTrailerEntryDescsCount; i++) {
+    if (kInsTrailerEntryDescs[i].flags & kInsEntryLoadFlagFullPayload)
+      wanted_types_mask |= kInsTrailerEntryTypeBit(kInsTrailerEntryDescs[i].type);
+  }
 
-  const uint8_t* tail_ptr;
-  int tail_size;
+  InsTrailerReadPlanType plan;
+  ins_trailer_read_plan_init(&plan, &kInsDefaultAllocator);
 
-  if (ins_decode_trailer_specific_header(in_trailer_hdr, in_trailer_hdr_size, &spec_hdr_elements, &tail_ptr, &tail_size) < 0) {
-    printf("Process header error, wrong file format\n");
+  if (ins_plan_trailer_reads(file, wanted_types_mask, &plan) < 0) {
+    printf("Cannot decode file header\n");
+    ins_trailer_read_plan_destroy(&plan);
+    fclose(file);
     return -3;
   }
 
-  /* find current stitching offset size */
-  int stitching_offset_current_size = 0;
+  printf("INS trailer version: %d, length: %d\n", plan.trailer_info.trailer_version, plan.trailer_info.trailer_len);
 
-  for (int i = 0; i < vector_size(&spec_hdr_elements); i++) {
-    InsSpecificDataTagHeaderInfoType* spec_hdr_elem = &vector_at(&spec_hdr_elements, i);
-    if (spec_hdr_elem->hdr->type_code == kInsFileSpecificHeaderTagTypeOffset) {
-      stitching_offset_current_size = spec_hdr_elem->hdr->data_size;
-      break;
-    }
+  InsMappedTrailerType trailer;
+
+  if (ins_map_trailer(file, &plan, &trailer) < 0) {
+    printf("Cannot read trailer\n");
+    ins_trailer_read_plan_destroy(&plan);
+    fclose(file);
+    return -4;
+  }
+
+  printf("Trailer decoded successfully, entrys count %d\n", ins_small_vector_size(&plan.entries));
+
+  int error = 0;
+
+  for (int i = 0; i < ins_small_vector_size(&plan.entries) && !error; i++) {
+    InsTrailerEntryLocationType* location = &ins_small_vector_at(&plan.entries, i);
+    const InsTrailerEntryDescType* desc = ins_get_trailer_entry_desc(location->type);
+    const uint8_t* entry_data = NULL;
+
+    printf("Tail entry header found, type %.4X, size %d, offset in trailer %d\n", 
+      location->type, location->length, (int)(location->file_offset - trailer.file_offset));
+
+    /* show functions work directly on mapped pages */
+    if (ins_plan_entry_needs_load(&plan, location))
+      entry_data = ins_mapped_trailer_entry_data(&trailer, location);
+
+    if (get_entry_show_func(desc)(desc, entry_data, location->length) < 0)
+      error = -3;
   }
 
-  /* rebuild header with new offset */
-  int new_offset_size = (int)strlen(new_offset);
+  if (!error)
+    error = show_media_info(file, plan.file_length - plan.trailer_info.trailer_len);
+
+  ins_unmap_trailer(&trailer);
+  ins_trailer_read_plan_destroy(&plan);
+  fclose(file);
+
+  if (!error)
+    printf("Done!\n");
 
-  int new_header_size = in_trailer_hdr_size - stitching_offset_current_size + new_offset_size;
+  return error;
+}
+
+/** Output formats of show info mode */
+enum OutputFormats {
+  kOutputFormatText                            = 0,  /** Human readable text */
+  kOutputFormatNdjson                          = 1,  /** One JSON object per line */
+  kOutputFormatJson                            = 2,  /** JSON array of objects */
+  kOutputFormatCsv                             = 3   /** CSV with header row */
+};
+
+#define kInfoOutputBufferSize  (256*1024)
+
+/** Structured show info state, reused for all files */
+typedef struct _InfoFormatContextType {
+  int format;                                /** Value from enum OutputFormats */
+  InsOutputBufferType out;                   /** Output buffer, written to stdout */
+  InsTrailerReadPlanType plan;               /** Read plan reused for all files */
+  int records_count;                         /** Written records */
+  int errors_count;                          /** Files with errors */
+} InfoFormatContextType;
+
+/** Decoded show info record fields */
+typedef struct _InfoRecordType {
+  int error;                                 /** Error code, 0 - success */
+  InsFileTrailerHeaderType trailer_info;     /** Trailer information */
+  InsByteViewType tags[4];                   /** Serial, model, firmware and stitching offset tag data */
+  int media_error;                           /** Media region error, kInsFileErrorNotFound - media is not mp4 */
+  InsMp4InfoType media;                      /** Media region structure, valid when media_error is 0 */
+  int jpeg_error;                            /** JPEG media error when media is not mp4, kInsFileErrorNotFound - not JPEG */
+  InsJpegInfoType jpeg;                      /** JPEG media structure, valid when jpeg_error is 0 */
+} InfoRecordType;
+
+static const uint8_t kInfoRecordTagTypes[4] = {
+  kInsFileSpecificHeaderTagTypeSerial, kInsFileSpecificHeaderTagTypeModel, 
+  kInsFileSpecificHeaderTagTypeFirmware, kInsFileSpecificHeaderTagTypeOffset
+};
+
+static const char* const kInfoRecordTagNames[4] = { "serial", "model", "firmware", "offset" };
 
-  uint8_t* new_trailer_hdr = (uint8_t*)malloc(new_header_size);
-  memset(new_trailer_hdr, 0, new_header_size);
-  int new_trailer_hdr_pos = 0;
+/** Write stitching offset fields as JSON numbers array (exact values, no float conversion), null when offset has wrong format */
+void write_offset_values_json(InsOutputBufferType* out, InsByteViewType offset_data) {
+  InsStitchingOffsetType offset;
+  char number[32];
 
-  for (int i = 0; i < vector_size(&spec_hdr_elements); i++) {
-    InsSpecificDataTagHeaderInfoType* spec_hdr_elem = &vector_at(&spec_hdr_elements, i);
+  if (ins_parse_stitching_offset((const char*)offset_data.data, offset_data.size, &offset) < 0) {
+    ins_output_string(out, "null");
+    return;
+  }
 
-    InsFileSpecificDataTagHeaderType* new_spec_data_tag_hdr = (InsFileSpecificDataTagHeaderType*)(
-      new_trailer_hdr + new_trailer_hdr_pos);
+  ins_output_char(out, '[');
+  ins_output_int64(out, offset.lens_count);
 
-    new_spec_data_tag_hdr->type_code = spec_hdr_elem->hdr->type_code;
-    new_trailer_hdr_pos += sizeof(InsFileSpecificDataTagHeaderType);
+  for (int i = 0; i < offset.lens_count; i++) {
+    const InsStitchingLensType* lens = &offset.lenses[i];
+    const InsDecimalType fields[6] = { 
+      lens->center_x, lens->center_y, lens->radius, lens->rotation[0], lens->rotation[1], lens->rotation[2] 
+    };
 
-    if (spec_hdr_elem->hdr->type_code == kInsFileSpecificHeaderTagTypeOffset) {
-      /* tag type is kInsHeaderFieldTypeStitchingOffset, replace with new value */
-      new_spec_data_tag_hdr->data_size = new_offset_size;
-      memcpy(new_trailer_hdr + new_trailer_hdr_pos, new_offset, new_offset_size);
-      new_trailer_hdr_pos += new_offset_size;
-    }  else {
-      /* tag type is not kInsHeaderFieldTypeStitchingOffset, copy it as is */
-      new_spec_data_tag_hdr->data_size = spec_hdr_elem->hdr->data_size;
-      memcpy(new_trailer_hdr + new_trailer_hdr_pos, spec_hdr_elem->data, spec_hdr_elem->hdr->data_size);
-      new_trailer_hdr_pos += spec_hdr_elem->hdr->data_size;
+    for (int j = 0; j < 6; j++) {
+      ins_output_char(out, ',');
+      ins_output_write(out, number, ins_format_decimal(fields[j], number));
     }
   }
 
-  /* file did not contain stitching offset parameter - add it */
-  if (stitching_offset_current_size == 0) {
-    InsFileSpecificDataTagHeaderType new_tag_hdr;
-    new_tag_hdr.type_code = kInsFileSpecificHeaderTagTypeOffset;
-    new_tag_hdr.data_size = new_offset_size;
+  ins_output_char(out, ',');
+  ins_output_int64(out, offset.width);
+  ins_output_char(out, ',');
+  ins_output_int64(out, offset.height);
+  ins_output_char(out, ',');
+  ins_output_int64(out, offset.id);
+  ins_output_char(out, ']');
+}
 
-    memcpy(new_trailer_hdr + new_trailer_hdr_pos, &new_tag_hdr, sizeof(InsFileSpecificDataTagHeaderType));
-    new_trailer_hdr_pos += sizeof(InsFileSpecificDataTagHeaderType);
+/** Media duration in milliseconds, exact integer instead of float seconds */
+int64_t media_duration_ms(uint64_t duration, uint32_t timescale) {
+  return timescale ? (int64_t)(duration * 1000 / timescale) : 0;
+}
 
-    memcpy(new_trailer_hdr + new_trailer_hdr_pos, new_offset, new_offset_size);
-    new_trailer_hdr_pos += new_offset_size;
+/** Write media properties of video track as JSON object field */
+void write_media_json(InsOutputBufferType* out, const InsMp4InfoType* media) {
+  int video = ins_mp4_find_track(media, kInsMp4HandlerVideo);
+  char codec[5];
+
+  ins_output_string(out, ",\"media\":{\"duration_ms\":");
+  ins_output_int64(out, media_duration_ms(media->duration, media->timescale));
+  ins_output_string(out, ",\"tracks\":");
+  ins_output_int64(out, media->tracks_count);
+
+  if (video >= 0) {
+    const InsMp4TrackType* track = &media->tracks[video];
+
+    ins_output_string(out, ",\"codec\":");
+    ins_output_json_string(out, ins_mp4_fourcc_string(track->codec, codec), 4);
+    ins_output_string(out, ",\"width\":");
+    ins_output_int64(out, track->width);
+    ins_output_string(out, ",\"height\":");
+    ins_output_int64(out, track->height);
   }
 
-  memcpy(new_trailer_hdr + new_trailer_hdr_pos, tail_ptr, tail_size);
+  ins_output_char(out, '}');
+}
 
-  *out_trailer_hdr = new_trailer_hdr;
-  *out_trailer_hdr_size = new_header_size;
+/** Write optional JSON string field, skipped when value is empty */
+void write_text_field_json(InsOutputBufferType* out, const char* name, const char* value) {
+  if (!value[0])
+    return;
 
-  return 0;
+  ins_output_string(out, name);
+  ins_output_json_string(out, value, strlen(value));
 }
 
-/** Show info mode */
-int run_show_info(const char* param_file_in) {
-  printf("Use file: %s\n", param_file_in);
+/** Write optional JSON number field, skipped when value is negative (not present) */
+void write_number_field_json(InsOutputBufferType* out, const char* name, int64_t value) {
+  if (value < 0)
+    return;
 
-  FILE* file = fopen(param_file_in, "rb");
-  if (!file) {
-    printf("Cannot open file\n");
-    return -2;
+  ins_output_string(out, name);
+  ins_output_int64(out, value);
+}
+
+/** Write JPEG properties of INSP media as JSON object field */
+void write_jpeg_json(InsOutputBufferType* out, const InsJpegInfoType* jpeg) {
+  const InsJpegGPanoType* gpano = &jpeg->gpano;
+
+  ins_output_string(out, ",\"jpeg\":{\"width\":");
+  ins_output_int64(out, jpeg->width);
+  ins_output_string(out, ",\"height\":");
+  ins_output_int64(out, jpeg->height);
+  ins_output_string(out, jpeg->ends_with_eoi ? ",\"eoi_at_trailer\":true" : ",\"eoi_at_trailer\":false");
+  write_text_field_json(out, ",\"capture_time\":", jpeg->capture_time);
+  write_text_field_json(out, ",\"make\":", jpeg->make);
+  write_text_field_json(out, ",\"model\":", jpeg->model);
+
+  if (jpeg->has_xmp) {
+    ins_output_string(out, ",\"gpano\":{");
+    ins_output_string(out, "\"projection_type\":");
+    ins_output_json_string(out, gpano->projection_type, strlen(gpano->projection_type));
+    write_number_field_json(out, ",\"full_pano_width\":", gpano->full_pano_width);
+    write_number_field_json(out, ",\"full_pano_height\":", gpano->full_pano_height);
+    write_number_field_json(out, ",\"cropped_width\":", gpano->cropped_width);
+    write_number_field_json(out, ",\"cropped_height\":", gpano->cropped_height);
+    write_number_field_json(out, ",\"cropped_left\":", gpano->cropped_left);
+    write_number_field_json(out, ",\"cropped_top\":", gpano->cropped_top);
+    ins_output_char(out, '}');
   }
 
-  uint8_t* trailer_data;
-  InsFileTrailerHeaderType trailer_info;
+  ins_output_char(out, '}');
+}
 
-  if (ins_read_allocate_trailer(file, &trailer_data, &trailer_info) < 0) {
-    printf("Cannot decode file header\n");
-    return -3;
+/** Write one record in JSON (NDJSON line or JSON array item) */
+void write_info_record_json(InfoFormatContextType* context, const char* path, const InfoRecordType* record, const InsMappedTrailerType* trailer) {
+  InsOutputBufferType* out = &context->out;
+
+  if (context->format == kOutputFormatJson)
+    ins_output_string(out, context->records_count ? ",\n  " : "  ");
+
+  ins_output_string(out, "{\"file\":");
+  ins_output_json_string(out, path, strlen(path));
+
+  if (record->error) {
+    ins_output_string(out, ",\"error\":");
+    ins_output_json_string(out, ins_file_error_string(record->error), strlen(ins_file_error_string(record->error)));
+    ins_output_char(out, '}');
+  } else {
+    ins_output_string(out, ",\"trailer_version\":");
+    ins_output_int64(out, record->trailer_info.trailer_version);
+    ins_output_string(out, ",\"trailer_len\":");
+    ins_output_int64(out, record->trailer_info.trailer_len);
+    ins_output_string(out, ",\"entries\":[");
+
+    for (int i = 0; i < ins_small_vector_size(&context->plan.entries); i++) {
+      const InsTrailerEntryLocationType* location = &ins_small_vector_at(&context->plan.entries, i);
+      const InsTrailerEntryDescType* desc = ins_get_trailer_entry_desc(location->type);
+
+      ins_output_string(out, i ? ",{\"type\":\"0x" : "{\"type\":\"0x");
+      ins_output_hex16(out, location->type);
+      ins_output_string(out, "\",\"name\":\"");
+      ins_output_string(out, desc->name);
+      ins_output_string(out, "\",\"size\":");
+      ins_output_int64(out, location->length);
+      ins_output_string(out, ",\"offset\":");
+      ins_output_int64(out, location->file_offset - trailer->file_offset);
+
+      if (desc->record_size && location->length % desc->record_size == 0) {
+        ins_output_string(out, ",\"records\":");
+        ins_output_int64(out, location->length / desc->record_size);
+      }
+
+      ins_output_char(out, '}');
+    }
+
+    ins_output_char(out, ']');
+
+    for (int i = 0; i < 4; i++) {
+      if (!record->tags[i].data)
+        continue;
+
+      ins_output_string(out, ",\"");
+      ins_output_string(out, kInfoRecordTagNames[i]);
+      ins_output_string(out, "\":");
+      ins_output_json_string(out, (const char*)record->tags[i].data, record->tags[i].size);
+    }
+
+    if (record->tags[3].data) {
+      ins_output_string(out, ",\"offset_values\":");
+      write_offset_values_json(out, record->tags[3]);
+    }
+
+    if (!record->media_error) {
+      write_media_json(out, &record->media);
+    } else if (record->media_error != kInsFileErrorNotFound) {
+      ins_output_string(out, ",\"media_error\":");
+      ins_output_json_string(out, ins_file_error_string(record->media_error), strlen(ins_file_error_string(record->media_error)));
+    } else if (!record->jpeg_error) {
+      write_jpeg_json(out, &record->jpeg);
+    } else if (record->jpeg_error != kInsFileErrorNotFound) {
+      ins_output_string(out, ",\"media_error\":");
+      ins_output_json_string(out, ins_file_error_string(record->jpeg_error), strlen(ins_file_error_string(record->jpeg_error)));
+    }
+
+    ins_output_char(out, '}');
   }
 
-  printf("INS trailer version: %d, length: %d\n", trailer_info.trailer_version, trailer_info.trailer_len);
+  if (context->format == kOutputFormatNdjson)
+    ins_output_char(out, '\n');
+}
+
+/** Write one CSV row */
+void write_info_record_csv(InfoFormatContextType* context, const char* path, const InfoRecordType* record) {
+  InsOutputBufferType* out = &context->out;
+  const char* error = record->error ? ins_file_error_string(record->error) : "";
+
+  ins_output_csv_field(out, path, strlen(path));
+  ins_output_char(out, ',');
+  ins_output_csv_field(out, error, strlen(error));
+  ins_output_char(out, ',');
+
+  if (!record->error) {
+    ins_output_int64(out, record->trailer_info.trailer_version);
+    ins_output_char(out, ',');
+    ins_output_int64(out, record->trailer_info.trailer_len);
+    ins_output_char(out, ',');
+
+    /* entries column: space separated type:size pairs */
+    for (int i = 0; i < ins_small_vector_size(&context->plan.entries); i++) {
+      const InsTrailerEntryLocationType* location = &ins_small_vector_at(&context->plan.entries, i);
+
+      if (i)
+        ins_output_char(out, ' ');
+      ins_output_hex16(out, location->type);
+      ins_output_char(out, ':');
+      ins_output_int64(out, location->length);
+    }
+  } else {
+    ins_output_string(out, ",,");
+  }
 
-  InsTrailerEntryHeaderInfoVector trailer_hdr_infos;
-  vector_init(&trailer_hdr_infos);
+  for (int i = 0; i < 4; i++) {
+    ins_output_char(out, ',');
+    if (record->tags[i].data)
+      ins_output_csv_field(out, (const char*)record->tags[i].data, record->tags[i].size);
+  }
 
-  if (ins_decode_trailer_data(trailer_data, &trailer_info, &trailer_hdr_infos) < 0) {
-    printf("Cannot decode trailer header\n");
-    ins_free_trailer_buffer(trailer_data);
-    return -4;
+  /* media columns: duration_ms, codec, width, height, empty when media is not mp4 */
+  int video = record->error || record->media_error ? -1 : ins_mp4_find_track(&record->media, kInsMp4HandlerVideo);
+
+  if (video >= 0) {
+    const InsMp4TrackType* track = &record->media.tracks[video];
+    char codec[5];
+
+    ins_output_char(out, ',');
+    ins_output_int64(out, media_duration_ms(record->media.duration, record->media.timescale));
+    ins_output_char(out, ',');
+    ins_output_csv_field(out, ins_mp4_fourcc_string(track->codec, codec), 4);
+    ins_output_char(out, ',');
+    ins_output_int64(out, track->width);
+    ins_output_char(out, ',');
+    ins_output_int64(out, track->height);
+  } else {
+    ins_output_string(out, ",,,,");
   }
 
-  printf("Trailer decoded successfully, entrys count %d\n", vector_size(&trailer_hdr_infos));
+  ins_output_char(out, '\n');
+}
 
-  InsSpecificDataTagHeaderInfoVector spec_hdr_elements;
-  vector_init(&spec_hdr_elements);
+/** Read file trailer and write one structured record */
+void write_info_record(InfoFormatContextType* context, const char* path) {
+  InfoRecordType record;
+  InsMappedTrailerType trailer;
+  int mapped = 0;
 
-  const uint8_t* tail_ptr;
-  int tail_size;
+  memset(&record, 0, sizeof(record));
+  ins_small_vector_clear(&context->plan.entries);
 
-  for (int i = 0; i < vector_size(&trailer_hdr_infos); i++) {
-    InsTrailerEntryHeaderInfoType* hdr_info = &vector_at(&trailer_hdr_infos, i);
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    record.error = kInsFileErrorIo;
 
-    printf("Tail entry header found, type %.4X, size %d, offset in trailer %d\n", 
-      hdr_info->hdr->type, hdr_info->hdr->length, (int)hdr_info->trailer_offset_to_data);
-
-    switch (hdr_info->hdr->type) {
-    case 0x0101:
-      printf("Found specific trailer header, type %.4X size %d\n", hdr_info->hdr->type, hdr_info->hdr->length);
-
-      if (0 > ins_decode_trailer_specific_header(trailer_data + hdr_info->trailer_offset_to_data, 
-                                                 hdr_info->hdr->length, 
-                                                 &spec_hdr_elements, 
-                                                 &tail_ptr, 
-                                                 &tail_size)) {
-        printf("Process header error, wrong file format\n");
-        ins_free_trailer_buffer(trailer_data);
-        return -3;
-      }
+  if (!record.error)
+    record.error = ins_plan_trailer_reads(file, kInsTrailerEntryTypeBit(kInsTrailerEntryTypeSpecific), &context->plan);
 
-      printf("Specific trailer decoded successully, tags count %d, tail size %d\n", vector_size(&spec_hdr_elements), tail_size);
+  if (!record.error) {
+    record.error = ins_map_trailer(file, &context->plan, &trailer);
+    mapped = !record.error;
+  }
 
-      for (int j = 0; j < vector_size(&spec_hdr_elements); j++) {
-        InsSpecificDataTagHeaderInfoType* spec_hdr = &vector_at(&spec_hdr_elements, j);
+  if (!record.error) {
+    record.trailer_info = context->plan.trailer_info;
 
-        printf("*** Tag type: %.2X (%s), size: %d, hdr offset: %d\n", 
-          spec_hdr->hdr->type_code, 
-          ins_get_header_field_name(spec_hdr->hdr->type_code), 
-          spec_hdr->hdr->data_size, 
-          spec_hdr->hdr_offset);
+    for (int i = 0; i < ins_small_vector_size(&context->plan.entries); i++) {
+      const InsTrailerEntryLocationType* location = &ins_small_vector_at(&context->plan.entries, i);
+      InsEntryViewType entry;
+      InsTagViewType tag;
 
-        printf("    Data: ");
+      if (location->type != kInsTrailerEntryTypeSpecific)
+        continue;
 
-        // show tag bytes
-        for (int k = 0; k < spec_hdr->hdr->data_size; k++)
-          printf("%c", spec_hdr->data[k]);
+      entry.type = location->type;
+      entry.trailer_offset = (uint32_t)(location->file_offset - trailer.file_offset);
+      entry.data = ins_byte_view(ins_mapped_trailer_entry_data(&trailer, location), location->length);
 
-        printf("\n");
+      for (int t = 0; t < 4; t++) {
+        if (ins_entry_view_find_tag(&entry, kInfoRecordTagTypes[t], &tag) == 0)
+          record.tags[t] = tag.data;
       }
-
-      break;
-    default:
-      printf("Found trailer header type %.4X size %d\n", hdr_info->hdr->type, hdr_info->hdr->length);
-      break;
     }
+
+    int64_t media_size = context->plan.file_length - context->plan.trailer_info.trailer_len;
+
+    record.media_error = ins_mp4_read_info(file, media_size, &kInsDefaultAllocator, &record.media);
+    record.jpeg_error = kInsFileErrorNotFound;
+    if (record.media_error == kInsFileErrorNotFound)
+      record.jpeg_error = ins_jpeg_read_info(file, media_size, &kInsDefaultAllocator, &record.jpeg);
   }
 
-  ins_free_trailer_buffer(trailer_data);
-  fclose(file);
-  printf("Done!\n");
+  /* tag views point to mapped trailer, write record before unmap */
+  if (context->format == kOutputFormatCsv)
+    write_info_record_csv(context, path, &record);
+  else
+    write_info_record_json(context, path, &record, &trailer);
 
+  context->records_count++;
+  context->errors_count += record.error != 0 || (record.media_error && record.media_error != kInsFileErrorNotFound) ||
+    (record.jpeg_error && record.jpeg_error != kInsFileErrorNotFound);
+
+  if (mapped)
+    ins_unmap_trailer(&trailer);
+
+  if (file)
+    fclose(file);
+}
+
+int info_record_dir_callback(const char* dir_path, const char* file_name, void* ctx) {
+  char path[4096];
+
+  if (ins_is_media_file_name(file_name) && ins_join_path(path, sizeof(path), dir_path, file_name, NULL) == 0)
+    write_info_record((InfoFormatContextType*)ctx, path);
+
+  return 0;
+}
+
+/** Show info mode with structured output, input is file or directory */
+int run_show_info_formatted(const char* param_in, int format) {
+  static char output_buffer[kInfoOutputBufferSize];
+  InfoFormatContextType context;
+
+  context.format = format;
+  context.records_count = 0;
+  context.errors_count = 0;
+  ins_output_init(&context.out, stdout, output_buffer, sizeof(output_buffer));
+  ins_trailer_read_plan_init(&context.plan, &kInsDefaultAllocator);
+
+  if (format == kOutputFormatJson)
+    ins_output_string(&context.out, "[\n");
+  else if (format == kOutputFormatCsv)
+    ins_output_string(&context.out, "file,error,trailer_version,trailer_len,entries,serial,model,firmware,offset,duration_ms,codec,width,height\n");
+
+  int result = 0;
+
+  if (ins_is_media_file_name(param_in))
+    write_info_record(&context, param_in);
+  else if (ins_enum_directory(param_in, info_record_dir_callback, &context) < 0)
+    result = -2;
+
+  if (format == kOutputFormatJson)
+    ins_output_string(&context.out, "\n]\n");
+
+  if (ins_output_flush(&context.out) < 0)
+    result = -4;
+
+  ins_trailer_read_plan_destroy(&context.plan);
+
+  if (result == -2)
+    fprintf(stderr, "Cannot open directory: %s\n", param_in);
+
+  return result ? result : (context.errors_count ? -3 : 0);
+}
+
+/** Parse and validate offset from command line, so wrong value is reported before any file is written */
+int parse_new_offset(const char* param_new_offset, InsStitchingOffsetType* out_offset, char out_formatted[kInsStitchingOffsetMaxSize]) {
+  InsStitchingOffsetType offset;
+
+  if (ins_parse_stitching_offset(param_new_offset, strlen(param_new_offset), &offset) < 0) {
+    printf("ERROR: wrong stitching offset format: %s\n", param_new_offset);
+    return -1;
+  }
+
+  if (ins_validate_stitching_offset(&offset) < 0) {
+    printf("ERROR: stitching offset value out of range: %s\n", param_new_offset);
+    return -1;
+  }
+
+  if (out_offset)
+    *out_offset = offset;
+
+  /* formatted value equals parsed string, it is written instead of raw argument */
+  ins_format_stitching_offset(&offset, out_formatted, kInsStitchingOffsetMaxSize);
   return 0;
 }
 
-/** Change stitching offset mode */
-int run_change_stitching_offset(const char* param_file_in, const char* param_file_out, const char* param_new_offset) {
+/** Format digest value as lowercase hex string, out must have 2 * kInsDigestMaxSize + 1 bytes */
+void format_digest_hex(const InsDigestType* digest, char* out) {
+  uint8_t value[kInsDigestMaxSize];
+  int size = ins_digest_final(digest, value);
+
+  for (int i = 0; i < size; i++)
+    sprintf(out + i * 2, "%02x", value[i]);
+  out[size * 2] = 0;
+}
+
+/** Show digest and append it to manifest: algorithm, hex value, size, kind (media or file), path */
+void report_digest(FILE* manifest, const InsDigestType* digest, const char* kind, const char* path) {
+  char hex[2 * kInsDigestMaxSize + 1];
+
+  format_digest_hex(digest, hex);
+  printf("Digest %s %s %s: %s\n", kind, ins_digest_name(digest->algorithm), path, hex);
+
+  if (manifest)
+    fprintf(manifest, "%s %s %" PRIu64 " %s %s\n", ins_digest_name(digest->algorithm), hex, digest->length, kind, path);
+}
+
+/** Add written trailer to file digest. Only trailer is read back, media data was hashed during copy */
+int digest_written_trailer(FILE* file_out, int64_t media_size, uint32_t trailer_len, InsDigestType* digest) {
+  uint8_t* data = (uint8_t*)malloc(trailer_len);
+  int result = 0;
+
+  if (!data)
+    return kInsFileErrorNoMemory;
+
+  if (fflush(file_out) || ins_fseek64(file_out, media_size, SEEK_SET) || fread(data, 1, trailer_len, file_out) != trailer_len)
+    result = kInsFileErrorIo;
+  else
+    ins_digest_update(digest, data, trailer_len);
+
+  free(data);
+  return result;
+}
+
+/** Change stitching offset mode, same file is written to all outputs from one read of input. When digest algorithm
+    is set, media region and each output file are hashed during copy and reported to manifest file */
+int run_change_stitching_offset(const char* param_file_in, const char* const* files_out_names, int files_out_count, 
+  const char* param_new_offset, int digest_algorithm, const char* manifest_path) {
   uint8_t* trailer_data;
   InsFileTrailerHeaderType trailer_info;
-  char* copy_buffer = (char*) malloc(kCopyBufferSize);
-  if (!copy_buffer) {
-    printf("No memory\n");
+  InsTrailerViewType trailer;
+  char new_offset[kInsStitchingOffsetMaxSize];
+
+  if (parse_new_offset(param_new_offset, NULL, new_offset) < 0)
     return -1;
-  }
 
   printf("Use file: %s\n", param_file_in);
 
   FILE* file = fopen(param_file_in, "rb");
   if (!file) {
-    free(copy_buffer);
     printf("Cannot open file\n");
     return -2;
   }
 
-  if (ins_read_allocate_trailer(file, &trailer_data, &trailer_info) < 0) {
+  if (ins_read_allocate_trailer(file, &kInsDefaultAllocator, &trailer_data, &trailer_info) < 0) {
     printf("Cannot decode file header\n");
-    free(copy_buffer);
     fclose(file);
     return -3;
   }
 
   printf("INS trailer version: %d, length: %d\n", trailer_info.trailer_version, trailer_info.trailer_len);
 
-  InsTrailerEntryHeaderInfoVector trailer_hdr_infos;
-  vector_init(&trailer_hdr_infos);
-
-  if (ins_decode_trailer_data(trailer_data, &trailer_info, &trailer_hdr_infos) < 0) {
+  if (ins_trailer_view_init(&trailer, trailer_data, trailer_info.trailer_len) < 0) {
     printf("Cannot decode trailer header\n");
-    ins_free_trailer_buffer(trailer_data);
-    free(copy_buffer);
+    ins_free_trailer_buffer(&kInsDefaultAllocator, trailer_data);
     fclose(file);
     return -4;
   }
 
-  printf("Trailer decoded successfully, entrys count %d\n", vector_size(&trailer_hdr_infos));
+  InsEntryViewType entry;
+  uint32_t position = ins_trailer_view_begin(&trailer);
+  int entries_count = 0;
+  int specific_found = 0;
+  int result;
 
-  InsSpecificDataTagHeaderInfoVector spec_hdr_elements;
-  vector_init(&spec_hdr_elements);
+  while ((result = ins_trailer_view_next_entry(&trailer, &position, &entry)) > 0) {
+    printf("Found trailer header type %.4X (%s) size %d\n", 
+      entry.type, ins_get_trailer_entry_desc(entry.type)->name, entry.data.size);
 
-  uint8_t* new_spec_trailer_hdr;
-  int new_spec_trailer_size;
-
-  for (int i = 0; i < vector_size(&trailer_hdr_infos); i++) {
-    InsTrailerEntryHeaderInfoType* hdr_info = &vector_at(&trailer_hdr_infos, i);
+    specific_found |= entry.type == kInsTrailerEntryTypeSpecific;
+    entries_count++;
+  }
 
-    switch (hdr_info->hdr->type) {
-    case 0x0101:
-      printf("Found specific trailer header type %.4X size %d, change offset data\n", hdr_info->hdr->type, hdr_info->hdr->length);
-      if (0 > ins_change_stitching_offset(
-        trailer_data + hdr_info->trailer_offset_to_data,
-        hdr_info->hdr->length,
-        param_new_offset,
-        &new_spec_trailer_hdr,
-        &new_spec_trailer_size)) {
+  if (result < 0) {
+    printf("Cannot decode trailer header\n");
+    ins_free_trailer_buffer(&kInsDefaultAllocator, trailer_data);
+    fclose(file);
+    return -4;
+  }
 
-        printf("ERROR: cannot change stitching offset\n");
-        ins_free_trailer_buffer(trailer_data);
-        fclose(file);
-        free(copy_buffer);
-        return -7;
-      }
+  printf("Trailer decoded successfully, entrys count %d\n", entries_count);
 
-      printf("Offset changed successfully, old header size %d, new size %d\n", hdr_info->hdr->length, new_spec_trailer_size);
-      break;
-    default:
-      printf("Found trailer header type %.4X size %d\n", hdr_info->hdr->type, hdr_info->hdr->length);
-      break;
-    }
+  if (!specific_found) {
+    printf("ERROR: specific trailer header not found\n");
+    ins_free_trailer_buffer(&kInsDefaultAllocator, trailer_data);
+    fclose(file);
+    return -7;
   }
 
   /* rebuild file */
   printf("Rebuilding file structure...\n");
 
-  int64_t file_in_size = get_file_size(file);
-  fseek(file, 0, SEEK_SET);
+  int64_t media_size = ins_get_file_size(file) - trailer_info.trailer_len;
+  FILE* files_out[kInsTeeMaxDestinations];
+  InsTeeResultType results[kInsTeeMaxDestinations];
+  InsDigestType media_digest;
+  FILE* manifest = NULL;
+
+  if (manifest_path) {
+    manifest = fopen(manifest_path, "a");
+    if (!manifest) {
+      printf("Cannot open manifest file: %s\n", manifest_path);
+      ins_free_trailer_buffer(&kInsDefaultAllocator, trailer_data);
+      fclose(file);
+      return -5;
+    }
+  }
+
+  ins_digest_init(&media_digest, digest_algorithm);
 
-  FILE* file_out = fopen(param_file_out, "wb+");
-  if (!file_out) {
-    printf("Cannot create output file: %s\n", param_file_out);
-    ins_free_trailer_buffer(trailer_data);
-    ins_free_trailer_buffer(new_spec_trailer_hdr);
-    fclose(file);
-    free(copy_buffer);
-    return -5;
+  for (int i = 0; i < files_out_count; i++) {
+    files_out[i] = fopen(files_out_names[i], "wb+");
+    if (!files_out[i]) {
+      printf("Cannot create output file: %s\n", files_out_names[i]);
+      while (i--) {
+        fclose(files_out[i]);
+        remove(files_out_names[i]);
+      }
+      if (manifest)
+        fclose(manifest);
+      ins_free_trailer_buffer(&kInsDefaultAllocator, trailer_data);
+      fclose(file);
+      return -5;
+    }
   }
 
-  int64_t write_pos = 0;
+  printf("Copy media data %" PRId64 " bytes to %d destination(s)...\n", media_size, files_out_count);
 
-  printf("Copy media data %" PRId64 " bytes...\n", (int64_t)(file_in_size - trailer_info.trailer_len));
+  result = ins_tee_copy_region(file, 0, media_size, files_out, files_out_count, &kInsDefaultAllocator, 
+    digest_algorithm ? &media_digest : NULL, results);
+  if (result < 0)
+    printf("Copy media data error, %s\n", ins_file_error_string(result));
+  else if (digest_algorithm)
+    report_digest(manifest, &media_digest, "media", param_file_in);
 
-  int error = 0;
+  /* trailer is rebuilt from the same view for each destination which got whole media data */
+  int failed_count = 0;
+  uint32_t new_trailer_len = 0;
 
-  while (write_pos < file_in_size - trailer_info.trailer_len) {
-    int bytes_to_copy = (int)(file_in_size - trailer_info.trailer_len - write_pos);
-    if (bytes_to_copy > sizeof(copy_buffer))
-      bytes_to_copy = sizeof(copy_buffer);
+  for (int i = 0; i < files_out_count; i++) {
+    int error = result < 0 ? result : results[i].error;
+    InsDigestType file_digest = media_digest;
 
-    if (fread(copy_buffer, 1, bytes_to_copy, file) != bytes_to_copy) {
-      printf("Read file error\n");
-      error = 1;
-      break;
-    }
+    if (!error)
+      error = ins_write_trailer(&trailer, new_offset, files_out[i], &kInsDefaultAllocator, &new_trailer_len);
 
-    if (fwrite(copy_buffer, 1, bytes_to_copy, file_out) != bytes_to_copy) {
-      printf("Write file error\n");
-      error = 1;
-      break;
+    if (!error && digest_algorithm)
+      error = digest_written_trailer(files_out[i], media_size, new_trailer_len, &file_digest);
+
+    if (fclose(files_out[i]) && !error)
+      error = kInsFileErrorIo;
+
+    /* incomplete destination is removed as failed batch .new file */
+    if (error < 0) {
+      printf("ERROR: destination %s: cannot change stitching offset, %s\n", files_out_names[i], ins_file_error_string(error));
+      remove(files_out_names[i]);
+      failed_count++;
+      continue;
     }
 
-    write_pos += bytes_to_copy;
-  }
+    double seconds = results[i].elapsed_us / 1e6;
+    printf("Destination %s: media %" PRId64 " bytes in %.3f s, %.1f MB/s\n", files_out_names[i], results[i].bytes, 
+      seconds, seconds > 0 ? results[i].bytes / seconds / (1024 * 1024) : 0.0);
 
-  if (error) {
-    ins_free_trailer_buffer(trailer_data);
-    ins_free_trailer_buffer(new_spec_trailer_hdr);
-    fclose(file_out);
-    fclose(file);
-    free(copy_buffer);
-    return -6;
+    if (digest_algorithm)
+      report_digest(manifest, &file_digest, "file", files_out_names[i]);
   }
 
-  int total_new_trailer_size = 0;
-
-  /* rebuild trailer */
-  for (int i = vector_size(&trailer_hdr_infos) - 1; i >= 0; i--) {
-    InsTrailerEntryHeaderInfoType* hdr_info = &vector_at(&trailer_hdr_infos, i);
+  ins_free_trailer_buffer(&kInsDefaultAllocator, trailer_data);
+  fclose(file);
 
-    InsFileTrailerEntryHeaderType new_trailer_elem_hdr;
-    new_trailer_elem_hdr.type = hdr_info->hdr->type;
+  if (manifest && fclose(manifest)) {
+    printf("ERROR: cannot write manifest file: %s\n", manifest_path);
+    failed_count++;
+  }
 
-    switch (hdr_info->hdr->type) {
-    case 0x0101:
-      printf("Save rebuilt trailer header type %.4X, size %d bytes\n", 
-        hdr_info->hdr->type, hdr_info->hdr->length);
+  if (failed_count) {
+    printf("ERROR: %d of %d destinations failed\n", failed_count, files_out_count);
+    return -7;
+  }
 
-      new_trailer_elem_hdr.length = new_spec_trailer_size;
-      fwrite(new_spec_trailer_hdr, 1, new_spec_trailer_size, file_out);
-      break;
-    default:
-      printf("Copy trailer header type %.4X, size %d bytes\n", 
-        hdr_info->hdr->type, hdr_info->hdr->length);
+  printf("Offset changed successfully, old trailer size %d, new size %d\n", trailer_info.trailer_len, new_trailer_len);
+  printf("Done!\n");
+  return 0;
+}
 
-      new_trailer_elem_hdr.length = hdr_info->hdr->length;
-      fwrite(trailer_data + hdr_info->trailer_offset_to_data, 1, hdr_info->hdr->length, file_out);
-      break;
-    }
+/** Show per-frame exposure mode */
+int run_show_exposure(const char* param_file_in, double threshold_stops) {
+  printf("Use file: %s\n", param_file_in);
 
-    fwrite(&new_trailer_elem_hdr, 1, sizeof(InsFileTrailerEntryHeaderType), file_out);
-    total_new_trailer_size += new_trailer_elem_hdr.length + sizeof(InsFileTrailerEntryHeaderType);
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file\n");
+    return -2;
   }
 
-  int zero_padding_size = kInsFileMinHeaderLength - kInsFileSignatureLength - sizeof(InsFileTrailerHeaderType);
+  InsTrailerReadPlanType plan;
+  ins_trailer_read_plan_init(&plan, &kInsDefaultAllocator);
 
-  for (int i = 0; i < zero_padding_size; i++) {
-    char zero = 0;
-    fwrite(&zero, 1, 1, file_out);
+  if (ins_plan_trailer_reads(file, 
+        kInsTrailerEntryTypeBit(kInsTrailerEntryTypeExposure) | kInsTrailerEntryTypeBit(kInsTrailerEntryTypeTimestamps), 
+        &plan) < 0) {
+    printf("Cannot decode file header\n");
+    ins_trailer_read_plan_destroy(&plan);
+    fclose(file);
+    return -3;
   }
 
-  InsFileTrailerHeaderType new_trailer_hdr;
-  new_trailer_hdr.trailer_version = trailer_info.trailer_version;
-  new_trailer_hdr.trailer_len = total_new_trailer_size + kInsFileMinHeaderLength;
-  fwrite(&new_trailer_hdr, 1, sizeof(InsFileTrailerHeaderType), file_out);
+  InsExposureStreamType exposure;
+  InsInt64Vector timestamps;
+  InsFrameExposureTableType frames;
+  InsInt32Vector jumps;
 
-  fwrite(kInsFileSignature, 1, kInsFileSignatureLength, file_out);
+  ins_exposure_stream_init(&exposure, &kInsDefaultAllocator);
+  vector_init(&timestamps);
+  ins_frame_exposure_table_init(&frames, &kInsDefaultAllocator);
+  vector_init(&jumps);
 
-  ins_free_trailer_buffer(trailer_data);
-  ins_free_trailer_buffer(new_spec_trailer_hdr);
+  InsMappedTrailerType trailer;
+  int error = 0;
 
-  vector_destroy(&spec_hdr_elements);
-  vector_destroy(&trailer_hdr_infos);
+  if (ins_map_trailer(file, &plan, &trailer) < 0) {
+    printf("Cannot read trailer\n");
+    error = -4;
+  }
 
-  fflush(file_out);
-  fclose(file_out);
-  free(copy_buffer);
+  /* only 0x400 and 0x600 pages are read, decoders work directly on mapped data */
+  for (int i = 0; i < ins_small_vector_size(&plan.entries) && !error; i++) {
+    InsTrailerEntryLocationType* location = &ins_small_vector_at(&plan.entries, i);
 
-  printf("Done!\n");
-  return 0;
-}
+    if (!ins_plan_entry_needs_load(&plan, location))
+      continue;
 
+    const uint8_t* entry_data = ins_mapped_trailer_entry_data(&trailer, location);
 
-int main(int argc, char* argv[]) {
-  printf("Insta360 file tool\n");
+    if (location->type == kInsTrailerEntryTypeExposure)
+      error = ins_decode_exposure_entry(entry_data, location->length, &exposure) < 0;
+    else
+      error = ins_decode_timestamp_entry(entry_data, location->length, &kInsDefaultAllocator, &timestamps) < 0;
 
-  if (argc < 3) {
-    printf("Insufficient arguments\n");
-    printf("USAGE:\n");
-    printf("  ins_file_tool -s <file.insv/insp>                  Show information\n");
-    printf("  ins_file_tool -c <file> <file_out> <new_offset>    Change stitching offset\n");
+    if (error) {
+      printf("Cannot decode trailer entry type %.4X, size %d\n", location->type, location->length);
+      error = -5;
+    }
+  }
 
-    return -1;
+  if (error != -4)
+    ins_unmap_trailer(&trailer);
+
+  fclose(file);
+
+  if (!error && ins_join_frame_exposure(&timestamps, &exposure, &frames) < 0) {
+    printf("File does not contain exposure data\n");
+    error = -6;
   }
 
-  const char* param_mode = argv[1];
-  const char* param_file_in = argv[2];
+  if (!error) {
+    printf("Exposure records %d, frames %d\n", vector_size(&exposure.timecodes), vector_size(&frames.timestamps));
 
-  if (!strcmp(param_mode, "-s"))
-    return run_show_info(param_file_in);
+    for (int i = 0; i < vector_size(&frames.timestamps); i++)
+      printf("Frame %d, timestamp %" PRId64 ", exposure %.6f\n", i, vector_at(&frames.timestamps, i), vector_at(&frames.exposures, i));
 
-  if (!strcmp(param_mode, "-c")) {
-    if (argc < 5) {
-      printf("Insufficient arguments for mode -c\n");
+    ins_find_exposure_jumps(frames.exposures.a, vector_size(&frames.exposures), threshold_stops, &kInsDefaultAllocator, &jumps);
+
+    printf("Exposure jumps above %.2f stops: %d\n", threshold_stops, vector_size(&jumps));
+
+    for (int i = 0; i < vector_size(&jumps); i++) {
+      int32_t frame = vector_at(&jumps, i);
+      printf("*** Frame %d, timestamp %" PRId64 ", exposure %.6f -> %.6f\n", frame, vector_at(&frames.timestamps, frame), 
+        vector_at(&frames.exposures, frame - 1), vector_at(&frames.exposures, frame));
     }
-    const char* param_file_out = argv[3];
-    const char* param_new_offset = argv[4];
 
-    return run_change_stitching_offset(param_file_in, param_file_out, param_new_offset);
+    printf("Done!\n");
+  }
+
+  ins_vector_destroy(&kInsDefaultAllocator, &jumps);
+  ins_frame_exposure_table_destroy(&frames);
+  ins_vector_destroy(&kInsDefaultAllocator, &timestamps);
+  ins_exposure_stream_destroy(&exposure);
+  ins_trailer_read_plan_destroy(&plan);
+
+  return error;
+}
+
+/** Extract preview image from one file */
+int extract_preview_file(const char* param_file_in, const char* param_file_out) {
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file: %s\n", param_file_in);
+    return -2;
+  }
+
+  /* check preview exists before creating output file */
+  InsTrailerEntryLocationType location;
+  if (ins_find_trailer_entry(file, kInsTrailerEntryTypePreview, &location) < 0) {
+    printf("Preview image not found: %s\n", param_file_in);
+    fclose(file);
+    return -3;
+  }
+
+  FILE* file_out = fopen(param_file_out, "wb");
+  if (!file_out) {
+    printf("Cannot create output file: %s\n", param_file_out);
+    fclose(file);
+    return -5;
+  }
+
+  int error = 0;
+  if (ins_copy_file_region(file, location.file_offset, location.length, file_out, &kInsDefaultAllocator) < 0) {
+    printf("Copy preview error: %s\n", param_file_in);
+    error = -6;
+  }
+
+  if (fclose(file_out) && !error)
+    error = -6;
+
+  fclose(file);
+
+  if (!error)
+    printf("Preview saved: %s, size %d\n", param_file_out, location.length);
+
+  return error;
+}
+
+typedef struct _ExtractPreviewDirContextType {
+  const char* out_dir;
+  int files_count;
+  int errors_count;
+} ExtractPreviewDirContextType;
+
+int extract_preview_dir_callback(const char* dir_path, const char* file_name, void* ctx) {
+  ExtractPreviewDirContextType* context = (ExtractPreviewDirContextType*)ctx;
+  char path_in[4096];
+  char path_out[4096];
+
+  if (!ins_is_media_file_name(file_name))
+    return 0;
+
+  if (ins_join_path(path_in, sizeof(path_in), dir_path, file_name, NULL) < 0 ||
+      ins_join_path(path_out, sizeof(path_out), context->out_dir, file_name, ".jpg") < 0) {
+    context->errors_count++;
+    return 0;
+  }
+
+  context->files_count++;
+  if (extract_preview_file(path_in, path_out) < 0)
+    context->errors_count++;
+
+  return 0;
+}
+
+/** Extract preview mode, input is file or directory */
+int run_extract_preview(const char* param_in, const char* param_out) {
+  ExtractPreviewDirContextType context;
+  context.out_dir = param_out;
+  context.files_count = 0;
+  context.errors_count = 0;
+
+  if (ins_is_media_file_name(param_in))
+    return extract_preview_file(param_in, param_out);
+
+  if (ins_enum_directory(param_in, extract_preview_dir_callback, &context) < 0) {
+    printf("Cannot open directory: %s\n", param_in);
+    return -2;
+  }
+
+  printf("Processed files %d, errors %d\n", context.files_count, context.errors_count);
+  return context.errors_count ? -6 : 0;
+}
+
+/** Export IMU, exposure, timestamps and GPS records to columnar file */
+int run_export_columns(const char* param_file_in, const char* param_file_out) {
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file: %s\n", param_file_in);
+    return -2;
+  }
+
+  FILE* file_out = fopen(param_file_out, "wb");
+  if (!file_out) {
+    printf("Cannot create output file: %s\n", param_file_out);
+    fclose(file);
+    return -5;
+  }
+
+  uint32_t types_mask = kInsTrailerEntryTypeBit(kInsTrailerEntryTypeImu) | kInsTrailerEntryTypeBit(kInsTrailerEntryTypeExposure) |
+    kInsTrailerEntryTypeBit(kInsTrailerEntryTypeTimestamps) | kInsTrailerEntryTypeBit(kInsTrailerEntryTypeGps);
+
+  int error = 0;
+  int columns_count = ins_export_columns(file, types_mask, file_out, &kInsDefaultAllocator);
+  if (columns_count < 0) {
+    printf("Export error: %s (%s)\n", param_file_in, ins_file_error_string(columns_count));
+    error = -6;
+  }
+
+  if (fclose(file_out) && !error)
+    error = -6;
+
+  fclose(file);
+
+  if (!error)
+    printf("Columns saved: %s, columns %d\n", param_file_out, columns_count);
+
+  return error;
+}
+
+/** Fast start mode: move moov before mdat, trailer is kept */
+int run_faststart(const char* param_file_in, const char* param_file_out) {
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file: %s\n", param_file_in);
+    return -2;
+  }
+
+  FILE* file_out = fopen(param_file_out, "wb");
+  if (!file_out) {
+    printf("Cannot create output file: %s\n", param_file_out);
+    fclose(file);
+    return -5;
+  }
+
+  int result = ins_write_faststart(file, file_out, &kInsDefaultAllocator, NULL);
+
+  if (fclose(file_out) && result >= 0)
+    result = kInsFileErrorIo;
+
+  fclose(file);
+
+  if (result != 0)
+    remove(param_file_out);
+
+  if (result == kInsMp4AlreadyFastStart) {
+    printf("moov is already before mdat, file not changed: %s\n", param_file_in);
+    return 0;
+  }
+
+  if (result == kInsFileErrorNotFound) {
+    printf("ERROR: media is not mp4: %s\n", param_file_in);
+    return -6;
+  }
+
+  if (result == kInsFileErrorInvalidArgument) {
+    printf("ERROR: chunk offsets do not fit 32-bit table: %s\n", param_file_in);
+    return -6;
+  }
+
+  if (result < 0) {
+    printf("ERROR: %s, %s\n", param_file_in, ins_file_error_string(result));
+    return -6;
+  }
+
+  printf("Fast start file saved: %s\n", param_file_out);
+  return 0;
+}
+
+/** Parse part of trim range, whole part must be finite non-negative number of seconds */
+int parse_range_seconds(const char* text, size_t length, double* out_seconds) {
+  char buffer[64];
+  char* end;
+
+  /* "1..2" is parsed from copy, strtod would take "1." of it */
+  if (!length || length >= sizeof(buffer))
+    return -1;
+
+  memcpy(buffer, text, length);
+  buffer[length] = 0;
+
+  *out_seconds = strtod(buffer, &end);
+  return end == buffer + length && isfinite(*out_seconds) && *out_seconds >= 0 ? 0 : -1;
+}
+
+/** Trim mode: keep time range "start..end" (seconds, empty end - up to media end), cut at keyframes */
+int run_trim(const char* param_file_in, const char* param_range, const char* param_file_out) {
+  const char* separator = strstr(param_range, "..");
+  double start_seconds = 0;
+  double end_seconds = 0;
+
+  if (!separator || parse_range_seconds(param_range, (size_t)(separator - param_range), &start_seconds) < 0 ||
+      (separator[2] && parse_range_seconds(separator + 2, strlen(separator + 2), &end_seconds) < 0) ||
+      (separator[2] && end_seconds <= start_seconds)) {
+    printf("Wrong range, expected start..end: %s\n", param_range);
+    return -1;
+  }
+
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file: %s\n", param_file_in);
+    return -2;
+  }
+
+  FILE* file_out = fopen(param_file_out, "wb");
+  if (!file_out) {
+    printf("Cannot create output file: %s\n", param_file_out);
+    fclose(file);
+    return -5;
+  }
+
+  InsTrimResultType trim;
+  int result = ins_write_trimmed(file, start_seconds, end_seconds, file_out, &kInsDefaultAllocator, NULL, &trim);
+
+  if (fclose(file_out) && result >= 0)
+    result = kInsFileErrorIo;
+
+  fclose(file);
+
+  if (result != 0)
+    remove(param_file_out);
+
+  if (result == kInsFileErrorNotFound) {
+    printf("ERROR: media is not mp4 or has no video track: %s\n", param_file_in);
+    return -6;
+  }
+
+  if (result == kInsFileErrorInvalidArgument) {
+    printf("ERROR: range is outside of video or file has too many tracks: %s\n", param_file_in);
+    return -6;
+  }
+
+  if (result < 0) {
+    printf("ERROR: %s, %s\n", param_file_in, ins_file_error_string(result));
+    return -6;
+  }
+
+  printf("Kept range %.3f..%.3f s, video frames %u\n", trim.start, trim.end, trim.video_samples);
+  printf("Trimmed file saved: %s\n", param_file_out);
+  return 0;
+}
+
+/** Concat mode: join split recording segments, all segments must be recorded by the same camera */
+int run_concat(const char* param_file_out, char* const* param_segments, int segments_count) {
+  FILE** files = (FILE**)calloc(segments_count, sizeof(FILE*));
+  InsSpecificInfoType first_info, info;
+  int error = 0;
+
+  if (!files) {
+    printf("Cannot allocate segments list\n");
+    return -4;
+  }
+
+  for (int i = 0; i < segments_count && !error; i++) {
+    files[i] = fopen(param_segments[i], "rb");
+    if (!files[i]) {
+      printf("Cannot open file: %s\n", param_segments[i]);
+      error = -2;
+      break;
+    }
+
+    if (ins_read_specific_info(files[i], &kInsDefaultAllocator, i ? &info : &first_info) < 0) {
+      printf("Cannot read camera information: %s\n", param_segments[i]);
+      error = -3;
+    } else if (i && strcmp(info.serial, first_info.serial)) {
+      printf("ERROR: segment is recorded by other camera (%s, expected %s): %s\n", info.serial, first_info.serial, param_segments[i]);
+      error = -6;
+    }
+  }
+
+  FILE* file_out = NULL;
+  if (!error) {
+    file_out = fopen(param_file_out, "wb");
+    if (!file_out) {
+      printf("Cannot create output file: %s\n", param_file_out);
+      error = -5;
+    }
+  }
+
+  if (!error) {
+    InsTrimResultType joined;
+    int result = ins_write_concat(files, segments_count, file_out, &kInsDefaultAllocator, NULL, &joined);
+
+    if (fclose(file_out) && result >= 0)
+      result = kInsFileErrorIo;
+
+    if (result != 0)
+      remove(param_file_out);
+
+    if (result == kInsFileErrorNotFound) {
+      printf("ERROR: segment media is not mp4 or has no video track\n");
+      error = -6;
+    } else if (result == kInsFileErrorInvalidArgument) {
+      printf("ERROR: segments have different tracks or joined trailer is too large\n");
+      error = -6;
+    } else if (result == kInsMp4ErrorCodecMismatch) {
+      printf("ERROR: segments have different codec configuration (stsd: SPS/PPS, profile, bit depth)\n");
+      error = -6;
+    } else if (result < 0) {
+      printf("ERROR: %s\n", ins_file_error_string(result));
+      error = -6;
+    } else {
+      printf("Joined segments %d, duration %.3f s, video frames %u\n", segments_count, joined.end, joined.video_samples);
+      printf("Joined file saved: %s\n", param_file_out);
+    }
+  }
+
+  for (int i = 0; i < segments_count; i++) {
+    if (files[i])
+      fclose(files[i]);
+  }
+
+  free(files);
+  return error;
+}
+
+/** Load video keyframe index from sidecar file, or build it from sample tables and save sidecar */
+int load_keyframe_index(FILE* file, const char* index_path, InsKeyframeIndexType* index) {
+  InsMp4BoxType moov;
+  InsMp4InfoType media;
+
+  int64_t media_size = ins_get_media_size(file);
+  if (media_size < 0)
+    return (int)media_size;
+
+  /* camera mp4 starts with ftyp, other media (INSP JPEG) has no video index */
+  int result = ins_mp4_read_box_header(file, 0, media_size, &moov);
+  if (result < 0 || moov.type != kInsMp4BoxFtyp)
+    return kInsFileErrorNotFound;
+
+  /* box headers only: sidecar key is checked without reading moov */
+  result = ins_mp4_find_box(file, 0, media_size, kInsMp4BoxMoov, &moov);
+  if (result < 0)
+    return result;
+
+  FILE* index_file = fopen(index_path, "rb");
+  if (index_file) {
+    result = ins_keyframe_index_read(index, index_file, media_size, &moov);
+    fclose(index_file);
+
+    if (result >= 0) {
+      printf("Keyframe index loaded: %s\n", index_path);
+      return result;
+    }
+
+    ins_keyframe_index_destroy(index);
+    printf("Keyframe index %s: %s\n", result == kInsFileErrorNotFound ? "is stale" : "is invalid", index_path);
+  }
+
+  result = ins_mp4_read_info(file, media_size, &kInsDefaultAllocator, &media);
+  if (result < 0)
+    return result;
+
+  int video = ins_mp4_find_track(&media, kInsMp4HandlerVideo);
+  if (video < 0)
+    return video;
+
+  result = ins_keyframe_index_build(index, file, &media, video);
+  if (result < 0)
+    return result;
+
+  /* index is usable without sidecar, for example on read-only media */
+  index_file = fopen(index_path, "wb");
+  int saved = index_file && ins_keyframe_index_write(index, index_file) == 0;
+
+  if (index_file && fclose(index_file))
+    saved = 0;
+
+  if (saved) {
+    printf("Keyframe index built and saved: %s\n", index_path);
+  } else {
+    if (index_file)
+      remove(index_path);
+    printf("Keyframe index built, cannot save: %s\n", index_path);
+  }
+
+  return result;
+}
+
+/** Make delta mode: save changed trailer entries and fingerprints of media and kept entries */
+int run_make_delta(const char* param_file_in, const char* param_file_out, int digest_algorithm) {
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file: %s\n", param_file_in);
+    return -2;
+  }
+
+  FILE* file_out = fopen(param_file_out, "wb");
+  if (!file_out) {
+    printf("Cannot create output file: %s\n", param_file_out);
+    fclose(file);
+    return -5;
+  }
+
+  int result = ins_write_trailer_delta(file, digest_algorithm, &kInsDefaultAllocator, file_out);
+
+  if (fclose(file_out) && !result)
+    result = kInsFileErrorIo;
+
+  fclose(file);
+
+  if (result < 0) {
+    remove(param_file_out);
+    printf("ERROR: %s, %s\n", param_file_in, ins_file_error_string(result));
+    return -6;
+  }
+
+  printf("Trailer delta saved: %s, fingerprints %s\n", param_file_out, ins_digest_name(digest_algorithm));
+  return 0;
+}
+
+/** Apply delta mode: patch trailer of file copy whose media region matches delta fingerprint */
+int run_apply_delta(const char* param_file, const char* param_delta) {
+  InsTrailerDeltaResultType delta_result;
+
+  FILE* delta = fopen(param_delta, "rb");
+  if (!delta) {
+    printf("Cannot open delta file: %s\n", param_delta);
+    return -2;
+  }
+
+  FILE* file = fopen(param_file, "rb+");
+  if (!file) {
+    printf("Cannot open file for update: %s\n", param_file);
+    fclose(delta);
+    return -2;
+  }
+
+  int result = ins_apply_trailer_delta(delta, file, &kInsDefaultAllocator, &delta_result);
+
+  if (fclose(file) && !result)
+    result = kInsFileErrorIo;
+
+  fclose(delta);
+
+  if (result == kInsFileErrorNotFound) {
+    printf("ERROR: media region or kept trailer entries of %s do not match delta, file not changed\n", param_file);
+    return -6;
+  }
+
+  if (result < 0) {
+    printf("ERROR: cannot apply %s to %s, %s\n", param_delta, param_file, ins_file_error_string(result));
+    return -6;
+  }
+
+  if (delta_result.unchanged) {
+    printf("Trailer is already up to date, file not changed: %s\n", param_file);
+    return 0;
+  }
+
+  printf("Trailer patched: %s, old size %u, new size %u%s\n", param_file, delta_result.old_trailer_len, 
+    delta_result.new_trailer_len, delta_result.truncated ? ", file truncated" : "");
+  return 0;
+}
+
+/** Keyframes mode: list keyframes, or find keyframe at or before given time */
+int run_keyframes(const char* param_file_in, const char* param_time) {
+  InsKeyframeIndexType index;
+  char index_path[4096];
+
+  if (snprintf(index_path, sizeof(index_path), "%s.kfi", param_file_in) >= (int)sizeof(index_path)) {
+    printf("File path is too long: %s\n", param_file_in);
+    return -1;
+  }
+
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file: %s\n", param_file_in);
+    return -2;
+  }
+
+  ins_keyframe_index_init(&index, &kInsDefaultAllocator);
+
+  int result = load_keyframe_index(file, index_path, &index);
+  fclose(file);
+
+  if (result == kInsFileErrorNotFound) {
+    printf("File has no mp4 video track: %s\n", param_file_in);
+    ins_keyframe_index_destroy(&index);
+    return -3;
+  }
+
+  if (result < 0) {
+    printf("Keyframe index error: %s (%s)\n", param_file_in, ins_file_error_string(result));
+    ins_keyframe_index_destroy(&index);
+    return -3;
+  }
+
+  printf("Track %d, timescale %d, samples %d, keyframes %d\n", 
+    index.track_id, index.timescale, index.samples_count, vector_size(&index.keyframes));
+
+  int first = 0;
+  int end = vector_size(&index.keyframes);
+
+  if (param_time) {
+    double seconds = atof(param_time);
+    uint64_t time = seconds > 0.0 ? (uint64_t)(seconds * index.timescale) : 0;
+
+    first = ins_keyframe_index_find(&index, time);
+    end = first < 0 ? 0 : first + 1;
+    printf("Keyframe at or before %.3f s:\n", seconds);
+  }
+
+  for (int i = first; i < end; i++) {
+    const InsKeyframeType* keyframe = &vector_at(&index.keyframes, i);
+
+    printf("*** Time %.3f s, sample %d, offset %" PRId64 ", size %d\n", 
+      media_duration_seconds(keyframe->time, index.timescale), keyframe->sample, keyframe->file_offset, keyframe->size);
+  }
+
+  ins_keyframe_index_destroy(&index);
+  return 0;
+}
+
+
+typedef vector_t(char*) FileNameVector;
+
+typedef struct _BatchWorkerType BatchWorkerType;
+
+#define kBatchPairMaxTimestampDelta  500 /* ms, first frame timestamps of lens files of one recording */
+
+/** One lens file of dual-lens pair */
+typedef struct _BatchPairFileType {
+  int index;                                 /** File index in file_names */
+  int result;                                /** 0 - .new file written, positive status, negative error code */
+  char serial[kInsSpecificTagMaxSize];       /** Camera serial, empty - not read */
+  int64_t first_timestamp;                   /** First frame timestamp (ms), -1 - not available */
+} BatchPairFileType;
+
+/** Dual-lens pair (_00_ and _10_ files of one recording), files are replaced together */
+typedef struct _BatchPairType {
+  BatchPairFileType files[2];                /** Lens 0 and lens 1 */
+  int done_count;                            /** Written files, protected by batch mutex */
+} BatchPairType;
+
+/** Batch mode function called by workers for each file. Returns 0, positive mode status or negative error code */
+typedef int (*BatchFileFunc)(BatchWorkerType* worker, int index, const char* file_name);
+
+/** Batch state shared by workers */
+typedef struct _BatchContextType {
+  const char* dir_path;
+  BatchFileFunc process_file;                /** Mode function */
+  int report_done;                           /** Print line for each successfully processed file */
+  void* mode_ctx;                            /** Mode state */
+  InsStitchingOffsetType offset;             /** Parsed new offset, files with numerically equal offset are skipped */
+  const InsCalibrationTableType* calibration;  /** Offset per camera, NULL - offset field is used for all files */
+  const char* serial;                        /** Change files of this camera only, NULL - all cameras */
+  FileNameVector file_names;                 /** Sorted, so results do not depend on directory order */
+  int* order;                                /** Processing order of file indexes, NULL - sorted order */
+  int* file_pairs;                           /** Pair index of each file, -1 - single file, NULL - no pairs */
+  BatchPairType* pairs;
+  int pairs_count;
+  int next_file;                             /** Next position in processing order, protected by mutex */
+  InsMutexType mutex;                        /** Protects next_file, mode state and console output */
+  InsBufferPoolType io_buffers;              /** Copy buffers, used when kernel copy is not available */
+  int files_count;                           /** Totals of all workers after run_batch */
+  int skipped_count;
+  int not_found_count;
+  int other_camera_count;
+  int errors_count;
+} BatchContextType;
+
+/** Batch worker, owns arena used for all per-file allocations */
+struct _BatchWorkerType {
+  BatchContextType* batch;
+  InsThreadType thread;
+  InsArenaType arena;
+  InsBufferCacheType io_buffers;             /** Worker cache of batch copy buffers */
+  int files_count;
+  int skipped_count;
+  int not_found_count;                       /** Files of cameras missing in calibration table */
+  int other_camera_count;                    /** Files of other cameras than batch serial */
+  int errors_count;
+  int64_t first_file_block_allocations;      /** Arena blocks allocated while processing first file */
+};
+
+int batch_collect_file_callback(const char* dir_path, const char* file_name, void* ctx) {
+  BatchContextType* batch = (BatchContextType*)ctx;
+  (void)dir_path;
+
+  if (!ins_is_media_file_name(file_name))
+    return 0;
+
+  char* name = (char*)malloc(strlen(file_name) + 1);
+  if (!name || ins_vector_reserve(char*, &kInsDefaultAllocator, &batch->file_names, 1) < 0) {
+    free(name);
+    return 1;
+  }
+
+  strcpy(name, file_name);
+  batch->file_names.a[batch->file_names.n++] = name;
+  return 0;
+}
+
+int batch_compare_file_names(const void* a, const void* b) {
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/** Collect INSV/INSP file names of batch directory */
+int batch_collect_files(BatchContextType* batch) {
+  vector_init(&batch->file_names);
+
+  int result = ins_enum_directory(batch->dir_path, batch_collect_file_callback, batch);
+  if (result < 0) {
+    printf("Cannot open directory: %s\n", batch->dir_path);
+    return -2;
+  }
+
+  /* callback stops enumeration only when name cannot be stored */
+  if (result > 0) {
+    printf("Not enough memory\n");
+    return -3;
+  }
+
+  qsort(batch->file_names.a, vector_size(&batch->file_names), sizeof(char*), batch_compare_file_names);
+  return 0;
+}
+
+void batch_free_files(BatchContextType* batch) {
+  for (int i = 0; i < vector_size(&batch->file_names); i++)
+    free(vector_at(&batch->file_names, i));
+  ins_vector_destroy(&kInsDefaultAllocator, &batch->file_names);
+
+  free(batch->order);
+  free(batch->file_pairs);
+  free(batch->pairs);
+  batch->order = batch->file_pairs = NULL;
+  batch->pairs = NULL;
+  batch->pairs_count = 0;
+}
+
+/** Find _00_/_10_ pairs among collected files. Pair files are put one after another in processing order,
+    so two workers write them at the same time */
+int batch_collect_pairs(BatchContextType* batch) {
+  int count = vector_size(&batch->file_names);
+  char partner_name[4096];
+
+  batch->order = (int*)malloc(sizeof(int) * (count ? count : 1));
+  batch->file_pairs = (int*)malloc(sizeof(int) * (count ? count : 1));
+  batch->pairs = (BatchPairType*)calloc(count / 2 + 1, sizeof(BatchPairType));
+
+  if (!batch->order || !batch->file_pairs || !batch->pairs) {
+    printf("Not enough memory\n");
+    return -3;
+  }
+
+  for (int i = 0; i < count; i++)
+    batch->file_pairs[i] = -1;
+
+  int position = 0;
+
+  for (int i = 0; i < count; i++) {
+    int lens = ins_lens_file_name(vector_at(&batch->file_names, i), partner_name, sizeof(partner_name));
+    const char* partner_key = partner_name;
+    char** partner = lens == 0 ? (char**)bsearch(&partner_key, batch->file_names.a, count, sizeof(char*), batch_compare_file_names) : NULL;
+
+    if (batch->file_pairs[i] >= 0)
+      continue;
+
+    batch->order[position++] = i;
+
+    if (!partner)
+      continue;
+
+    int partner_index = (int)(partner - batch->file_names.a);
+    BatchPairType* pair = &batch->pairs[batch->pairs_count];
+
+    pair->files[0].index = i;
+    pair->files[1].index = partner_index;
+    batch->file_pairs[i] = batch->file_pairs[partner_index] = batch->pairs_count++;
+    batch->order[position++] = partner_index;
+  }
+
+  return 0;
+}
+
+#define kBatchFileSkipped        1 /* File already has new offset */
+#define kBatchFileNoCalibration  2 /* Camera not found in calibration table */
+#define kBatchFileNoOffset       3 /* File has no valid stitching offset */
+#define kBatchFileOtherCamera    4 /* File serial differs from batch serial */
+#define kBatchFilePairPending    5 /* Other file of pair is not written yet */
+#define kBatchFilePairMismatch   6 /* Lens files of pair have different serial or start time */
+#define kBatchFilePairFailed     7 /* Other file of pair failed, file is not changed */
+
+/** First frame timestamp of file (0x600 entry), -1 when file has no timestamps */
+int64_t batch_read_first_timestamp(FILE* file) {
+  InsTrailerEntryLocationType location;
+  int64_t timestamp;
+
+  if (ins_find_trailer_entry(file, kInsTrailerEntryTypeTimestamps, &location) < 0 || location.length < sizeof(timestamp) ||
+      ins_fseek64(file, location.file_offset, SEEK_SET) || fread(&timestamp, 1, sizeof(timestamp), file) != sizeof(timestamp))
+    return -1;
+
+  return timestamp;
+}
+
+/** Write file.new with new offset. Pair file also saves camera serial and first frame timestamp for pair check */
+int batch_write_offset_file(BatchWorkerType* worker, const char* file_name, BatchPairFileType* pair_file) {
+  BatchContextType* batch = worker->batch;
+  char path_in[4096];
+  char path_new[4096];
+
+  if (ins_join_path(path_in, sizeof(path_in), batch->dir_path, file_name, NULL) < 0 ||
+      ins_join_path(path_new, sizeof(path_new), batch->dir_path, file_name, ".new") < 0)
+    return kInsFileErrorInvalidArgument;
+
+  FILE* file = fopen(path_in, "rb");
+  if (!file)
+    return kInsFileErrorIo;
+
+  /* all per-file allocations come from worker arena, released at once before next file */
+  ins_arena_reset(&worker->arena);
+
+  InsSpecificInfoType info;
+  int result = ins_read_specific_info(file, ins_arena_allocator(&worker->arena), &info);
+  const InsStitchingOffsetType* offset = &batch->offset;
+
+  if (result >= 0 && pair_file) {
+    strcpy(pair_file->serial, info.serial);
+    pair_file->first_timestamp = batch_read_first_timestamp(file);
+  }
+
+  if (result >= 0 && batch->serial && strcmp(info.serial, batch->serial)) {
+    fclose(file);
+    return kBatchFileOtherCamera;
+  }
+
+  if (result >= 0 && batch->calibration) {
+    const InsCalibrationEntryType* calibration = ins_calibration_table_find(batch->calibration, info.serial, info.model, info.firmware);
+    if (!calibration) {
+      fclose(file);
+      return kBatchFileNoCalibration;
+    }
+    offset = &calibration->offset;
+  }
+
+  if (result < 0 || (!info.offset_error && !ins_stitching_offset_compare(&info.offset, offset))) {
+    fclose(file);
+    return result < 0 ? result : kBatchFileSkipped;
+  }
+
+  char new_offset[kInsStitchingOffsetMaxSize];
+  ins_format_stitching_offset(offset, new_offset, sizeof(new_offset));
+
+  FILE* file_out = fopen(path_new, "wb");
+  if (!file_out) {
+    fclose(file);
+    return kInsFileErrorIo;
+  }
+
+  result = ins_write_file_with_offset(file, new_offset, file_out, 
+    ins_arena_allocator(&worker->arena), ins_buffer_cache_allocator(&worker->io_buffers));
+
+  fclose(file);
+
+  if (fclose(file_out) && !result)
+    result = kInsFileErrorIo;
+
+  if (result)
+    remove(path_new);
+
+  return result;
+}
+
+/** Replace files by written file.new, old files are kept as file.old. When any rename fails, already replaced
+    files are restored, so group of files is changed together or not at all */
+int batch_replace_files(BatchContextType* batch, const char* const* file_names, int count) {
+  char path_in[2][4096];
+  char path_new[2][4096];
+  char path_old[2][4096];
+  int moved_old = 0, moved_new = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (ins_join_path(path_in[i], sizeof(path_in[i]), batch->dir_path, file_names[i], NULL) < 0 ||
+        ins_join_path(path_new[i], sizeof(path_new[i]), batch->dir_path, file_names[i], ".new") < 0 ||
+        ins_join_path(path_old[i], sizeof(path_old[i]), batch->dir_path, file_names[i], ".old") < 0)
+      return kInsFileErrorInvalidArgument;
+  }
+
+  for (; moved_old < count; moved_old++) {
+    remove(path_old[moved_old]);
+    if (rename(path_in[moved_old], path_old[moved_old]))
+      break;
+  }
+
+  for (; moved_old == count && moved_new < count; moved_new++) {
+    if (rename(path_new[moved_new], path_in[moved_new]))
+      break;
+  }
+
+  if (moved_new == count)
+    return 0;
+
+  /* roll back: new files back to file.new, old files back to their names */
+  while (moved_new > 0) {
+    moved_new--;
+    rename(path_in[moved_new], path_new[moved_new]);
+  }
+
+  while (moved_old > 0) {
+    moved_old--;
+    rename(path_old[moved_old], path_in[moved_old]);
+  }
+
+  for (int i = 0; i < count; i++)
+    remove(path_new[i]);
+
+  return kInsFileErrorIo;
+}
+
+/** Check pair and replace both files together. Files keep their own status when pair is consistent, otherwise
+    written files are removed and both files get pair status */
+void batch_commit_pair(BatchContextType* batch, BatchPairType* pair) {
+  BatchPairFileType* files = pair->files;
+  const char* written_names[2];
+  int written_count = 0;
+  int pair_status = 0;
+
+  if (files[0].result < 0 || files[1].result < 0)
+    pair_status = kBatchFilePairFailed;
+  else if (files[0].serial[0] && files[1].serial[0] && strcmp(files[0].serial, files[1].serial))
+    pair_status = kBatchFilePairMismatch;
+  else if (files[0].first_timestamp >= 0 && files[1].first_timestamp >= 0 &&
+           llabs(files[0].first_timestamp - files[1].first_timestamp) > kBatchPairMaxTimestampDelta)
+    pair_status = kBatchFilePairMismatch;
+
+  for (int i = 0; i < 2; i++) {
+    const char* file_name = vector_at(&batch->file_names, files[i].index);
+    char path_new[4096];
+
+    if (files[i].result != 0)
+      continue;
+
+    if (!pair_status) {
+      written_names[written_count++] = file_name;
+    } else if (ins_join_path(path_new, sizeof(path_new), batch->dir_path, file_name, ".new") == 0) {
+      remove(path_new);
+    }
+  }
+
+  if (!pair_status && written_count && batch_replace_files(batch, written_names, written_count) < 0) {
+    for (int i = 0; i < 2; i++) {
+      if (!files[i].result)
+        files[i].result = kInsFileErrorIo;
+    }
+  }
+
+  /* failed file keeps its error, the other one reports that it was not changed */
+  for (int i = 0; i < 2 && pair_status; i++) {
+    if (pair_status == kBatchFilePairMismatch || files[i].result >= 0)
+      files[i].result = pair_status;
+  }
+}
+
+/** Change offset of one file: write file.new, then move file to file.old and file.new to file.
+    Files of dual-lens pair are committed together by the worker which finishes pair */
+int batch_change_offset_file(BatchWorkerType* worker, int index, const char* file_name) {
+  BatchContextType* batch = worker->batch;
+  BatchPairType* pair = batch->file_pairs && batch->file_pairs[index] >= 0 ? &batch->pairs[batch->file_pairs[index]] : NULL;
+
+  if (!pair) {
+    int result = batch_write_offset_file(worker, file_name, NULL);
+    return result ? result : batch_replace_files(batch, &file_name, 1);
+  }
+
+  BatchPairFileType* pair_file = &pair->files[pair->files[1].index == index];
+  pair_file->first_timestamp = -1;
+  int result = batch_write_offset_file(worker, file_name, pair_file);
+
+  ins_mutex_lock(&batch->mutex);
+  pair_file->result = result;
+  int last = ++pair->done_count == 2;
+  ins_mutex_unlock(&batch->mutex);
+
+  if (!last)
+    return kBatchFilePairPending;
+
+  batch_commit_pair(batch, pair);
+  return pair_file->result;
+}
+
+/** Count and print file result, called under batch mutex */
+void batch_report_file(BatchWorkerType* worker, const char* file_name, int result) {
+  BatchContextType* batch = worker->batch;
+
+  if (result < 0) {
+    worker->errors_count++;
+    printf("ERROR: %s, %s\n", file_name, ins_file_error_string(result));
+  } else if (result == kBatchFileSkipped) {
+    worker->skipped_count++;
+    printf("Skipped, offset already set: %s\n", file_name);
+  } else if (result == kBatchFileNoCalibration) {
+    worker->not_found_count++;
+    printf("Skipped, camera not in calibration table: %s\n", file_name);
+  } else if (result == kBatchFileNoOffset) {
+    worker->skipped_count++;
+    printf("Skipped, no valid stitching offset: %s\n", file_name);
+  } else if (result == kBatchFileOtherCamera) {
+    worker->other_camera_count++;
+    printf("Skipped, other camera: %s\n", file_name);
+  } else if (result == kBatchFilePairMismatch) {
+    worker->errors_count++;
+    printf("ERROR: lens files of pair have different camera or start time: %s\n", file_name);
+  } else if (result == kBatchFilePairFailed) {
+    worker->errors_count++;
+    printf("ERROR: not changed, other lens file of pair failed: %s\n", file_name);
+  } else if (batch->report_done) {
+    printf("Done for file : %s\n", file_name);
+  }
+}
+
+int batch_worker_proc(void* ctx) {
+  BatchWorkerType* worker = (BatchWorkerType*)ctx;
+  BatchContextType* batch = worker->batch;
+
+  for (;;) {
+    ins_mutex_lock(&batch->mutex);
+    int position = batch->next_file < vector_size(&batch->file_names) ? batch->next_file++ : -1;
+    ins_mutex_unlock(&batch->mutex);
+
+    if (position < 0)
+      break;
+
+    int index = batch->order ? batch->order[position] : position;
+    const char* file_name = vector_at(&batch->file_names, index);
+    int result = batch->process_file(worker, index, file_name);
+
+    if (worker->files_count++ == 0)
+      worker->first_file_block_allocations = worker->arena.block_allocations;
+
+    /* pair is reported when both files are done */
+    if (result == kBatchFilePairPending)
+      continue;
+
+    ins_mutex_lock(&batch->mutex);
+    if (batch->file_pairs && batch->file_pairs[index] >= 0) {
+      const BatchPairType* pair = &batch->pairs[batch->file_pairs[index]];
+      for (int i = 0; i < 2; i++)
+        batch_report_file(worker, vector_at(&batch->file_names, pair->files[i].index), pair->files[i].result);
+    } else {
+      batch_report_file(worker, file_name, result);
+    }
+    ins_mutex_unlock(&batch->mutex);
+  }
+
+  return 0;
+}
+
+/** Process collected files of batch by worker threads, totals are saved to batch */
+int run_batch(BatchContextType* batch, int threads_count) {
+  batch->next_file = 0;
+  batch->files_count = batch->skipped_count = batch->not_found_count = batch->other_camera_count = batch->errors_count = 0;
+
+  if (threads_count <= 0)
+    threads_count = ins_cpu_count();
+
+  if (threads_count > vector_size(&batch->file_names))
+    threads_count = vector_size(&batch->file_names) ? vector_size(&batch->file_names) : 1;
+
+  printf("Files %d, threads %d\n", vector_size(&batch->file_names), threads_count);
+
+  BatchWorkerType* workers = (BatchWorkerType*)calloc(threads_count, sizeof(BatchWorkerType));
+  if (!workers) {
+    printf("Not enough memory\n");
+    return -3;
+  }
+
+  ins_mutex_init(&batch->mutex);
+  ins_buffer_pool_init(&batch->io_buffers, kInsCopyRegionBufferSize, 1);
+
+  int started = 0;
+  for (int i = 0; i < threads_count; i++) {
+    workers[i].batch = batch;
+    ins_arena_init(&workers[i].arena, kBatchArenaInitialSize, &kInsDefaultAllocator);
+    ins_buffer_cache_init(&workers[i].io_buffers, &batch->io_buffers);
+
+    if (ins_thread_create(&workers[i].thread, batch_worker_proc, &workers[i]) == 0)
+      started++;
+    else
+      break;
+  }
+
+  /* no threads available: process files in this thread */
+  if (!started)
+    batch_worker_proc(&workers[0]);
+
+  for (int i = 0; i < started; i++)
+    ins_thread_join(&workers[i].thread);
+
+  for (int i = 0; i < threads_count; i++) {
+    BatchWorkerType* worker = &workers[i];
+
+    printf("Worker %d: files %d, errors %d, arena high-water %d bytes, blocks allocated %d (after first file %d)\n", 
+      i, worker->files_count, worker->errors_count, (int)worker->arena.high_water, (int)worker->arena.block_allocations,
+      (int)(worker->arena.block_allocations - worker->first_file_block_allocations));
+
+    batch->files_count += worker->files_count;
+    batch->skipped_count += worker->skipped_count;
+    batch->not_found_count += worker->not_found_count;
+    batch->other_camera_count += worker->other_camera_count;
+    batch->errors_count += worker->errors_count;
+    ins_arena_destroy(&worker->arena);
+    ins_buffer_cache_destroy(&worker->io_buffers);
+  }
+
+  ins_buffer_pool_destroy(&batch->io_buffers);
+  ins_mutex_destroy(&batch->mutex);
+  free(workers);
+
+  return 0;
+}
+
+/** Run change offset batch and print totals */
+int run_batch_change_offset_files(BatchContextType* batch, int threads_count) {
+  batch->process_file = batch_change_offset_file;
+  batch->report_done = 1;
+
+  int result = batch_collect_files(batch);
+  if (!result)
+    result = batch_collect_pairs(batch);
+  if (!result && batch->pairs_count)
+    printf("Dual-lens pairs %d\n", batch->pairs_count);
+  if (!result)
+    result = run_batch(batch, threads_count);
+
+  batch_free_files(batch);
+  if (result < 0)
+    return result;
+
+  /* only file copy uses pool, its counters stay valid after run_batch destroys it */
+  printf("Copy buffers %d (huge pages %d), size %d, hits %" PRId64 ", misses %" PRId64 "\n", 
+    batch->io_buffers.buffers_count, batch->io_buffers.huge_buffers_count, (int)batch->io_buffers.buffer_size, 
+    batch->io_buffers.hits, batch->io_buffers.misses);
+
+  if (batch->calibration)
+    printf("Processed files %d, skipped %d, not in calibration table %d, errors %d\n", 
+      batch->files_count, batch->skipped_count, batch->not_found_count, batch->errors_count);
+  else if (batch->serial)
+    printf("Processed files %d, skipped %d, other cameras %d, errors %d\n", 
+      batch->files_count, batch->skipped_count, batch->other_camera_count, batch->errors_count);
+  else
+    printf("Processed files %d, skipped %d, errors %d\n", batch->files_count, batch->skipped_count, batch->errors_count);
+
+  return batch->errors_count ? -6 : 0;
+}
+
+/** Batch change stitching offset mode: one offset for all files */
+int run_batch_change_offset(const char* param_dir, const char* param_new_offset, int threads_count) {
+  BatchContextType batch;
+  char new_offset[kInsStitchingOffsetMaxSize];
+
+  memset(&batch, 0, sizeof(batch));
+  batch.dir_path = param_dir;
+
+  if (parse_new_offset(param_new_offset, &batch.offset, new_offset) < 0)
+    return -1;
+
+  return run_batch_change_offset_files(&batch, threads_count);
+}
+
+/** Batch calibration mode: offset of each file is taken from calibration table by camera serial */
+int run_batch_calibration(const char* param_dir, const char* param_table, int threads_count) {
+  InsCalibrationTableType table;
+  BatchContextType batch;
+  int error_line = 0;
+
+  FILE* file = fopen(param_table, "rb");
+  if (!file) {
+    printf("Cannot open calibration table: %s\n", param_table);
+    return -2;
+  }
+
+  ins_calibration_table_init(&table, &kInsDefaultAllocator);
+  int result = ins_calibration_table_load(&table, file, &error_line);
+  fclose(file);
+
+  if (result < 0) {
+    if (result == kInsFileErrorInvalidArgument)
+      printf("ERROR: wrong calibration table line %d: %s\n", error_line, param_table);
+    else
+      printf("ERROR: cannot load calibration table, %s\n", ins_file_error_string(result));
+
+    ins_calibration_table_destroy(&table);
+    return -1;
+  }
+
+  printf("Calibration table: %d cameras\n", result);
+
+  memset(&batch, 0, sizeof(batch));
+  batch.dir_path = param_dir;
+  batch.calibration = &table;
+  result = run_batch_change_offset_files(&batch, threads_count);
+
+  ins_calibration_table_destroy(&table);
+  return result;
+}
+
+/** Batch offset from reference mode: offset is decoded from reference file once and shared by all workers */
+int run_batch_offset_from(const char* param_reference, const char* param_dir, int same_serial, int threads_count) {
+  InsSpecificInfoType reference;
+  BatchContextType batch;
+
+  FILE* file = fopen(param_reference, "rb");
+  if (!file) {
+    printf("Cannot open reference file: %s\n", param_reference);
+    return -2;
+  }
+
+  int result = ins_read_specific_info(file, &kInsDefaultAllocator, &reference);
+  fclose(file);
+
+  if (result < 0) {
+    printf("ERROR: reference file %s, %s\n", param_reference, ins_file_error_string(result));
+    return -1;
+  }
+
+  if (reference.offset_error) {
+    printf("ERROR: reference file has no valid stitching offset: %s\n", param_reference);
+    return -1;
+  }
+
+  if (ins_validate_stitching_offset(&reference.offset) < 0) {
+    printf("ERROR: reference stitching offset value out of range: %s\n", reference.offset_string);
+    return -1;
+  }
+
+  if (same_serial && !reference.serial[0]) {
+    printf("ERROR: reference file has no serial number: %s\n", param_reference);
+    return -1;
+  }
+
+  printf("Reference offset: %s\n", reference.offset_string);
+  printf("Reference camera: %s\n", reference.serial);
+
+  memset(&batch, 0, sizeof(batch));
+  batch.dir_path = param_dir;
+  batch.offset = reference.offset;
+  batch.serial = same_serial ? reference.serial : NULL;
+
+  return run_batch_change_offset_files(&batch, threads_count);
+}
+
+#define kAnalyzeLensParamsCount  6
+#define kAnalyzeMaxParams        (kInsStitchingOffsetMaxLenses * kAnalyzeLensParamsCount)
+#define kAnalyzeSerialSize       32
+
+static const char* const kAnalyzeLensParamNames[kAnalyzeLensParamsCount] = {
+  "center_x", "center_y", "radius", "rotation_x", "rotation_y", "rotation_z"
+};
+
+/** Stitching offset of analyzed file */
+typedef struct _AnalyzeFileType {
+  int32_t group;                             /** Group index, -1 - file has no valid offset */
+  char serial[kAnalyzeSerialSize];           /** Camera serial, truncated */
+  double values[kAnalyzeMaxParams];          /** Lens parameters, kAnalyzeLensParamsCount per lens */
+} AnalyzeFileType;
+
+/** Files of one camera model with same firmware and lens count */
+typedef struct _AnalyzeGroupType {
+  uint64_t hash;                             /** Hash of model, firmware and lens count */
+  char* model;
+  char* firmware;
+  int lens_count;
+  int32_t files_count;
+} AnalyzeGroupType;
+
+typedef vector_t(AnalyzeGroupType) AnalyzeGroupVector;
+
+/** Offset analysis state, groups are changed by workers under batch mutex */
+typedef struct _AnalyzeContextType {
+  AnalyzeFileType* files;                    /** One item per batch file */
+  AnalyzeGroupVector groups;
+} AnalyzeContextType;
+
+/** Find or add group, called under batch mutex */
+int analyze_get_group(AnalyzeContextType* analysis, const InsSpecificInfoType* info) {
+  uint64_t hash = ins_fnv1a_update(kInsFnvOffsetBasis, info->model, strlen(info->model) + 1);
+  hash = ins_fnv1a_update(hash, info->firmware, strlen(info->firmware) + 1);
+  hash = ins_fnv1a_update_u64(hash, (uint64_t)info->offset.lens_count);
+
+  for (int i = 0; i < vector_size(&analysis->groups); i++) {
+    const AnalyzeGroupType* group = &vector_at(&analysis->groups, i);
+
+    if (group->hash == hash && group->lens_count == info->offset.lens_count &&
+        !strcmp(group->model, info->model) && !strcmp(group->firmware, info->firmware))
+      return i;
+  }
+
+  AnalyzeGroupType group;
+  group.hash = hash;
+  group.model = (char*)malloc(strlen(info->model) + 1);
+  group.firmware = (char*)malloc(strlen(info->firmware) + 1);
+  group.lens_count = info->offset.lens_count;
+  group.files_count = 0;
+
+  if (!group.model || !group.firmware) {
+    free(group.model);
+    free(group.firmware);
+    return -1;
+  }
+
+  strcpy(group.model, info->model);
+  strcpy(group.firmware, info->firmware);
+
+  if (ins_vector_reserve(AnalyzeGroupType, &kInsDefaultAllocator, &analysis->groups, 1) < 0) {
+    free(group.model);
+    free(group.firmware);
+    return -1;
+  }
+
+  analysis->groups.a[analysis->groups.n++] = group;
+
+  return vector_size(&analysis->groups) - 1;
+}
+
+/** Decode stitching offset of one file, only specific header is read */
+int analyze_offset_file(BatchWorkerType* worker, int index, const char* file_name) {
+  BatchContextType* batch = worker->batch;
+  AnalyzeContextType* analysis = (AnalyzeContextType*)batch->mode_ctx;
+  AnalyzeFileType* item = &analysis->files[index];
+  InsSpecificInfoType info;
+  char path[4096];
+
+  item->group = -1;
+
+  if (ins_join_path(path, sizeof(path), batch->dir_path, file_name, NULL) < 0)
+    return kInsFileErrorInvalidArgument;
+
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return kInsFileErrorIo;
+
+  ins_arena_reset(&worker->arena);
+  int result = ins_read_specific_info(file, ins_arena_allocator(&worker->arena), &info);
+  fclose(file);
+
+  if (result < 0)
+    return result;
+
+  if (info.offset_error)
+    return kBatchFileNoOffset;
+
+  strncpy(item->serial, info.serial, kAnalyzeSerialSize - 1);
+  item->serial[kAnalyzeSerialSize - 1] = 0;
+
+  for (int i = 0; i < info.offset.lens_count; i++) {
+    const InsStitchingLensType* lens = &info.offset.lenses[i];
+    double* values = item->values + i * kAnalyzeLensParamsCount;
+
+    values[0] = ins_decimal_to_double(lens->center_x);
+    values[1] = ins_decimal_to_double(lens->center_y);
+    values[2] = ins_decimal_to_double(lens->radius);
+    values[3] = ins_decimal_to_double(lens->rotation[0]);
+    values[4] = ins_decimal_to_double(lens->rotation[1]);
+    values[5] = ins_decimal_to_double(lens->rotation[2]);
+  }
+
+  ins_mutex_lock(&batch->mutex);
+  int group = analyze_get_group(analysis, &info);
+  if (group >= 0)
+    vector_at(&analysis->groups, group).files_count++;
+  ins_mutex_unlock(&batch->mutex);
+
+  if (group < 0)
+    return kInsFileErrorNoMemory;
+
+  item->group = group;
+  return 0;
+}
+
+static const AnalyzeGroupVector* g_analyze_sort_groups;
+
+int analyze_compare_groups(const void* a, const void* b) {
+  const AnalyzeGroupType* group_a = &vector_at(g_analyze_sort_groups, *(const int*)a);
+  const AnalyzeGroupType* group_b = &vector_at(g_analyze_sort_groups, *(const int*)b);
+  int result;
+
+  if ((result = strcmp(group_a->model, group_b->model)) != 0 || (result = strcmp(group_a->firmware, group_b->firmware)) != 0)
+    return result;
+
+  return group_a->lens_count - group_b->lens_count;
+}
+
+/** Print statistics and outliers of one group, files are in file name order */
+void analyze_report_group(
+  const BatchContextType* batch, 
+  const AnalyzeContextType* analysis, 
+  const AnalyzeGroupType* group, 
+  const int32_t* files, 
+  double* column, 
+  double threshold_sigma) {
+
+  InsStatsType stats[kAnalyzeMaxParams];
+  int32_t first_outlier[kAnalyzeMaxParams + 1];
+  int params_count = group->lens_count * kAnalyzeLensParamsCount;
+  InsInt32Vector outliers;
+
+  vector_init(&outliers);
+
+  printf("Model: %s, firmware: %s, lenses %d, files %d\n", group->model, group->firmware, group->lens_count, group->files_count);
+  printf("  %-20s %14s %14s %14s %14s %8s\n", "parameter", "mean", "stddev", "min", "max", "outliers");
+
+  for (int param = 0; param < params_count; param++) {
+    char name[32];
+
+    /* gather parameter column, so reductions run over contiguous array */
+    for (int32_t i = 0; i < group->files_count; i++)
+      column[i] = analysis->files[files[i]].values[param];
+
+    ins_compute_stats(column, group->files_count, &stats[param]);
+
+    first_outlier[param] = vector_size(&outliers);
+    ins_find_outliers(column, group->files_count, &stats[param], threshold_sigma, &kInsDefaultAllocator, &outliers);
+
+    snprintf(name, sizeof(name), "lens%d.%s", param / kAnalyzeLensParamsCount, kAnalyzeLensParamNames[param % kAnalyzeLensParamsCount]);
+    printf("  %-20s %14.4f %14.4f %14.4f %14.4f %8d\n", name, stats[param].mean, stats[param].stddev, stats[param].min, 
+      stats[param].max, vector_size(&outliers) - first_outlier[param]);
+  }
+  first_outlier[params_count] = vector_size(&outliers);
+
+  for (int param = 0; param < params_count; param++) {
+    for (int32_t i = first_outlier[param]; i < first_outlier[param + 1]; i++) {
+      int32_t file_index = files[vector_at(&outliers, i)];
+      const AnalyzeFileType* item = &analysis->files[file_index];
+
+      printf("  *** Outlier: %s, serial %s, lens%d.%s = %.4f (%+.1f sigma)\n", 
+        vector_at(&batch->file_names, file_index), item->serial, param / kAnalyzeLensParamsCount, 
+        kAnalyzeLensParamNames[param % kAnalyzeLensParamsCount], item->values[param],
+        (item->values[param] - stats[param].mean) / stats[param].stddev);
+    }
+  }
+
+  ins_vector_destroy(&kInsDefaultAllocator, &outliers);
+}
+
+/** Stitching offset statistics mode: group files by camera model and firmware, find offsets far from group mean */
+int run_analyze_offsets(const char* param_dir, double threshold_sigma, int threads_count) {
+  BatchContextType batch;
+  AnalyzeContextType analysis;
+
+  memset(&batch, 0, sizeof(batch));
+  batch.dir_path = param_dir;
+  batch.process_file = analyze_offset_file;
+  batch.mode_ctx = &analysis;
+  vector_init(&analysis.groups);
+
+  int result = batch_collect_files(&batch);
+  if (result < 0) {
+    batch_free_files(&batch);
+    return result;
+  }
+
+  int32_t files_count = vector_size(&batch.file_names);
+  analysis.files = (AnalyzeFileType*)calloc(files_count ? files_count : 1, sizeof(AnalyzeFileType));
+  if (!analysis.files) {
+    printf("Not enough memory\n");
+    batch_free_files(&batch);
+    return -3;
+  }
+
+  result = run_batch(&batch, threads_count);
+
+  int32_t groups_count = vector_size(&analysis.groups);
+  int* group_order = (int*)malloc((groups_count + 1) * sizeof(int));
+  int32_t* group_start = (int32_t*)calloc(groups_count + 1, sizeof(int32_t));
+  int32_t* group_files = (int32_t*)malloc((files_count + 1) * sizeof(int32_t));
+  double* column = (double*)malloc((files_count + 1) * sizeof(double));
+
+  if (!result && (!group_order || !group_start || !group_files || !column)) {
+    printf("Not enough memory\n");
+    result = -3;
+  }
+
+  if (!result) {
+    /* files of each group in file name order, so report does not depend on threads */
+    for (int32_t i = 0; i < groups_count; i++)
+      group_start[i + 1] = group_start[i] + vector_at(&analysis.groups, i).files_count;
+
+    for (int32_t i = 0; i < files_count; i++) {
+      if (analysis.files[i].group >= 0)
+        group_files[group_start[analysis.files[i].group]++] = i;
+    }
+
+    for (int32_t i = 0; i < groups_count; i++) {
+      group_start[i] -= vector_at(&analysis.groups, i).files_count;
+      group_order[i] = i;
+    }
+
+    g_analyze_sort_groups = &analysis.groups;
+    qsort(group_order, groups_count, sizeof(int), analyze_compare_groups);
+
+    printf("Outlier threshold %.1f sigma\n", threshold_sigma);
+
+    for (int32_t i = 0; i < groups_count; i++) {
+      const AnalyzeGroupType* group = &vector_at(&analysis.groups, group_order[i]);
+      analyze_report_group(&batch, &analysis, group, group_files + group_start[group_order[i]], column, threshold_sigma);
+    }
+
+    printf("Processed files %d, groups %d, skipped %d, errors %d\n", batch.files_count, groups_count, batch.skipped_count, batch.errors_count);
+  }
+
+  free(column);
+  free(group_files);
+  free(group_start);
+  free(group_order);
+
+  for (int32_t i = 0; i < groups_count; i++) {
+    free(vector_at(&analysis.groups, i).model);
+    free(vector_at(&analysis.groups, i).firmware);
+  }
+  ins_vector_destroy(&kInsDefaultAllocator, &analysis.groups);
+  free(analysis.files);
+  batch_free_files(&batch);
+
+  if (result < 0)
+    return result;
+  return batch.errors_count ? -6 : 0;
+}
+
+/** Allocator context for benchmark, counts library allocations */
+typedef struct _CountingAllocatorContextType {
+  int64_t allocations;                       /** Allocate and reallocate calls count */
+  int64_t bytes;                             /** Requested bytes */
+} CountingAllocatorContextType;
+
+void* counting_allocate(void* ctx, size_t size) {
+  CountingAllocatorContextType* context = (CountingAllocatorContextType*)ctx;
+  context->allocations++;
+  context->bytes += size;
+  return malloc(size);
+}
+
+void* counting_reallocate(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+  CountingAllocatorContextType* context = (CountingAllocatorContextType*)ctx;
+  context->allocations++;
+  context->bytes += new_size - old_size;
+  return realloc(ptr, new_size);
+}
+
+void counting_release(void* ctx, void* ptr) {
+  (void)ctx;
+  free(ptr);
+}
+
+/** One benchmark call: plan reads, map trailer, decode specific info, exposure and timestamps.
+    Plan is created for each call, entries list fits its inline storage for camera files */
+int bench_iteration(FILE* file, InsExposureStreamType* exposure, InsInt64Vector* timestamps) {
+  InsTrailerReadPlanType plan_storage;
+  InsTrailerReadPlanType* plan = &plan_storage;
+
+  uint32_t wanted_types_mask = kInsTrailerEntryTypeBit(kInsTrailerEntryTypeSpecific) | 
+    kInsTrailerEntryTypeBit(kInsTrailerEntryTypeExposure) | kInsTrailerEntryTypeBit(kInsTrailerEntryTypeTimestamps);
+
+  ins_trailer_read_plan_init(plan, exposure->allocator);
+
+  int result = ins_plan_trailer_reads(file, wanted_types_mask, plan);
+
+  InsMappedTrailerType trailer;
+  if (!result)
+    result = ins_map_trailer(file, plan, &trailer);
+
+  if (result < 0) {
+    ins_trailer_read_plan_destroy(plan);
+    return result;
+  }
+
+  /* decoded data is dropped after each call, storage is reused */
+  exposure->timecodes.n = exposure->exposures.n = 0;
+  timestamps->n = 0;
+
+  for (int i = 0; i < ins_small_vector_size(&plan->entries) && result >= 0; i++) {
+    InsTrailerEntryLocationType* location = &ins_small_vector_at(&plan->entries, i);
+
+    if (!ins_plan_entry_needs_load(plan, location))
+      continue;
+
+    InsEntryViewType entry;
+    InsTagViewType tag;
+
+    entry.type = location->type;
+    entry.trailer_offset = (uint32_t)(location->file_offset - trailer.file_offset);
+    entry.data = ins_byte_view(ins_mapped_trailer_entry_data(&trailer, location), location->length);
+
+    if (location->type == kInsTrailerEntryTypeSpecific)
+      result = ins_entry_view_find_tag(&entry, kInsFileSpecificHeaderTagTypeOffset, &tag);
+    else if (location->type == kInsTrailerEntryTypeExposure)
+      result = ins_decode_exposure_entry(entry.data.data, entry.data.size, exposure);
+    else
+      result = ins_decode_timestamp_entry(entry.data.data, entry.data.size, plan->allocator, timestamps);
+  }
+
+  ins_unmap_trailer(&trailer);
+  ins_trailer_read_plan_destroy(plan);
+  return result < 0 ? result : 0;
+}
+
+/** Benchmark mode: library per-call time and allocations in steady state */
+int run_bench(const char* param_file_in, int iterations) {
+  CountingAllocatorContextType context = { 0, 0 };
+  InsAllocatorType allocator = { counting_allocate, counting_reallocate, counting_release, &context };
+
+  printf("Use file: %s\n", param_file_in);
+
+  FILE* file = fopen(param_file_in, "rb");
+  if (!file) {
+    printf("Cannot open file\n");
+    return -2;
+  }
+
+  InsExposureStreamType exposure;
+  InsInt64Vector timestamps;
+
+  ins_exposure_stream_init(&exposure, &allocator);
+  vector_init(&timestamps);
+
+  /* first call allocates decoded records storage */
+  int result = bench_iteration(file, &exposure, &timestamps);
+  int64_t warmup_allocations = context.allocations;
+
+  clock_t start = clock();
+
+  for (int i = 0; i < iterations && result >= 0; i++)
+    result = bench_iteration(file, &exposure, &timestamps);
+
+  clock_t end = clock();
+
+  if (result < 0) {
+    printf("ERROR: %s\n", ins_file_error_string(result));
+  } else {
+    double elapsed_ns = (double)(end - start) * 1e9 / CLOCKS_PER_SEC;
+
+    printf("Iterations %d, %.0f ns per call\n", iterations, iterations ? elapsed_ns / iterations : 0.0);
+    printf("Warm-up allocations %" PRId64 ", steady state allocations %" PRId64 " (%" PRId64 " bytes)\n", 
+      warmup_allocations, context.allocations - warmup_allocations, context.bytes);
+    printf("Done!\n");
+  }
+
+  ins_vector_destroy(&allocator, &timestamps);
+  ins_exposure_stream_destroy(&exposure);
+  fclose(file);
+
+  return result < 0 ? -3 : 0;
+}
+
+
+/** Parse --format= option value */
+int parse_output_format(const char* value) {
+  if (!strcmp(value, "text"))
+    return kOutputFormatText;
+  if (!strcmp(value, "ndjson"))
+    return kOutputFormatNdjson;
+  if (!strcmp(value, "json"))
+    return kOutputFormatJson;
+  if (!strcmp(value, "csv"))
+    return kOutputFormatCsv;
+  return -1;
+}
+
+int main(int argc, char* argv[]) {
+  int output_format = kOutputFormatText;
+  int same_serial = 0;
+  int digest_algorithm = 0;
+  const char* manifest_path = NULL;
+
+  /* remove options from arguments, so modes see positional arguments only */
+  int args_count = 1;
+  for (int i = 1; i < argc; i++) {
+    if (!strncmp(argv[i], "--format=", 9)) {
+      output_format = parse_output_format(argv[i] + 9);
+      if (output_format < 0) {
+        printf("Invalid format: %s\n", argv[i] + 9);
+        return -1;
+      }
+    } else if (!strcmp(argv[i], "--same-serial")) {
+      same_serial = 1;
+    } else if (!strncmp(argv[i], "--digest=", 9)) {
+      digest_algorithm = ins_digest_parse_name(argv[i] + 9);
+      if (!digest_algorithm) {
+        printf("Invalid digest: %s\n", argv[i] + 9);
+        return -1;
+      }
+    } else if (!strncmp(argv[i], "--manifest=", 11)) {
+      manifest_path = argv[i] + 11;
+    } else {
+      argv[args_count++] = argv[i];
+    }
+  }
+  argc = args_count;
+
+  /* manifest without explicit algorithm gets the fastest one */
+  if (manifest_path && !digest_algorithm)
+    digest_algorithm = kInsDigestCrc32c;
+
+  /* machine readable output must not contain banner */
+  if (output_format == kOutputFormatText)
+    printf("Insta360 file tool\n");
+
+  if (argc < 3) {
+    printf("Insufficient arguments\n");
+    printf("USAGE:\n");
+    printf("  ins_file_tool -s <file.insv/insp>                  Show information\n");
+    printf("  ins_file_tool -s <file|dir> --format=ndjson|json|csv  Show information of file or all files in directory\n");
+    printf("  ins_file_tool -c <file> <file_out> <new_offset>    Change stitching offset\n");
+    printf("  ins_file_tool -c <file> <file_out> <file_out> ... <new_offset>  Write changed file to several outputs from one read\n");
+    printf("  ins_file_tool -c <file> <file_out> ... <new_offset> [--digest=crc32c|sha256] [--manifest=<file>]  Hash media and outputs during copy\n");
+    printf("  ins_file_tool -e <file.insv> [threshold_stops]     Show per-frame exposure and exposure jumps\n");
+    printf("  ins_file_tool --extract preview <file> <out.jpg>   Save embedded preview image\n");
+    printf("  ins_file_tool --extract preview <dir> <out_dir>    Save preview images of all files in directory\n");
+    printf("  ins_file_tool --export-columns <file> <out.inscol> Save IMU, exposure, timestamps and GPS as columnar file\n");
+    printf("  ins_file_tool --faststart <file.insv> <file_out>   Move moov before mdat for progressive playback\n");
+    printf("  ins_file_tool --keyframes <file.insv> [seconds]    Show video keyframes or keyframe at or before time\n");
+    printf("  ins_file_tool --trim <file.insv> <start..end> <file_out>  Keep time range (seconds), cut at keyframes\n");
+    printf("  ins_file_tool --concat <file_out> <segment.insv> <segment.insv> ...  Join split recording segments\n");
+    printf("  ins_file_tool --make-delta <file> <out.insdelta> [--digest=sha256|crc32c]  Save changed trailer entries and fingerprints\n");
+    printf("  ins_file_tool --apply-delta <file> <delta.insdelta>  Patch trailer of copy with matching media region\n");
+    printf("  ins_file_tool --batch-offset <dir> <new_offset> [threads]  Change stitching offset of all files in directory\n");
+    printf("  ins_file_tool --batch-calibration <dir> <table.csv> [threads]  Set offset of each file by camera serial\n");
+    printf("  ins_file_tool --offset-from <reference> <dir> [threads] [--same-serial]  Set offset of reference file to all files\n");
+    printf("  ins_file_tool --analyze offsets <dir> [sigma] [threads]  Stitching offset statistics and outliers\n");
+    printf("  ins_file_tool --bench <file> [iterations]          Measure library per-call time and allocations\n");
+
+    return -1;
+  }
+
+  const char* param_mode = argv[1];
+  const char* param_file_in = argv[2];
+
+  if (!strcmp(param_mode, "-s")) {
+    if (output_format != kOutputFormatText)
+      return run_show_info_formatted(param_file_in, output_format);
+
+    return run_show_info(param_file_in);
+  }
+
+  if (!strcmp(param_mode, "-c")) {
+    if (argc < 5) {
+      printf("Insufficient arguments for mode -c\n");
+      return -1;
+    }
+    /* all arguments between input file and offset are outputs */
+    int files_out_count = argc - 4;
+    if (files_out_count > kInsTeeMaxDestinations) {
+      printf("Too many output files, maximum %d\n", kInsTeeMaxDestinations);
+      return -1;
+    }
+
+    return run_change_stitching_offset(param_file_in, (const char* const*)argv + 3, files_out_count, argv[argc - 1], 
+      digest_algorithm, manifest_path);
+  }
+
+  if (!strcmp(param_mode, "-e")) {
+    double threshold_stops = (argc > 3) ? atof(argv[3]) : 1.0;
+    return run_show_exposure(param_file_in, threshold_stops);
+  }
+
+  if (!strcmp(param_mode, "--extract")) {
+    if (argc < 5 || strcmp(argv[2], "preview")) {
+      printf("Insufficient arguments for mode --extract\n");
+      return -1;
+    }
+
+    return run_extract_preview(argv[3], argv[4]);
+  }
+
+  if (!strcmp(param_mode, "--export-columns")) {
+    if (argc < 4) {
+      printf("Insufficient arguments for mode --export-columns\n");
+      return -1;
+    }
+
+    return run_export_columns(param_file_in, argv[3]);
+  }
+
+  if (!strcmp(param_mode, "--faststart")) {
+    if (argc < 4) {
+      printf("Insufficient arguments for mode --faststart\n");
+      return -1;
+    }
+
+    return run_faststart(param_file_in, argv[3]);
+  }
+
+  if (!strcmp(param_mode, "--trim")) {
+    if (argc < 5) {
+      printf("Insufficient arguments for mode --trim\n");
+      return -1;
+    }
+
+    return run_trim(param_file_in, argv[3], argv[4]);
+  }
+
+  if (!strcmp(param_mode, "--concat")) {
+    if (argc < 5) {
+      printf("Insufficient arguments for mode --concat\n");
+      return -1;
+    }
+
+    return run_concat(param_file_in, argv + 3, argc - 3);
+  }
+
+  if (!strcmp(param_mode, "--make-delta")) {
+    if (argc < 4) {
+      printf("Insufficient arguments for mode --make-delta\n");
+      return -1;
+    }
+
+    return run_make_delta(param_file_in, argv[3], digest_algorithm ? digest_algorithm : kInsDigestSha256);
+  }
+
+  if (!strcmp(param_mode, "--apply-delta")) {
+    if (argc < 4) {
+      printf("Insufficient arguments for mode --apply-delta\n");
+      return -1;
+    }
+
+    return run_apply_delta(param_file_in, argv[3]);
+  }
+
+  if (!strcmp(param_mode, "--keyframes"))
+    return run_keyframes(param_file_in, (argc > 3) ? argv[3] : NULL);
+
+  if (!strcmp(param_mode, "--analyze")) {
+    if (argc < 4 || strcmp(argv[2], "offsets")) {
+      printf("Insufficient arguments for mode --analyze\n");
+      return -1;
+    }
+
+    double threshold_sigma = (argc > 4) ? atof(argv[4]) : 3.0;
+    int threads_count = (argc > 5) ? atoi(argv[5]) : 0;
+    return run_analyze_offsets(argv[3], threshold_sigma, threads_count);
+  }
+
+  if (!strcmp(param_mode, "--batch-calibration")) {
+    if (argc < 4) {
+      printf("Insufficient arguments for mode --batch-calibration\n");
+      return -1;
+    }
+
+    int threads_count = (argc > 4) ? atoi(argv[4]) : 0;
+    return run_batch_calibration(param_file_in, argv[3], threads_count);
+  }
+
+  if (!strcmp(param_mode, "--offset-from")) {
+    if (argc < 4) {
+      printf("Insufficient arguments for mode --offset-from\n");
+      return -1;
+    }
+
+    int threads_count = (argc > 4) ? atoi(argv[4]) : 0;
+    return run_batch_offset_from(param_file_in, argv[3], same_serial, threads_count);
+  }
+
+  if (!strcmp(param_mode, "--batch-offset")) {
+    if (argc < 4) {
+      printf("Insufficient arguments for mode --batch-offset\n");
+      return -1;
+    }
+
+    int threads_count = (argc > 4) ? atoi(argv[4]) : 0;
+    return run_batch_change_offset(param_file_in, argv[3], threads_count);
+  }
+
+  if (!strcmp(param_mode, "--bench")) {
+    int iterations = (argc > 3) ? atoi(argv[3]) : 10000;
+    return run_bench(param_file_in, iterations);
   }
 
   printf("Invalid mode\n");
@@ -0,0 +1,33 @@
+#ifndef INS_HASH_HEADER
+#define INS_HASH_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 64-bit FNV-1a hash for hash tables and grouping keys (serial numbers, parsed offsets).
+// Not suitable for content checksums.
+
+#define kInsFnvOffsetBasis  0xCBF29CE484222325ull
+#define kInsFnvPrime        0x00000100000001B3ull
+
+/** Add bytes to FNV-1a hash, start from kInsFnvOffsetBasis */
+static inline uint64_t ins_fnv1a_update(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* bytes = (const uint8_t*)data;
+
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= kInsFnvPrime;
+  }
+  return hash;
+}
+
+/** Add 64-bit value to FNV-1a hash, bytes are taken in little endian order on any platform */
+static inline uint64_t ins_fnv1a_update_u64(uint64_t hash, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    hash ^= (value >> (i * 8)) & 0xFF;
+    hash *= kInsFnvPrime;
+  }
+  return hash;
+}
+
+#endif  // INS_HASH_HEADER
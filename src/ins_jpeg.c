@@ -0,0 +1,314 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ins_jpeg.h"
+#include "ins_file.h"
+
+#define kInsJpegMarkerSoi   0xD8
+#define kInsJpegMarkerEoi   0xD9
+#define kInsJpegMarkerSos   0xDA
+#define kInsJpegMarkerApp1  0xE1
+#define kInsJpegMarkerTem   0x01
+
+static const uint8_t kInsJpegExifId[6] = { 'E', 'x', 'i', 'f', 0, 0 };
+static const char kInsJpegXmpId[] = "http://ns.adobe.com/xap/1.0/"; /* identifier includes terminating zero */
+
+/** EXIF TIFF structure, byte order is set by TIFF header */
+typedef struct _InsTiffViewType {
+  const uint8_t* data;
+  uint32_t size;
+  int big_endian;
+} InsTiffViewType;
+
+static uint16_t ins_tiff_u16(const InsTiffViewType* tiff, uint32_t offset) {
+  const uint8_t* p = tiff->data + offset;
+  return tiff->big_endian ? (uint16_t)((p[0] << 8) | p[1]) : (uint16_t)((p[1] << 8) | p[0]);
+}
+
+static uint32_t ins_tiff_u32(const InsTiffViewType* tiff, uint32_t offset) {
+  const uint8_t* p = tiff->data + offset;
+  return tiff->big_endian ? ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3] :
+    ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+/** Copy ASCII value of IFD entry, value is inline when it fits 4 bytes. Wrong entry gives empty string */
+static void ins_tiff_copy_string(const InsTiffViewType* tiff, uint32_t entry, char* out, size_t out_size) {
+  uint32_t count = ins_tiff_u32(tiff, entry + 4);
+  uint32_t offset = count <= 4 ? entry + 8 : ins_tiff_u32(tiff, entry + 8);
+  size_t len = 0;
+
+  out[0] = 0;
+  if (ins_tiff_u16(tiff, entry + 2) != 2 || offset > tiff->size || count > tiff->size - offset)
+    return;
+
+  while (len < count && len + 1 < out_size && tiff->data[offset + len]) {
+    char c = (char)tiff->data[offset + len];
+    out[len++] = (c >= 0x20 && c < 0x7F) ? c : '?';
+  }
+
+  while (len > 0 && out[len - 1] == ' ')
+    len--;
+  out[len] = 0;
+}
+
+/** Read tags of IFD, Exif IFD pointer of IFD0 is followed once */
+static void ins_tiff_read_ifd(const InsTiffViewType* tiff, uint32_t ifd, int follow_exif, InsJpegInfoType* info) {
+  if (ifd > tiff->size || tiff->size - ifd < 2)
+    return;
+
+  uint32_t count = ins_tiff_u16(tiff, ifd);
+  if (count > (tiff->size - ifd - 2) / 12)
+    count = (tiff->size - ifd - 2) / 12;
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t entry = ifd + 2 + i * 12;
+
+    switch (ins_tiff_u16(tiff, entry)) {
+      case 0x010F:
+        ins_tiff_copy_string(tiff, entry, info->make, sizeof(info->make));
+        break;
+      case 0x0110:
+        ins_tiff_copy_string(tiff, entry, info->model, sizeof(info->model));
+        break;
+      case 0x0132:
+        /* modification time is used only when DateTimeOriginal is missing */
+        if (!info->capture_time[0])
+          ins_tiff_copy_string(tiff, entry, info->capture_time, sizeof(info->capture_time));
+        break;
+      case 0x9003:
+        ins_tiff_copy_string(tiff, entry, info->capture_time, sizeof(info->capture_time));
+        break;
+      case 0x8769:
+        if (follow_exif)
+          ins_tiff_read_ifd(tiff, ins_tiff_u32(tiff, entry + 8), 0, info);
+        break;
+    }
+  }
+}
+
+/** Decode EXIF segment data (after "Exif\0\0" identifier) */
+static void ins_jpeg_parse_exif(const uint8_t* data, uint32_t size, InsJpegInfoType* info) {
+  InsTiffViewType tiff;
+
+  if (size < 8)
+    return;
+
+  tiff.data = data;
+  tiff.size = size;
+  tiff.big_endian = data[0] == 'M' && data[1] == 'M';
+
+  if ((!tiff.big_endian && (data[0] != 'I' || data[1] != 'I')) || ins_tiff_u16(&tiff, 2) != 42)
+    return;
+
+  info->has_exif = 1;
+  ins_tiff_read_ifd(&tiff, ins_tiff_u32(&tiff, 4), 1, info);
+}
+
+/** Find GPano property in XMP packet: attribute GPano:Name="value" or element <GPano:Name>value</GPano:Name> */
+static int ins_xmp_find_property(const char* xmp, size_t size, const char* name, char* out, size_t out_size) {
+  char key[kInsJpegMaxTextSize];
+  size_t key_len = (size_t)snprintf(key, sizeof(key), "GPano:%s", name);
+
+  for (size_t i = 0; i + key_len < size; i++) {
+    if (memcmp(xmp + i, key, key_len))
+      continue;
+
+    size_t position = i + key_len;
+    char end;
+
+    if (xmp[position] == '=' && position + 1 < size && (xmp[position + 1] == '"' || xmp[position + 1] == '\'')) {
+      end = xmp[position + 1];
+      position += 2;
+    } else if (xmp[position] == '>' && i > 0 && xmp[i - 1] == '<') {
+      end = '<';
+      position++;
+    } else {
+      continue;
+    }
+
+    size_t len = 0;
+    while (position + len < size && xmp[position + len] != end)
+      len++;
+
+    if (position + len >= size)
+      return 0;
+
+    if (len >= out_size)
+      len = out_size - 1;
+    memcpy(out, xmp + position, len);
+    out[len] = 0;
+    return 1;
+  }
+
+  return 0;
+}
+
+static int64_t ins_xmp_find_number(const char* xmp, size_t size, const char* name) {
+  char value[kInsJpegMaxTextSize];
+  char* end;
+
+  if (!ins_xmp_find_property(xmp, size, name, value, sizeof(value)))
+    return -1;
+
+  long long number = strtoll(value, &end, 10);
+  return end != value && number >= 0 ? (int64_t)number : -1;
+}
+
+/** Decode XMP segment data (after identifier) */
+static void ins_jpeg_parse_xmp(const uint8_t* data, uint32_t size, InsJpegInfoType* info) {
+  const char* xmp = (const char*)data;
+  InsJpegGPanoType* gpano = &info->gpano;
+
+  info->has_xmp = 1;
+  ins_xmp_find_property(xmp, size, "ProjectionType", gpano->projection_type, sizeof(gpano->projection_type));
+  gpano->full_pano_width = ins_xmp_find_number(xmp, size, "FullPanoWidthPixels");
+  gpano->full_pano_height = ins_xmp_find_number(xmp, size, "FullPanoHeightPixels");
+  gpano->cropped_width = ins_xmp_find_number(xmp, size, "CroppedAreaImageWidthPixels");
+  gpano->cropped_height = ins_xmp_find_number(xmp, size, "CroppedAreaImageHeightPixels");
+  gpano->cropped_left = ins_xmp_find_number(xmp, size, "CroppedAreaLeftPixels");
+  gpano->cropped_top = ins_xmp_find_number(xmp, size, "CroppedAreaTopPixels");
+}
+
+/** Start of frame markers, DHT (C4), JPG (C8) and DAC (CC) share the range */
+static int ins_jpeg_is_sof(uint8_t marker) {
+  return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+/** Get bytes at offset from head buffer, or read them to allocated buffer when they are outside of head */
+static int ins_jpeg_read_range(FILE* file, const uint8_t* head, int64_t head_size, int64_t offset, uint32_t size,
+  const InsAllocatorType* allocator, const uint8_t** out_data, uint8_t** out_buffer) {
+  *out_buffer = NULL;
+
+  if (offset + size <= head_size) {
+    *out_data = head + offset;
+    return 0;
+  }
+
+  *out_buffer = (uint8_t*)ins_allocate(allocator, size ? size : 1);
+  if (!*out_buffer)
+    return kInsFileErrorNoMemory;
+
+  if (ins_fseek64(file, offset, SEEK_SET) || fread(*out_buffer, 1, size, file) != size) {
+    ins_release(allocator, *out_buffer);
+    *out_buffer = NULL;
+    return kInsFileErrorIo;
+  }
+
+  *out_data = *out_buffer;
+  return 0;
+}
+
+int ins_jpeg_read_info(FILE* file, int64_t media_size, const InsAllocatorType* allocator, InsJpegInfoType* out_info) {
+  memset(out_info, 0, sizeof(*out_info));
+  out_info->media_size = media_size;
+  out_info->gpano.full_pano_width = out_info->gpano.full_pano_height = -1;
+  out_info->gpano.cropped_width = out_info->gpano.cropped_height = -1;
+  out_info->gpano.cropped_left = out_info->gpano.cropped_top = -1;
+
+  if (media_size < 4)
+    return kInsFileErrorNotFound;
+
+  int64_t head_size = media_size < kInsJpegHeadReadSize ? media_size : kInsJpegHeadReadSize;
+  uint8_t* head = (uint8_t*)ins_allocate(allocator, (size_t)head_size);
+  if (!head)
+    return kInsFileErrorNoMemory;
+
+  if (ins_fseek64(file, 0, SEEK_SET) || fread(head, 1, (size_t)head_size, file) != (size_t)head_size) {
+    ins_release(allocator, head);
+    return kInsFileErrorIo;
+  }
+
+  if (head[0] != 0xFF || head[1] != kInsJpegMarkerSoi) {
+    ins_release(allocator, head);
+    return kInsFileErrorNotFound;
+  }
+
+  /* scan data must be found, walk stops at it */
+  int result = kInsFileErrorMediaCorrupted;
+  int64_t position = 2;
+  out_info->segments_count = 1;
+
+  while (position + 2 <= media_size) {
+    const uint8_t* header;
+    uint8_t* buffer;
+    uint32_t header_size = position + 4 <= media_size ? 4 : 2;
+
+    int read_result = ins_jpeg_read_range(file, head, head_size, position, header_size, allocator, &header, &buffer);
+    if (read_result < 0) {
+      result = read_result;
+      break;
+    }
+
+    uint8_t marker = header[1];
+    uint32_t length = header_size == 4 ? ((uint32_t)header[2] << 8) | header[3] : 0;
+    int valid = header[0] == 0xFF;
+    ins_release(allocator, buffer);
+
+    if (!valid || marker == kInsJpegMarkerEoi)
+      break;
+
+    /* fill bytes before marker */
+    if (marker == 0xFF) {
+      position++;
+      continue;
+    }
+
+    /* markers without length */
+    if (marker == kInsJpegMarkerSoi || marker == kInsJpegMarkerTem || (marker >= 0xD0 && marker <= 0xD7)) {
+      out_info->segments_count++;
+      position += 2;
+      continue;
+    }
+
+    if (length < 2 || position + 2 + length > media_size)
+      break;
+
+    out_info->segments_count++;
+
+    if (marker == kInsJpegMarkerSos) {
+      out_info->scan_offset = position + 2 + length;
+      result = 0;
+      break;
+    }
+
+    int64_t data_offset = position + 4;
+    uint32_t data_size = length - 2;
+    position += 2 + length;
+
+    int is_app1 = marker == kInsJpegMarkerApp1;
+    if (!is_app1 && !(ins_jpeg_is_sof(marker) && data_size >= 5))
+      continue;
+
+    const uint8_t* data;
+    read_result = ins_jpeg_read_range(file, head, head_size, data_offset, data_size, allocator, &data, &buffer);
+    if (read_result < 0) {
+      result = read_result;
+      break;
+    }
+
+    if (!is_app1) {
+      /* SOFn: precision, height, width */
+      out_info->height = ((uint32_t)data[1] << 8) | data[2];
+      out_info->width = ((uint32_t)data[3] << 8) | data[4];
+    } else if (data_size >= sizeof(kInsJpegExifId) && !memcmp(data, kInsJpegExifId, sizeof(kInsJpegExifId))) {
+      ins_jpeg_parse_exif(data + sizeof(kInsJpegExifId), data_size - sizeof(kInsJpegExifId), out_info);
+    } else if (data_size >= sizeof(kInsJpegXmpId) && !memcmp(data, kInsJpegXmpId, sizeof(kInsJpegXmpId))) {
+      ins_jpeg_parse_xmp(data + sizeof(kInsJpegXmpId), data_size - sizeof(kInsJpegXmpId), out_info);
+    }
+
+    ins_release(allocator, buffer);
+  }
+
+  ins_release(allocator, head);
+
+  /* EOI must end right where trailer starts, otherwise image was cut or trailer was written at wrong place */
+  if (!result) {
+    uint8_t eoi[2];
+
+    if (ins_fseek64(file, media_size - 2, SEEK_SET) || fread(eoi, 1, sizeof(eoi), file) != sizeof(eoi))
+      return kInsFileErrorIo;
+
+    out_info->ends_with_eoi = eoi[0] == 0xFF && eoi[1] == kInsJpegMarkerEoi;
+  }
+
+  return result;
+}
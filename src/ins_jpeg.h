@@ -0,0 +1,63 @@
+#ifndef INS_JPEG_HEADER
+#define INS_JPEG_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+
+// JPEG structure of INSP media region. Marker segments are walked from file start up to start of scan (SOS),
+// compressed scan data is never read. File head is read by one read of kInsJpegHeadReadSize bytes, segments
+// outside of it (large APPn) are read separately. EOI is checked by one 2-byte read before trailer start.
+//
+// Segment structure (big endian)
+// 0         0xFF marker   (2 bytes)
+// 2         length        (2 bytes)   includes length field, absent for SOI, EOI, TEM and RSTn
+// 4         data
+//
+// Used segments:
+// APP1 "Exif\0\0"                          TIFF structure: IFD0 Make, Model, DateTime; Exif IFD DateTimeOriginal
+// APP1 "http://ns.adobe.com/xap/1.0/\0"    XMP packet: GPano properties in attribute or element form
+// SOF0..SOF15 (except DHT, JPG, DAC)       image width and height
+
+#define kInsJpegHeadReadSize   (64*1024) /* APPn segments of camera stills fit, EXIF and XMP are limited to 64 KB */
+#define kInsJpegMaxTextSize    64
+
+/** GPano XMP properties (photo sphere), numbers are -1 when property is not present */
+typedef struct _InsJpegGPanoType {
+  char projection_type[kInsJpegMaxTextSize]; /** ProjectionType, empty - not present */
+  int64_t full_pano_width;                   /** FullPanoWidthPixels */
+  int64_t full_pano_height;                  /** FullPanoHeightPixels */
+  int64_t cropped_width;                     /** CroppedAreaImageWidthPixels */
+  int64_t cropped_height;                    /** CroppedAreaImageHeightPixels */
+  int64_t cropped_left;                      /** CroppedAreaLeftPixels */
+  int64_t cropped_top;                       /** CroppedAreaTopPixels */
+} InsJpegGPanoType;
+
+/** Media region structure of INSP */
+typedef struct _InsJpegInfoType {
+  int64_t media_size;                        /** Media region size, Insta360 trailer starts here */
+  int segments_count;                        /** Marker segments before scan data */
+  int64_t scan_offset;                       /** Scan data start, after SOS segment */
+  uint32_t width;                            /** Image size from SOFn, 0 - not found */
+  uint32_t height;
+  int ends_with_eoi;                         /** EOI marker ends exactly at trailer start */
+  int has_exif;                              /** EXIF segment found */
+  char make[kInsJpegMaxTextSize];            /** EXIF Make, empty - not present */
+  char model[kInsJpegMaxTextSize];           /** EXIF Model */
+  char capture_time[kInsJpegMaxTextSize];    /** EXIF DateTimeOriginal or DateTime, "YYYY:MM:DD HH:MM:SS" */
+  int has_xmp;                               /** XMP segment found */
+  InsJpegGPanoType gpano;
+} InsJpegInfoType;
+
+/**
+ * \brief    Walk JPEG marker segments of media region up to scan data, decode EXIF and XMP GPano fields
+ * \param    file        [in]  Input file handle
+ * \param    media_size  [in]  Media region size, see ins_get_media_size
+ * \param    allocator   [in]  Allocator of temporary head buffer
+ * \param    out_info    [out] Media structure
+ * \return   0 - success, kInsFileErrorNotFound - media is not JPEG (INSV mp4), kInsFileErrorMediaCorrupted -
+ *           wrong segment or no scan data, kInsFileErrorNoMemory, kInsFileErrorIo
+ */
+int ins_jpeg_read_info(FILE* file, int64_t media_size, const InsAllocatorType* allocator, InsJpegInfoType* out_info);
+
+#endif  // INS_JPEG_HEADER
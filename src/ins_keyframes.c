@@ -0,0 +1,198 @@
+#include <string.h>
+#include "ins_keyframes.h"
+#include "ins_file.h"
+
+void ins_keyframe_index_init(InsKeyframeIndexType* index, const InsAllocatorType* allocator) {
+  memset(index, 0, sizeof(*index));
+  vector_init(&index->keyframes);
+  index->allocator = allocator;
+}
+
+void ins_keyframe_index_destroy(InsKeyframeIndexType* index) {
+  ins_vector_destroy(index->allocator, &index->keyframes);
+  ins_keyframe_index_init(index, index->allocator);
+}
+
+int ins_keyframe_index_build(InsKeyframeIndexType* index, FILE* file, const InsMp4InfoType* info, int track_index) {
+  const InsMp4TrackType* track = &info->tracks[track_index];
+  const InsAllocatorType* allocator = index->allocator;
+  InsMp4SampleTablesType tables;
+
+  if (!track->stbl.type)
+    return kInsFileErrorNotFound;
+
+  int result = ins_mp4_read_sample_tables(file, &track->stbl, allocator, &tables);
+  if (result < 0) {
+    ins_mp4_release_sample_tables(&tables, allocator);
+    return result;
+  }
+
+  uint32_t default_size;
+  int64_t samples_count = ins_mp4_stsz_samples_count(tables.stsz, tables.stsz_size, &default_size);
+  int64_t stts_count = ins_mp4_table_entries_count(tables.stts, tables.stts_size, 8, 8);
+  int64_t stsc_count = ins_mp4_table_entries_count(tables.stsc, tables.stsc_size, 8, 12);
+  int64_t chunks_count = ins_mp4_table_entries_count(tables.stco, tables.stco_size, 8, tables.chunk_offset_size);
+  int64_t sync_count = tables.stss ? ins_mp4_table_entries_count(tables.stss, tables.stss_size, 8, 4) : samples_count;
+
+  if (samples_count < 0 || stts_count < 0 || stsc_count < 0 || chunks_count < 0 || sync_count < 0) {
+    ins_mp4_release_sample_tables(&tables, allocator);
+    return kInsFileErrorMediaCorrupted;
+  }
+
+  index->media_size = info->media_size;
+  index->moov_offset = info->moov.offset;
+  index->moov_size = info->moov.size;
+  index->track_id = track->track_id;
+  index->timescale = track->timescale;
+  index->samples_count = (uint32_t)samples_count;
+
+  if (ins_vector_reserve(InsKeyframeType, allocator, &index->keyframes, (int32_t)sync_count) < 0) {
+    ins_mp4_release_sample_tables(&tables, allocator);
+    return kInsFileErrorNoMemory;
+  }
+
+  /* one pass over samples in decode order: chunk runs from stsc, durations runs from stts, sync samples from stss.
+     All tables are sorted by sample or chunk number, so each is read by forward cursor */
+  const uint8_t* stsz_entries = tables.stsz + 12;
+  const uint8_t* stss_entries = tables.stss ? tables.stss + 8 : NULL;
+  int64_t stsc_next = 0, stts_next = 0, stss_next = 0;
+  uint32_t samples_per_chunk = 0, stts_left = 0, delta = 0;
+  uint32_t sample = 1;
+  uint64_t time = 0;
+
+  result = 0;
+
+  for (int64_t chunk = 1; chunk <= chunks_count && !result; chunk++) {
+    /* stsc entry applies from its first chunk up to first chunk of next entry */
+    while (stsc_next < stsc_count && ins_mp4_read_u32(tables.stsc + 8 + stsc_next * 12) <= chunk)
+      samples_per_chunk = ins_mp4_read_u32(tables.stsc + 8 + (stsc_next++) * 12 + 4);
+
+    const uint8_t* chunk_offset_data = tables.stco + 8 + (chunk - 1) * tables.chunk_offset_size;
+    int64_t offset = tables.chunk_offset_size == 8 ? (int64_t)ins_mp4_read_u64(chunk_offset_data) : ins_mp4_read_u32(chunk_offset_data);
+
+    for (uint32_t i = 0; i < samples_per_chunk; i++, sample++) {
+      if (sample > samples_count) {
+        result = kInsFileErrorMediaCorrupted;
+        break;
+      }
+
+      uint32_t size = default_size ? default_size : ins_mp4_read_u32(stsz_entries + (int64_t)(sample - 1) * 4);
+
+      while (!stts_left && stts_next < stts_count) {
+        stts_left = ins_mp4_read_u32(tables.stts + 8 + stts_next * 8);
+        delta = ins_mp4_read_u32(tables.stts + 8 + (stts_next++) * 8 + 4);
+      }
+
+      int is_sync = !stss_entries;
+      if (stss_entries && stss_next < sync_count && ins_mp4_read_u32(stss_entries + stss_next * 4) == sample) {
+        is_sync = 1;
+        stss_next++;
+      }
+
+      if (is_sync) {
+        InsKeyframeType* keyframe = &index->keyframes.a[index->keyframes.n++];
+
+        if (offset < 0 || offset + size > info->media_size) {
+          result = kInsFileErrorMediaCorrupted;
+          break;
+        }
+
+        keyframe->time = time;
+        keyframe->file_offset = offset;
+        keyframe->sample = sample;
+        keyframe->size = size;
+      }
+
+      offset += size;
+      time += delta;
+      if (stts_left)
+        stts_left--;
+    }
+  }
+
+  /* every sample must belong to chunk, every stss entry must be existing sample in ascending order */
+  if (!result && (sample != samples_count + 1 || stss_next != sync_count))
+    result = kInsFileErrorMediaCorrupted;
+
+  ins_mp4_release_sample_tables(&tables, allocator);
+
+  if (result < 0) {
+    index->keyframes.n = 0;
+    return result;
+  }
+
+  return vector_size(&index->keyframes);
+}
+
+int ins_keyframe_index_find(const InsKeyframeIndexType* index, uint64_t time) {
+  int32_t low = 0;
+  int32_t high = vector_size(&index->keyframes);
+
+  if (!high)
+    return kInsFileErrorNotFound;
+
+  /* first keyframe with time greater than requested, answer is previous one */
+  while (low < high) {
+    int32_t middle = low + (high - low) / 2;
+    if (vector_at(&index->keyframes, middle).time <= time)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low ? low - 1 : 0;
+}
+
+int ins_keyframe_index_write(const InsKeyframeIndexType* index, FILE* file_out) {
+  InsKeyframeFileHeaderType header;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kInsKeyframeFileMagic, kInsKeyframeFileMagicLength);
+  header.version = kInsKeyframeFileVersion;
+  header.track_id = index->track_id;
+  header.media_size = index->media_size;
+  header.moov_offset = index->moov_offset;
+  header.moov_size = index->moov_size;
+  header.timescale = index->timescale;
+  header.samples_count = index->samples_count;
+  header.keyframes_count = (uint32_t)vector_size(&index->keyframes);
+
+  if (fwrite(&header, 1, sizeof(header), file_out) != sizeof(header))
+    return kInsFileErrorIo;
+
+  size_t count = (size_t)vector_size(&index->keyframes);
+  if (count && fwrite(index->keyframes.a, sizeof(InsKeyframeType), count, file_out) != count)
+    return kInsFileErrorIo;
+
+  return 0;
+}
+
+int ins_keyframe_index_read(InsKeyframeIndexType* index, FILE* file, int64_t media_size, const InsMp4BoxType* moov) {
+  InsKeyframeFileHeaderType header;
+
+  if (fread(&header, 1, sizeof(header), file) != sizeof(header) ||
+      memcmp(header.magic, kInsKeyframeFileMagic, kInsKeyframeFileMagicLength) || header.version != kInsKeyframeFileVersion)
+    return kInsFileErrorCorrupted;
+
+  if (header.media_size != media_size || header.moov_offset != moov->offset || header.moov_size != moov->size)
+    return kInsFileErrorNotFound;
+
+  if (header.keyframes_count > header.samples_count || header.keyframes_count > INT32_MAX)
+    return kInsFileErrorCorrupted;
+
+  if (ins_vector_reserve(InsKeyframeType, index->allocator, &index->keyframes, (int32_t)header.keyframes_count) < 0)
+    return kInsFileErrorNoMemory;
+
+  if (fread(index->keyframes.a, sizeof(InsKeyframeType), header.keyframes_count, file) != header.keyframes_count)
+    return kInsFileErrorCorrupted;
+
+  index->keyframes.n = (int32_t)header.keyframes_count;
+  index->media_size = header.media_size;
+  index->moov_offset = header.moov_offset;
+  index->moov_size = header.moov_size;
+  index->track_id = header.track_id;
+  index->timescale = header.timescale;
+  index->samples_count = header.samples_count;
+
+  return vector_size(&index->keyframes);
+}
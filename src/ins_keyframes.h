@@ -0,0 +1,112 @@
+#ifndef INS_KEYFRAMES_HEADER
+#define INS_KEYFRAMES_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "c_vector.h"
+#include "ins_allocator.h"
+#include "ins_mp4.h"
+
+// Keyframe index of INSV video track: decode time, sample number and byte offset of each sync sample, so
+// external tools can cut clips at exact positions without loading moov through ffmpeg.
+//
+// Index is built from sample tables of one track (stts, stss, stsc, stsz, stco or co64), only these boxes
+// are read from file. Track without stss has sync samples only, all samples are indexed.
+//
+// Index can be saved to sidecar file and loaded without reading moov. Saved index stores media size and
+// moov location as key, index is rejected when media region was rewritten (moov moved, file cut, etc).
+// Trailer edits (stitching offset change) do not change media region and keep index valid.
+//
+// Index file structure (little endian)
+// 0         InsKeyframeFileHeaderType   (64 bytes)   magic "INSKFI01", key and track properties
+// 64        InsKeyframeType             (24 bytes)   keyframe 0
+// 88        InsKeyframeType             (24 bytes)   keyframe 1
+// .........................
+
+#define kInsKeyframeFileMagic        "INSKFI01"
+#define kInsKeyframeFileMagicLength  8
+#define kInsKeyframeFileVersion      1
+
+#pragma pack(push,1)
+
+/** Keyframe */
+typedef struct _InsKeyframeType {
+  uint64_t time;                             /** Decode time in track timescale units */
+  int64_t file_offset;                       /** Sample data offset from file start */
+  uint32_t sample;                           /** Sample number, from 1 as in stss */
+  uint32_t size;                             /** Sample data size */
+} InsKeyframeType;
+
+/** Index file header */
+typedef struct _InsKeyframeFileHeaderType {
+  char magic[kInsKeyframeFileMagicLength];   /** kInsKeyframeFileMagic, not zero-terminated */
+  uint32_t version;                          /** kInsKeyframeFileVersion */
+  uint32_t track_id;                         /** Indexed track */
+  int64_t media_size;                        /** Key: media region size */
+  int64_t moov_offset;                       /** Key: moov box location */
+  int64_t moov_size;
+  uint32_t timescale;                        /** Track time units per second */
+  uint32_t samples_count;                    /** Track samples count */
+  uint32_t keyframes_count;                  /** Keyframes following header */
+  uint32_t reserved[3];                      /** Zero */
+} InsKeyframeFileHeaderType;
+
+#pragma pack(pop)
+
+typedef vector_t(InsKeyframeType) InsKeyframeVector;
+
+/** Keyframe index of one track */
+typedef struct _InsKeyframeIndexType {
+  int64_t media_size;                        /** Key: media region size */
+  int64_t moov_offset;                       /** Key: moov box location */
+  int64_t moov_size;
+  uint32_t track_id;                         /** Indexed track */
+  uint32_t timescale;                        /** Track time units per second */
+  uint32_t samples_count;                    /** Track samples count */
+  InsKeyframeVector keyframes;               /** Sorted by sample number and time */
+  const InsAllocatorType* allocator;         /** Allocator of keyframes */
+} InsKeyframeIndexType;
+
+void ins_keyframe_index_init(InsKeyframeIndexType* index, const InsAllocatorType* allocator);
+void ins_keyframe_index_destroy(InsKeyframeIndexType* index);
+
+/**
+ * \brief    Build keyframe index from track sample tables. Only sample table boxes are read, temporary
+ *           tables are allocated by index allocator and released before return
+ * \param    index        [in,out] Index initialized by ins_keyframe_index_init, must be empty
+ * \param    file         [in]  Input file handle
+ * \param    info         [in]  Media structure from ins_mp4_read_info
+ * \param    track_index  [in]  Track index in info, see ins_mp4_find_track
+ * \return   Keyframes count - success, kInsFileErrorNotFound - track has no sample tables,
+ *           kInsFileErrorMediaCorrupted - inconsistent tables or sample outside media region,
+ *           kInsFileErrorNoMemory, kInsFileErrorIo
+ */
+int ins_keyframe_index_build(InsKeyframeIndexType* index, FILE* file, const InsMp4InfoType* info, int track_index);
+
+/**
+ * \brief    Find keyframe at or before given time, binary search
+ * \param    index   [in]  Keyframe index
+ * \param    time    [in]  Time in track timescale units
+ * \return   Keyframe index in index->keyframes, first keyframe for time before it,
+ *           kInsFileErrorNotFound - index is empty
+ */
+int ins_keyframe_index_find(const InsKeyframeIndexType* index, uint64_t time);
+
+/**
+ * \brief    Save index to file
+ * \return   0 - success, kInsFileErrorIo
+ */
+int ins_keyframe_index_write(const InsKeyframeIndexType* index, FILE* file_out);
+
+/**
+ * \brief    Load index saved by ins_keyframe_index_write
+ * \param    index        [in,out] Index initialized by ins_keyframe_index_init, must be empty
+ * \param    file         [in]  Index file handle
+ * \param    media_size   [in]  Current media region size of indexed file, see ins_get_media_size
+ * \param    moov         [in]  Current moov location of indexed file, see ins_mp4_find_box
+ * \return   Keyframes count - success, kInsFileErrorNotFound - index belongs to other media layout (stale),
+ *           kInsFileErrorCorrupted - wrong index file, kInsFileErrorNoMemory, kInsFileErrorIo
+ */
+int ins_keyframe_index_read(InsKeyframeIndexType* index, FILE* file, int64_t media_size, const InsMp4BoxType* moov);
+
+#endif  // INS_KEYFRAMES_HEADER
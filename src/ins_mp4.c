@@ -0,0 +1,444 @@
+#include <string.h>
+#include "ins_mp4.h"
+#include "ins_file.h"
+
+const char* ins_mp4_fourcc_string(uint32_t type, char out[5]) {
+  for (int i = 0; i < 4; i++) {
+    char c = (char)(type >> (24 - i * 8));
+    out[i] = (c >= 0x20 && c < 0x7F) ? c : '?';
+  }
+  out[4] = 0;
+  return out;
+}
+
+static int ins_mp4_is_fourcc(uint32_t type) {
+  for (int i = 0; i < 4; i++) {
+    uint8_t c = (uint8_t)(type >> (i * 8));
+    if (c < 0x20 || c >= 0x7F)
+      return 0;
+  }
+  return 1;
+}
+
+int ins_mp4_read_box_header(FILE* file, int64_t offset, int64_t end, InsMp4BoxType* out_box) {
+  uint8_t header[kInsMp4LargeBoxHeaderSize];
+  int64_t available = end - offset;
+
+  if (available < kInsMp4BoxHeaderSize)
+    return kInsFileErrorMediaCorrupted;
+
+  /* one read for both header forms, large size is rare but costs nothing to read with type */
+  size_t read_size = available < kInsMp4LargeBoxHeaderSize ? kInsMp4BoxHeaderSize : kInsMp4LargeBoxHeaderSize;
+
+  if (ins_fseek64(file, offset, SEEK_SET) || fread(header, 1, read_size, file) != read_size)
+    return kInsFileErrorIo;
+
+  uint32_t size = ins_mp4_read_u32(header);
+
+  out_box->type = ins_mp4_read_u32(header + 4);
+  out_box->offset = offset;
+  out_box->header_size = kInsMp4BoxHeaderSize;
+
+  if (size == 1) {
+    if (read_size < kInsMp4LargeBoxHeaderSize)
+      return kInsFileErrorMediaCorrupted;
+
+    out_box->header_size = kInsMp4LargeBoxHeaderSize;
+    out_box->size = (int64_t)ins_mp4_read_u64(header + 8);
+  } else if (size == 0) {
+    out_box->size = available;
+  } else {
+    out_box->size = size;
+  }
+
+  if (out_box->size < out_box->header_size || out_box->size > available)
+    return kInsFileErrorMediaCorrupted;
+
+  return 0;
+}
+
+int ins_mp4_find_box(FILE* file, int64_t offset, int64_t end, uint32_t type, InsMp4BoxType* out_box) {
+  while (offset < end) {
+    int result = ins_mp4_read_box_header(file, offset, end, out_box);
+    if (result < 0)
+      return result;
+
+    if (out_box->type == type)
+      return 0;
+
+    offset += out_box->size;
+  }
+
+  return kInsFileErrorNotFound;
+}
+
+int64_t ins_mp4_read_box_data(FILE* file, const InsMp4BoxType* box, const InsAllocatorType* allocator, uint8_t** out_data) {
+  int64_t size = box->size - box->header_size;
+
+  if (size > kInsMp4MaxMoovSize)
+    return kInsFileErrorMediaCorrupted;
+
+  uint8_t* data = (uint8_t*)ins_allocate(allocator, size ? (size_t)size : 1);
+  if (!data)
+    return kInsFileErrorNoMemory;
+
+  if (ins_fseek64(file, box->offset + box->header_size, SEEK_SET) || fread(data, 1, (size_t)size, file) != (size_t)size) {
+    ins_release(allocator, data);
+    return kInsFileErrorIo;
+  }
+
+  *out_data = data;
+  return size;
+}
+
+int ins_mp4_view_next_box(InsByteViewType parent, uint32_t* position, InsMp4BoxViewType* out_box) {
+  uint32_t available = parent.size - *position;
+
+  if (!available)
+    return 0;
+
+  if (available < kInsMp4BoxHeaderSize)
+    return kInsFileErrorMediaCorrupted;
+
+  const uint8_t* header = parent.data + *position;
+  uint64_t size = ins_mp4_read_u32(header);
+  uint32_t header_size = kInsMp4BoxHeaderSize;
+
+  if (size == 1) {
+    if (available < kInsMp4LargeBoxHeaderSize)
+      return kInsFileErrorMediaCorrupted;
+
+    header_size = kInsMp4LargeBoxHeaderSize;
+    size = ins_mp4_read_u64(header + 8);
+  } else if (size == 0) {
+    size = available;
+  }
+
+  if (size < header_size || size > available)
+    return kInsFileErrorMediaCorrupted;
+
+  out_box->type = ins_mp4_read_u32(header + 4);
+  out_box->offset = *position;
+  out_box->data = ins_byte_view_sub(parent, *position + header_size, (uint32_t)size - header_size);
+
+  *position += (uint32_t)size;
+  return 1;
+}
+
+int ins_mp4_view_find_box(InsByteViewType parent, uint32_t type, InsMp4BoxViewType* out_box) {
+  uint32_t position = 0;
+  int result;
+
+  while ((result = ins_mp4_view_next_box(parent, &position, out_box)) > 0) {
+    if (out_box->type == type)
+      return 0;
+  }
+
+  return result < 0 ? result : kInsFileErrorNotFound;
+}
+
+/** moov buffer and its position in file, used to convert box views to file locations */
+typedef struct _InsMp4MoovType {
+  const uint8_t* data;
+  int64_t file_offset;                       /** moov data start in file */
+} InsMp4MoovType;
+
+static void ins_mp4_view_location(const InsMp4MoovType* moov, InsByteViewType parent, const InsMp4BoxViewType* box, InsMp4BoxType* out_box) {
+  const uint8_t* start = parent.data + box->offset;
+
+  out_box->type = box->type;
+  out_box->header_size = (uint32_t)(box->data.data - start);
+  out_box->offset = moov->file_offset + (start - moov->data);
+  out_box->size = out_box->header_size + box->data.size;
+}
+
+static int ins_mp4_parse_mvhd(InsByteViewType data, InsMp4InfoType* info) {
+  if (data.size >= 32 && data.data[0] == 1) {
+    info->timescale = ins_mp4_read_u32(data.data + 20);
+    info->duration = ins_mp4_read_u64(data.data + 24);
+  } else if (data.size >= 20 && data.data[0] == 0) {
+    info->timescale = ins_mp4_read_u32(data.data + 12);
+    info->duration = ins_mp4_read_u32(data.data + 16);
+  } else {
+    return kInsFileErrorMediaCorrupted;
+  }
+  return 0;
+}
+
+static int ins_mp4_parse_tkhd(InsByteViewType data, InsMp4TrackType* track) {
+  /* version 1 has 64-bit times and duration, width and height are 16.16 fixed point at the end */
+  if (data.size >= 96 && data.data[0] == 1) {
+    track->track_id = ins_mp4_read_u32(data.data + 20);
+    track->width = ins_mp4_read_u32(data.data + 88) >> 16;
+    track->height = ins_mp4_read_u32(data.data + 92) >> 16;
+  } else if (data.size >= 84 && data.data[0] == 0) {
+    track->track_id = ins_mp4_read_u32(data.data + 12);
+    track->width = ins_mp4_read_u32(data.data + 76) >> 16;
+    track->height = ins_mp4_read_u32(data.data + 80) >> 16;
+  } else {
+    return kInsFileErrorMediaCorrupted;
+  }
+  return 0;
+}
+
+static int ins_mp4_parse_mdhd(InsByteViewType data, InsMp4TrackType* track) {
+  if (data.size >= 32 && data.data[0] == 1) {
+    track->timescale = ins_mp4_read_u32(data.data + 20);
+    track->duration = ins_mp4_read_u64(data.data + 24);
+  } else if (data.size >= 20 && data.data[0] == 0) {
+    track->timescale = ins_mp4_read_u32(data.data + 12);
+    track->duration = ins_mp4_read_u32(data.data + 16);
+  } else {
+    return kInsFileErrorMediaCorrupted;
+  }
+  return 0;
+}
+
+/** Decode first sample entry of stsd: codec and, for visual entries, coded size */
+static int ins_mp4_parse_stsd(InsByteViewType data, uint32_t* out_codec, uint32_t* out_width, uint32_t* out_height) {
+  InsMp4BoxViewType entry;
+  uint32_t position = 0;
+
+  if (data.size < 8)
+    return kInsFileErrorMediaCorrupted;
+
+  if (!ins_mp4_read_u32(data.data + 4))
+    return 0;
+
+  /* entries follow version, flags and entry count */
+  int result = ins_mp4_view_next_box(ins_byte_view_sub(data, 8, data.size - 8), &position, &entry);
+  if (result <= 0)
+    return result < 0 ? result : kInsFileErrorMediaCorrupted;
+
+  *out_codec = entry.type;
+
+  /* VisualSampleEntry: 6 reserved, data reference index, 16 predefined and reserved, width, height */
+  if (entry.data.size >= 28) {
+    *out_width = ins_mp4_read_u16(entry.data.data + 24);
+    *out_height = ins_mp4_read_u16(entry.data.data + 26);
+  }
+
+  return 0;
+}
+
+static int ins_mp4_parse_trak(const InsMp4MoovType* moov, InsByteViewType data, InsMp4TrackType* track) {
+  InsMp4BoxViewType box, mdia, minf, stbl;
+  uint32_t entry_width = 0, entry_height = 0;
+
+  int result = ins_mp4_view_find_box(data, kInsMp4BoxTkhd, &box);
+  if (!result)
+    result = ins_mp4_parse_tkhd(box.data, track);
+  if (result < 0)
+    return result;
+
+  result = ins_mp4_view_find_box(data, kInsMp4BoxMdia, &mdia);
+  if (result < 0)
+    return result == kInsFileErrorNotFound ? 0 : result;
+
+  result = ins_mp4_view_find_box(mdia.data, kInsMp4BoxMdhd, &box);
+  if (!result)
+    result = ins_mp4_parse_mdhd(box.data, track);
+  if (result < 0 && result != kInsFileErrorNotFound)
+    return result;
+
+  result = ins_mp4_view_find_box(mdia.data, kInsMp4BoxHdlr, &box);
+  if (!result && box.data.size >= 12)
+    track->handler = ins_mp4_read_u32(box.data.data + 8);
+  else if (result != kInsFileErrorNotFound)
+    return result < 0 ? result : kInsFileErrorMediaCorrupted;
+
+  result = ins_mp4_view_find_box(mdia.data, kInsMp4BoxMinf, &minf);
+  if (!result)
+    result = ins_mp4_view_find_box(minf.data, kInsMp4BoxStbl, &stbl);
+  if (result < 0)
+    return result == kInsFileErrorNotFound ? 0 : result;
+
+  ins_mp4_view_location(moov, minf.data, &stbl, &track->stbl);
+
+  result = ins_mp4_view_find_box(stbl.data, kInsMp4BoxStsd, &box);
+  if (!result) {
+    ins_mp4_view_location(moov, stbl.data, &box, &track->stsd);
+    result = ins_mp4_parse_stsd(box.data, &track->codec, &entry_width, &entry_height);
+  }
+  if (result < 0 && result != kInsFileErrorNotFound)
+    return result;
+
+  /* tkhd size is presentation size, may be scaled, sample entry has coded size */
+  if (track->handler == kInsMp4HandlerVideo && entry_width && entry_height) {
+    track->width = entry_width;
+    track->height = entry_height;
+  }
+
+  return 0;
+}
+
+static int ins_mp4_parse_moov(const InsMp4MoovType* moov, InsByteViewType data, InsMp4InfoType* info) {
+  InsMp4BoxViewType box;
+  uint32_t position = 0;
+  int result;
+
+  while ((result = ins_mp4_view_next_box(data, &position, &box)) > 0) {
+    if (box.type == kInsMp4BoxMvhd) {
+      result = ins_mp4_parse_mvhd(box.data, info);
+    } else if (box.type == kInsMp4BoxTrak) {
+      if (info->tracks_count < kInsMp4MaxTracks)
+        result = ins_mp4_parse_trak(moov, box.data, &info->tracks[info->tracks_count]);
+      info->tracks_count++;
+    }
+
+    if (result < 0)
+      return result;
+  }
+
+  return result;
+}
+
+int ins_mp4_read_info(FILE* file, int64_t media_size, const InsAllocatorType* allocator, InsMp4InfoType* out_info) {
+  InsMp4BoxType box;
+  int64_t offset = 0;
+  int result;
+
+  memset(out_info, 0, sizeof(*out_info));
+  out_info->media_size = media_size;
+
+  /* headers only: mdat data is skipped by seek, so read count depends on boxes count, not file size */
+  while (offset < media_size) {
+    result = ins_mp4_read_box_header(file, offset, media_size, &box);
+
+    /* first bytes are not box header: JPEG or other non-mp4 media */
+    if (!out_info->boxes_count && (result == kInsFileErrorMediaCorrupted || (!result && !ins_mp4_is_fourcc(box.type))))
+      return kInsFileErrorNotFound;
+
+    if (result < 0)
+      return result;
+
+    if (box.type == kInsMp4BoxFtyp && !out_info->ftyp.type) {
+      uint8_t brand[4];
+
+      out_info->ftyp = box;
+      if (box.size >= box.header_size + 4 && !ins_fseek64(file, box.offset + box.header_size, SEEK_SET) && 
+          fread(brand, 1, 4, file) == 4)
+        out_info->major_brand = ins_mp4_read_u32(brand);
+    } else if (box.type == kInsMp4BoxMoov && !out_info->moov.type) {
+      out_info->moov = box;
+    } else if (box.type == kInsMp4BoxMdat && !out_info->mdat.type) {
+      out_info->mdat = box;
+    }
+
+    out_info->boxes_count++;
+    offset += box.size;
+  }
+
+  if (!out_info->ftyp.type && !out_info->moov.type)
+    return kInsFileErrorNotFound;
+
+  /* recording interrupted before moov was written */
+  if (!out_info->moov.type)
+    return kInsFileErrorMediaCorrupted;
+
+  uint8_t* moov_data;
+  int64_t moov_size = ins_mp4_read_box_data(file, &out_info->moov, allocator, &moov_data);
+  if (moov_size < 0)
+    return (int)moov_size;
+
+  InsMp4MoovType moov;
+  moov.data = moov_data;
+  moov.file_offset = out_info->moov.offset + out_info->moov.header_size;
+
+  result = ins_mp4_parse_moov(&moov, ins_byte_view(moov_data, (uint32_t)moov_size), out_info);
+
+  ins_release(allocator, moov_data);
+  return result < 0 ? result : 0;
+}
+
+int ins_mp4_find_track(const InsMp4InfoType* info, uint32_t handler) {
+  int count = info->tracks_count < kInsMp4MaxTracks ? info->tracks_count : kInsMp4MaxTracks;
+
+  for (int i = 0; i < count; i++) {
+    if (info->tracks[i].handler == handler)
+      return i;
+  }
+  return kInsFileErrorNotFound;
+}
+
+int ins_mp4_read_sample_tables(FILE* file, const InsMp4BoxType* stbl, const InsAllocatorType* allocator, InsMp4SampleTablesType* out_tables) {
+  int64_t offset = stbl->offset + stbl->header_size;
+  int64_t end = stbl->offset + stbl->size;
+  InsMp4BoxType box;
+
+  memset(out_tables, 0, sizeof(*out_tables));
+
+  while (offset < end) {
+    int result = ins_mp4_read_box_header(file, offset, end, &box);
+    if (result < 0)
+      return result;
+
+    uint8_t** data = NULL;
+    int64_t* size = NULL;
+
+    switch (box.type) {
+    case kInsMp4BoxStts: data = &out_tables->stts; size = &out_tables->stts_size; break;
+    case kInsMp4BoxCtts: data = &out_tables->ctts; size = &out_tables->ctts_size; break;
+    case kInsMp4BoxStss: data = &out_tables->stss; size = &out_tables->stss_size; break;
+    case kInsMp4BoxStsc: data = &out_tables->stsc; size = &out_tables->stsc_size; break;
+    case kInsMp4BoxStsz: data = &out_tables->stsz; size = &out_tables->stsz_size; break;
+    case kInsMp4BoxStco:
+    case kInsMp4BoxCo64:
+      data = &out_tables->stco;
+      size = &out_tables->stco_size;
+      out_tables->chunk_offset_size = box.type == kInsMp4BoxCo64 ? 8 : 4;
+      break;
+    }
+
+    if (data && !*data) {
+      *size = ins_mp4_read_box_data(file, &box, allocator, data);
+      if (*size < 0) {
+        result = (int)*size;
+        *size = 0;
+        return result;
+      }
+    }
+
+    offset += box.size;
+  }
+
+  if (!out_tables->stts || !out_tables->stsc || !out_tables->stsz || !out_tables->stco)
+    return kInsFileErrorNotFound;
+
+  return 0;
+}
+
+void ins_mp4_release_sample_tables(InsMp4SampleTablesType* tables, const InsAllocatorType* allocator) {
+  uint8_t* buffers[6] = { tables->stts, tables->ctts, tables->stss, tables->stsc, tables->stsz, tables->stco };
+
+  for (int i = 0; i < 6; i++) {
+    if (buffers[i])
+      ins_release(allocator, buffers[i]);
+  }
+  memset(tables, 0, sizeof(*tables));
+}
+
+int64_t ins_mp4_table_entries_count(const uint8_t* data, int64_t size, int64_t header_size, int64_t entry_size) {
+  if (size < header_size)
+    return kInsFileErrorMediaCorrupted;
+
+  int64_t count = ins_mp4_read_u32(data + header_size - 4);
+  if (count > (size - header_size) / entry_size)
+    return kInsFileErrorMediaCorrupted;
+
+  return count;
+}
+
+int64_t ins_mp4_stsz_samples_count(const uint8_t* stsz, int64_t size, uint32_t* out_default_size) {
+  *out_default_size = 0;
+
+  if (size < 12)
+    return kInsFileErrorMediaCorrupted;
+
+  /* constant sample size: box ends after sample count */
+  *out_default_size = ins_mp4_read_u32(stsz + 4);
+  if (*out_default_size)
+    return ins_mp4_read_u32(stsz + 8);
+
+  return ins_mp4_table_entries_count(stsz, size, 12, 4);
+}
@@ -0,0 +1,254 @@
+#ifndef INS_MP4_HEADER
+#define INS_MP4_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+#include "ins_trailer_view.h"
+
+// ISO-BMFF (mp4) structure of INSV media region. Top-level boxes are found by reading box headers only
+// (8 or 16 bytes per box), so multi-GB mdat is skipped by one seek. Only moov is read to memory.
+//
+// Box structure (big endian)
+// 0         size         (4 bytes)   box size including header, 1 - 64-bit size follows type, 0 - up to media end
+// 4         type         (4 bytes)   four character code
+// 8         large size   (8 bytes)   only when size is 1
+// 8/16      box data
+//
+// Camera writes ftyp, mdat, moov. Boxes must cover media region exactly: last box ends where Insta360
+// trailer starts, otherwise kInsFileErrorMediaCorrupted is returned (for example mdat overlaps trailer
+// after wrong trailer edit).
+//
+// Used moov boxes:
+// moov/mvhd                  movie timescale and duration
+// moov/trak/tkhd             track id, presentation width and height (16.16 fixed point)
+// moov/trak/mdia/mdhd        media timescale and duration
+// moov/trak/mdia/hdlr        handler type ('vide', 'soun', ...)
+// moov/trak/mdia/minf/stbl   sample tables, location is saved for lazy decoding
+// .../stbl/stsd              first sample entry: codec ('avc1', 'hvc1', ...), coded width and height
+
+#define kInsMp4FourCC(a, b, c, d)  (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+#define kInsMp4BoxHeaderSize       8
+#define kInsMp4LargeBoxHeaderSize  16
+#define kInsMp4MaxTracks           4
+#define kInsMp4MaxMoovSize         (64*1024*1024) /* Hours of video have few MB moov, larger value is corruption */
+
+/** Box types */
+enum InsMp4BoxTypes {
+  kInsMp4BoxFtyp = kInsMp4FourCC('f', 't', 'y', 'p'),
+  kInsMp4BoxMoov = kInsMp4FourCC('m', 'o', 'o', 'v'),
+  kInsMp4BoxMdat = kInsMp4FourCC('m', 'd', 'a', 't'),
+  kInsMp4BoxFree = kInsMp4FourCC('f', 'r', 'e', 'e'),
+  kInsMp4BoxMvhd = kInsMp4FourCC('m', 'v', 'h', 'd'),
+  kInsMp4BoxTrak = kInsMp4FourCC('t', 'r', 'a', 'k'),
+  kInsMp4BoxTkhd = kInsMp4FourCC('t', 'k', 'h', 'd'),
+  kInsMp4BoxMdia = kInsMp4FourCC('m', 'd', 'i', 'a'),
+  kInsMp4BoxMdhd = kInsMp4FourCC('m', 'd', 'h', 'd'),
+  kInsMp4BoxHdlr = kInsMp4FourCC('h', 'd', 'l', 'r'),
+  kInsMp4BoxMinf = kInsMp4FourCC('m', 'i', 'n', 'f'),
+  kInsMp4BoxStbl = kInsMp4FourCC('s', 't', 'b', 'l'),
+  kInsMp4BoxStsd = kInsMp4FourCC('s', 't', 's', 'd'),
+  kInsMp4BoxEdts = kInsMp4FourCC('e', 'd', 't', 's'),
+  kInsMp4BoxStts = kInsMp4FourCC('s', 't', 't', 's'),
+  kInsMp4BoxCtts = kInsMp4FourCC('c', 't', 't', 's'),
+  kInsMp4BoxStss = kInsMp4FourCC('s', 't', 's', 's'),
+  kInsMp4BoxStsc = kInsMp4FourCC('s', 't', 's', 'c'),
+  kInsMp4BoxStsz = kInsMp4FourCC('s', 't', 's', 'z'),
+  kInsMp4BoxStco = kInsMp4FourCC('s', 't', 'c', 'o'),
+  kInsMp4BoxCo64 = kInsMp4FourCC('c', 'o', '6', '4'),
+  kInsMp4BoxSdtp = kInsMp4FourCC('s', 'd', 't', 'p'),
+  kInsMp4BoxSbgp = kInsMp4FourCC('s', 'b', 'g', 'p'),
+  kInsMp4BoxStps = kInsMp4FourCC('s', 't', 'p', 's')
+};
+
+/** Handler types */
+#define kInsMp4HandlerVideo  kInsMp4FourCC('v', 'i', 'd', 'e')
+#define kInsMp4HandlerAudio  kInsMp4FourCC('s', 'o', 'u', 'n')
+
+/** Box location in file */
+typedef struct _InsMp4BoxType {
+  uint32_t type;                             /** Four character code, 0 - box not found */
+  uint32_t header_size;                      /** kInsMp4BoxHeaderSize or kInsMp4LargeBoxHeaderSize */
+  int64_t offset;                            /** Box start from file start */
+  int64_t size;                              /** Box size including header */
+} InsMp4BoxType;
+
+/** Box inside memory buffer (moov data) */
+typedef struct _InsMp4BoxViewType {
+  uint32_t type;                             /** Four character code */
+  uint32_t offset;                           /** Box start from parent data start */
+  InsByteViewType data;                      /** Box data, header is not included */
+} InsMp4BoxViewType;
+
+/** Track properties */
+typedef struct _InsMp4TrackType {
+  uint32_t track_id;                         /** Track id from tkhd */
+  uint32_t handler;                          /** Handler type, kInsMp4HandlerVideo, kInsMp4HandlerAudio, ... */
+  uint32_t codec;                            /** First sample entry type, 0 - no sample entries */
+  uint32_t width;                            /** Video: coded width from sample entry, other: tkhd width */
+  uint32_t height;                           /** Video: coded height from sample entry, other: tkhd height */
+  uint32_t timescale;                        /** Media time units per second (mdhd) */
+  uint64_t duration;                         /** Media duration in timescale units */
+  InsMp4BoxType stbl;                        /** Sample table box, type is 0 when track has no sample table */
+  InsMp4BoxType stsd;                        /** Sample descriptions box (codec configuration), type is 0 when absent */
+} InsMp4TrackType;
+
+/** Media region structure */
+typedef struct _InsMp4InfoType {
+  int64_t media_size;                        /** Media region size, Insta360 trailer starts here */
+  uint32_t major_brand;                      /** ftyp major brand */
+  InsMp4BoxType ftyp;                        /** Top-level boxes */
+  InsMp4BoxType moov;
+  InsMp4BoxType mdat;                        /** First mdat box */
+  int boxes_count;                           /** Top-level boxes count */
+  uint32_t timescale;                        /** Movie time units per second (mvhd) */
+  uint64_t duration;                         /** Movie duration in timescale units */
+  int tracks_count;                          /** Tracks count, only first kInsMp4MaxTracks are decoded */
+  InsMp4TrackType tracks[kInsMp4MaxTracks];
+} InsMp4InfoType;
+
+/** Sample table boxes of one track, box data without headers, NULL - box not present */
+typedef struct _InsMp4SampleTablesType {
+  uint8_t* stts;                             /** Decode time deltas, runs of (count, delta) */
+  uint8_t* ctts;                             /** Composition offsets, runs of (count, offset), optional */
+  uint8_t* stss;                             /** Sync sample numbers, optional: all samples are sync */
+  uint8_t* stsc;                             /** Sample to chunk runs of (first chunk, samples per chunk, description) */
+  uint8_t* stsz;                             /** Sample sizes */
+  uint8_t* stco;                             /** Chunk offsets, stco or co64 */
+  int64_t stts_size;
+  int64_t ctts_size;
+  int64_t stss_size;
+  int64_t stsc_size;
+  int64_t stsz_size;
+  int64_t stco_size;
+  int chunk_offset_size;                     /** 4 - stco, 8 - co64 */
+} InsMp4SampleTablesType;
+
+static inline uint16_t ins_mp4_read_u16(const uint8_t* p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t ins_mp4_read_u32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t ins_mp4_read_u64(const uint8_t* p) {
+  return ((uint64_t)ins_mp4_read_u32(p) << 32) | ins_mp4_read_u32(p + 4);
+}
+
+static inline void ins_mp4_write_u32(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)(value >> 24);
+  p[1] = (uint8_t)(value >> 16);
+  p[2] = (uint8_t)(value >> 8);
+  p[3] = (uint8_t)value;
+}
+
+static inline void ins_mp4_write_u64(uint8_t* p, uint64_t value) {
+  ins_mp4_write_u32(p, (uint32_t)(value >> 32));
+  ins_mp4_write_u32(p + 4, (uint32_t)value);
+}
+
+/** Four character code as string, out must have 5 bytes, non-printable characters are replaced by '?' */
+const char* ins_mp4_fourcc_string(uint32_t type, char out[5]);
+
+/**
+ * \brief    Read box header
+ * \param    file       [in]  Input file handle
+ * \param    offset     [in]  Box start
+ * \param    end        [in]  Parent end (media size for top-level boxes), box must end before it
+ * \param    out_box    [out] Box location, size 0 in file is replaced by size up to end
+ * \return   0 - success, kInsFileErrorMediaCorrupted - wrong size, kInsFileErrorIo
+ */
+int ins_mp4_read_box_header(FILE* file, int64_t offset, int64_t end, InsMp4BoxType* out_box);
+
+/**
+ * \brief    Find first box with given type among sibling boxes, headers only are read
+ * \param    file       [in]  Input file handle
+ * \param    offset     [in]  First sibling start (parent data start)
+ * \param    end        [in]  Parent end
+ * \param    type       [in]  Box type
+ * \param    out_box    [out] Box location
+ * \return   0 - success, kInsFileErrorNotFound, kInsFileErrorMediaCorrupted, kInsFileErrorIo
+ */
+int ins_mp4_find_box(FILE* file, int64_t offset, int64_t end, uint32_t type, InsMp4BoxType* out_box);
+
+/**
+ * \brief    Read box data (without header) to allocated buffer
+ * \param    file       [in]  Input file handle
+ * \param    box        [in]  Box location
+ * \param    allocator  [in]  Allocator of buffer
+ * \param    out_data   [out] Function saves buffer pointer, caller releases it by allocator
+ * \return   Data size - success, kInsFileErrorMediaCorrupted - box larger than kInsMp4MaxMoovSize,
+ *           kInsFileErrorNoMemory, kInsFileErrorIo
+ */
+int64_t ins_mp4_read_box_data(FILE* file, const InsMp4BoxType* box, const InsAllocatorType* allocator, uint8_t** out_data);
+
+/**
+ * \brief    Get next child box inside memory buffer
+ * \param    parent     [in]      Parent box data
+ * \param    position   [in,out]  Next child offset in parent data, start from 0
+ * \param    out_box    [out]     Child box view
+ * \return   1 - box found, 0 - no more boxes, kInsFileErrorMediaCorrupted
+ */
+int ins_mp4_view_next_box(InsByteViewType parent, uint32_t* position, InsMp4BoxViewType* out_box);
+
+/**
+ * \brief    Find first child box with given type inside memory buffer
+ * \return   0 - success, kInsFileErrorNotFound, kInsFileErrorMediaCorrupted
+ */
+int ins_mp4_view_find_box(InsByteViewType parent, uint32_t type, InsMp4BoxViewType* out_box);
+
+/**
+ * \brief    Walk top-level boxes of media region, decode movie and track properties from moov
+ * \param    file        [in]  Input file handle
+ * \param    media_size  [in]  Media region size, see ins_get_media_size
+ * \param    allocator   [in]  Allocator of temporary moov buffer
+ * \param    out_info    [out] Media structure
+ * \return   0 - success, kInsFileErrorNotFound - media is not mp4 (INSP JPEG), kInsFileErrorMediaCorrupted -
+ *           wrong box or boxes do not end at trailer start, kInsFileErrorNoMemory, kInsFileErrorIo
+ */
+int ins_mp4_read_info(FILE* file, int64_t media_size, const InsAllocatorType* allocator, InsMp4InfoType* out_info);
+
+/**
+ * \brief    Read sample table boxes of track, other stbl children (stsd, sdtp, ...) are skipped by headers
+ * \param    file        [in]  Input file handle
+ * \param    stbl        [in]  Sample table box location from track info
+ * \param    allocator   [in]  Allocator of table buffers
+ * \param    out_tables  [out] Tables, release by ins_mp4_release_sample_tables also on error
+ * \return   0 - success, kInsFileErrorNotFound - required table is missing, kInsFileErrorMediaCorrupted,
+ *           kInsFileErrorNoMemory, kInsFileErrorIo
+ */
+int ins_mp4_read_sample_tables(FILE* file, const InsMp4BoxType* stbl, const InsAllocatorType* allocator, InsMp4SampleTablesType* out_tables);
+
+void ins_mp4_release_sample_tables(InsMp4SampleTablesType* tables, const InsAllocatorType* allocator);
+
+/**
+ * \brief    Check table full box (version, flags, ..., entry count, entries) and get entry count
+ * \param    data          [in]  Box data
+ * \param    size          [in]  Box data size
+ * \param    header_size   [in]  Size of fields before entries, entry count is the last of them
+ * \param    entry_size    [in]  Entry size
+ * \return   Entry count - success, kInsFileErrorMediaCorrupted - entries do not fit box
+ */
+int64_t ins_mp4_table_entries_count(const uint8_t* data, int64_t size, int64_t header_size, int64_t entry_size);
+
+/**
+ * \brief    Check stsz box (version, flags, default sample size, sample count, sizes) and get sample count.
+ *           Sizes table is present only when default sample size is 0
+ * \param    stsz               [in]  Box data
+ * \param    size               [in]  Box data size
+ * \param    out_default_size   [out] Default sample size, 0 - each sample has its size in table
+ * \return   Sample count - success, kInsFileErrorMediaCorrupted - box too short or sizes do not fit box
+ */
+int64_t ins_mp4_stsz_samples_count(const uint8_t* stsz, int64_t size, uint32_t* out_default_size);
+
+/**
+ * \brief    Find first decoded track with given handler
+ * \param    info      [in]  Media structure from ins_mp4_read_info
+ * \param    handler   [in]  Handler type, for example kInsMp4HandlerVideo
+ * \return   Track index - success, kInsFileErrorNotFound
+ */
+int ins_mp4_find_track(const InsMp4InfoType* info, uint32_t handler);
+
+#endif  // INS_MP4_HEADER
@@ -0,0 +1,1460 @@
+#include <string.h>
+#include "ins_mp4_edit.h"
+#include "ins_file.h"
+#include "ins_trailer_streams.h"
+
+typedef vector_t(uint8_t) InsByteVector;
+
+static int ins_mp4_is_container(uint32_t type) {
+  return type == kInsMp4BoxMoov || type == kInsMp4BoxTrak || type == kInsMp4BoxMdia ||
+    type == kInsMp4BoxMinf || type == kInsMp4BoxStbl;
+}
+
+/** Add delta to chunk offsets inside [begin, end) range, walks moov children recursively */
+static int ins_mp4_shift_chunk_offsets(uint8_t* data, uint32_t size, int64_t begin, int64_t end, int64_t delta) {
+  InsByteViewType parent = ins_byte_view(data, size);
+  InsMp4BoxViewType box;
+  uint32_t position = 0;
+  int result;
+
+  while ((result = ins_mp4_view_next_box(parent, &position, &box)) > 0) {
+    /* views are const, box data is inside our moov buffer */
+    uint8_t* box_data = data + (box.data.data - parent.data);
+
+    if (ins_mp4_is_container(box.type)) {
+      result = ins_mp4_shift_chunk_offsets(box_data, box.data.size, begin, end, delta);
+      if (result < 0)
+        return result;
+      continue;
+    }
+
+    if (box.type != kInsMp4BoxStco && box.type != kInsMp4BoxCo64)
+      continue;
+
+    uint32_t entry_size = box.type == kInsMp4BoxCo64 ? 8 : 4;
+    if (box.data.size < 8)
+      return kInsFileErrorMediaCorrupted;
+
+    uint32_t count = ins_mp4_read_u32(box_data + 4);
+    if (count > (box.data.size - 8) / entry_size)
+      return kInsFileErrorMediaCorrupted;
+
+    for (uint32_t i = 0; i < count; i++) {
+      uint8_t* entry = box_data + 8 + (size_t)i * entry_size;
+      int64_t offset = entry_size == 8 ? (int64_t)ins_mp4_read_u64(entry) : ins_mp4_read_u32(entry);
+
+      if (offset < begin || offset >= end)
+        continue;
+
+      offset += delta;
+
+      if (entry_size == 8) {
+        ins_mp4_write_u64(entry, (uint64_t)offset);
+      } else {
+        if (offset > UINT32_MAX)
+          return kInsFileErrorInvalidArgument;
+        ins_mp4_write_u32(entry, (uint32_t)offset);
+      }
+    }
+  }
+
+  return result;
+}
+
+/** Write box header, large form is kept so box size does not change */
+static int ins_mp4_write_box_header(FILE* file_out, const InsMp4BoxType* box) {
+  uint8_t header[kInsMp4LargeBoxHeaderSize];
+
+  if (box->header_size == kInsMp4LargeBoxHeaderSize) {
+    ins_mp4_write_u32(header, 1);
+    ins_mp4_write_u32(header + 4, box->type);
+    ins_mp4_write_u64(header + 8, (uint64_t)box->size);
+  } else {
+    ins_mp4_write_u32(header, (uint32_t)box->size);
+    ins_mp4_write_u32(header + 4, box->type);
+  }
+
+  return fwrite(header, 1, box->header_size, file_out) == box->header_size ? 0 : kInsFileErrorIo;
+}
+
+int ins_write_faststart(FILE* file, FILE* file_out, const InsAllocatorType* allocator, const InsAllocatorType* io_allocator) {
+  InsMp4InfoType info;
+  InsFileTrailerHeaderType trailer_info;
+  InsTrailerViewType trailer;
+  uint8_t* trailer_data;
+  uint8_t* moov_data;
+
+  if (!io_allocator)
+    io_allocator = allocator;
+
+  int64_t media_size = ins_get_media_size(file);
+  if (media_size < 0)
+    return (int)media_size;
+
+  int result = ins_mp4_read_info(file, media_size, allocator, &info);
+  if (result < 0)
+    return result;
+
+  if (!info.mdat.type || info.moov.offset < info.mdat.offset)
+    return kInsMp4AlreadyFastStart;
+
+  /* everything is read and checked before first byte is written */
+  result = ins_read_allocate_trailer(file, allocator, &trailer_data, &trailer_info);
+  if (result < 0)
+    return result;
+
+  result = ins_trailer_view_init(&trailer, trailer_data, trailer_info.trailer_len);
+  if (result < 0) {
+    ins_free_trailer_buffer(allocator, trailer_data);
+    return result;
+  }
+
+  int64_t moov_size = ins_mp4_read_box_data(file, &info.moov, allocator, &moov_data);
+  if (moov_size < 0) {
+    ins_free_trailer_buffer(allocator, trailer_data);
+    return (int)moov_size;
+  }
+
+  /* moov is inserted before mdat: data between mdat start and old moov position moves by moov size,
+     boxes after old moov keep their positions */
+  int64_t moved_end = info.moov.offset;
+  int64_t moov_end = info.moov.offset + info.moov.size;
+
+  result = ins_mp4_shift_chunk_offsets(moov_data, (uint32_t)moov_size, info.mdat.offset, moved_end, info.moov.size);
+
+  /* new layout: boxes before mdat, moov, boxes from mdat to old moov, boxes after old moov, trailer */
+  if (!result)
+    result = ins_copy_file_region(file, 0, info.mdat.offset, file_out, io_allocator);
+
+  if (!result)
+    result = ins_mp4_write_box_header(file_out, &info.moov);
+
+  if (!result && fwrite(moov_data, 1, (size_t)moov_size, file_out) != (size_t)moov_size)
+    result = kInsFileErrorIo;
+
+  if (!result)
+    result = ins_copy_file_region(file, info.mdat.offset, moved_end - info.mdat.offset, file_out, io_allocator);
+
+  if (!result && moov_end < media_size)
+    result = ins_copy_file_region(file, moov_end, media_size - moov_end, file_out, io_allocator);
+
+  if (!result)
+    result = ins_write_trailer(&trailer, NULL, file_out, allocator, NULL);
+
+  ins_release(allocator, moov_data);
+  ins_free_trailer_buffer(allocator, trailer_data);
+  return result;
+}
+
+/** Kept samples of one track and rebuilt sample tables (full box data without box header) */
+typedef struct _InsTrimTrackType {
+  int has_tables;                            /** 0 - track has no sample tables, trak is copied unchanged */
+  uint32_t timescale;                        /** Media time units per second */
+  uint32_t samples_count;                    /** Samples count of input track */
+  uint32_t first_sample;                     /** First kept sample, from 1 */
+  uint32_t end_sample;                       /** Sample after last kept one */
+  uint64_t first_time;                       /** Decode time of first kept sample */
+  uint64_t end_time;                         /** Decode time after last kept sample */
+  int64_t data_begin;                        /** Kept sample data range in input file, empty when nothing is kept */
+  int64_t data_end;
+  InsByteVector stts;
+  InsByteVector ctts;                        /** Empty when input has no ctts */
+  InsByteVector stss;                        /** Empty when input has no stss */
+  InsByteVector stsc;
+  InsByteVector stsz;
+  InsInt64Vector chunk_offsets;              /** Kept chunks, offsets of first kept sample in input file */
+} InsTrimTrackType;
+
+/** Trim state shared by moov rebuild passes */
+typedef struct _InsTrimContextType {
+  const InsAllocatorType* allocator;
+  InsMp4InfoType info;
+  InsTrimTrackType tracks[kInsMp4MaxTracks];
+  int64_t data_begin;                        /** Copied range of input media region */
+  int64_t data_end;
+  int64_t data_offset;                       /** Output position of data_begin */
+  int wide_offsets;                          /** Chunk offsets are written to co64 */
+  uint64_t movie_duration;                   /** Movie timescale units */
+  int track_index;                           /** Current trak during moov rebuild */
+  InsByteVector moov;                        /** Rebuilt moov box */
+} InsTrimContextType;
+
+static int ins_bytes_append(const InsAllocatorType* allocator, InsByteVector* v, const void* data, size_t size) {
+  if (!size)
+    return 0;
+
+  if (size > (size_t)(INT32_MAX - v->n) || ins_vector_reserve(uint8_t, allocator, v, (int32_t)size) < 0)
+    return kInsFileErrorNoMemory;
+
+  memcpy(v->a + v->n, data, size);
+  v->n += (int32_t)size;
+  return 0;
+}
+
+static int ins_bytes_append_u32(const InsAllocatorType* allocator, InsByteVector* v, uint32_t value) {
+  uint8_t data[4];
+  ins_mp4_write_u32(data, value);
+  return ins_bytes_append(allocator, v, data, sizeof(data));
+}
+
+static int ins_bytes_append_u64(const InsAllocatorType* allocator, InsByteVector* v, uint64_t value) {
+  uint8_t data[8];
+  ins_mp4_write_u64(data, value);
+  return ins_bytes_append(allocator, v, data, sizeof(data));
+}
+
+/** Decode time of sample (from 1), sample after last one gives track duration */
+static uint64_t ins_trim_sample_time(const uint8_t* stts, int64_t stts_count, uint32_t sample) {
+  uint64_t time = 0;
+  uint64_t run_first = 1;
+
+  for (int64_t i = 0; i < stts_count; i++) {
+    uint32_t count = ins_mp4_read_u32(stts + 8 + i * 8);
+    uint32_t delta = ins_mp4_read_u32(stts + 8 + i * 8 + 4);
+
+    if (sample < run_first + count)
+      return time + (sample - run_first) * delta;
+
+    time += (uint64_t)count * delta;
+    run_first += count;
+  }
+
+  return time;
+}
+
+/** First sample (from 1) decoded at or after time, samples count + 1 when all samples are earlier */
+static uint64_t ins_trim_sample_at_time(const uint8_t* stts, int64_t stts_count, uint64_t time) {
+  uint64_t run_time = 0;
+  uint64_t run_first = 1;
+
+  for (int64_t i = 0; i < stts_count; i++) {
+    uint32_t count = ins_mp4_read_u32(stts + 8 + i * 8);
+    uint32_t delta = ins_mp4_read_u32(stts + 8 + i * 8 + 4);
+    uint64_t run_end = run_time + (uint64_t)count * delta;
+
+    if (time <= run_time)
+      return run_first;
+
+    if (time < run_end)
+      return run_first + (time - run_time + delta - 1) / delta;
+
+    run_time = run_end;
+    run_first += count;
+  }
+
+  return run_first;
+}
+
+/** Append run to table of (count, value) runs (stts, ctts), equal neighbour run is extended.
+    Table has version, flags and entry count before runs */
+static int ins_trim_append_run(const InsAllocatorType* allocator, InsByteVector* table, uint32_t count, uint32_t value) {
+  uint32_t entries = ins_mp4_read_u32(table->a + 4);
+  uint8_t* last = table->a + table->n - 8;
+
+  if (entries && ins_mp4_read_u32(last + 4) == value) {
+    ins_mp4_write_u32(last, ins_mp4_read_u32(last) + count);
+    return 0;
+  }
+
+  if (ins_bytes_append_u32(allocator, table, count) < 0 || ins_bytes_append_u32(allocator, table, value) < 0)
+    return kInsFileErrorNoMemory;
+
+  ins_mp4_write_u32(table->a + 4, entries + 1);
+  return 0;
+}
+
+/** Append version and flags of input table and zero entry count */
+static int ins_trim_begin_table(const InsAllocatorType* allocator, InsByteVector* table, const uint8_t* version_flags) {
+  static const uint8_t kZero[4] = { 0 };
+
+  if (ins_bytes_append(allocator, table, version_flags ? version_flags : kZero, 4) < 0 || ins_bytes_append_u32(allocator, table, 0) < 0)
+    return kInsFileErrorNoMemory;
+  return 0;
+}
+
+/** Append (count, value) runs of stts or ctts clipped to kept samples */
+static int ins_trim_clip_runs(const InsAllocatorType* allocator, const uint8_t* table, int64_t count,
+  uint32_t first, uint32_t end, InsByteVector* out) {
+  uint64_t run_first = 1;
+
+  /* version and flags are kept: ctts version 1 has signed offsets */
+  int result = ins_trim_begin_table(allocator, out, table);
+
+  for (int64_t i = 0; i < count && !result; i++) {
+    uint32_t run_count = ins_mp4_read_u32(table + 8 + i * 8);
+    uint32_t value = ins_mp4_read_u32(table + 8 + i * 8 + 4);
+    uint64_t kept_first = run_first > first ? run_first : first;
+    uint64_t kept_end = run_first + run_count < end ? run_first + run_count : end;
+
+    run_first += run_count;
+    if (kept_first < kept_end)
+      result = ins_trim_append_run(allocator, out, (uint32_t)(kept_end - kept_first), value);
+  }
+
+  return result;
+}
+
+/** Last sync sample at or before sample, first sync sample when there is none before */
+static uint32_t ins_trim_sync_before(const uint8_t* stss, int64_t count, uint32_t sample) {
+  int64_t low = 0, high = count;
+
+  while (low < high) {
+    int64_t middle = low + (high - low) / 2;
+    if (ins_mp4_read_u32(stss + 8 + middle * 4) <= sample)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  if (!count)
+    return sample;
+  return ins_mp4_read_u32(stss + 8 + (low ? low - 1 : 0) * 4);
+}
+
+/** First sync sample at or after sample, end_sample when there is none */
+static uint32_t ins_trim_sync_after(const uint8_t* stss, int64_t count, uint32_t sample, uint32_t end_sample) {
+  int64_t low = 0, high = count;
+
+  while (low < high) {
+    int64_t middle = low + (high - low) / 2;
+    if (ins_mp4_read_u32(stss + 8 + middle * 4) < sample)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low < count ? ins_mp4_read_u32(stss + 8 + low * 4) : end_sample;
+}
+
+/**
+ * \brief    Choose kept samples of track and rebuild its sample tables. Video track (video is NULL) is cut at
+ *           sync samples around requested range, other tracks keep samples decoded inside video range
+ */
+static int ins_trim_track(InsTrimContextType* context, FILE* file, int track_index, const InsTrimTrackType* video,
+  double start_seconds, double end_seconds) {
+  const InsAllocatorType* allocator = context->allocator;
+  const InsMp4TrackType* track = &context->info.tracks[track_index];
+  InsTrimTrackType* trim = &context->tracks[track_index];
+  InsMp4SampleTablesType tables;
+
+  if (!track->stbl.type)
+    return 0;
+
+  int result = ins_mp4_read_sample_tables(file, &track->stbl, allocator, &tables);
+  if (result < 0) {
+    ins_mp4_release_sample_tables(&tables, allocator);
+    return result;
+  }
+
+  uint32_t default_size;
+  int64_t samples_count = ins_mp4_stsz_samples_count(tables.stsz, tables.stsz_size, &default_size);
+  int64_t stts_count = ins_mp4_table_entries_count(tables.stts, tables.stts_size, 8, 8);
+  int64_t ctts_count = tables.ctts ? ins_mp4_table_entries_count(tables.ctts, tables.ctts_size, 8, 8) : 0;
+  int64_t stsc_count = ins_mp4_table_entries_count(tables.stsc, tables.stsc_size, 8, 12);
+  int64_t chunks_count = ins_mp4_table_entries_count(tables.stco, tables.stco_size, 8, tables.chunk_offset_size);
+  int64_t sync_count = tables.stss ? ins_mp4_table_entries_count(tables.stss, tables.stss_size, 8, 4) : 0;
+
+  if (samples_count < 0 || samples_count >= UINT32_MAX || stts_count < 0 || ctts_count < 0 || stsc_count < 0 ||
+      chunks_count < 0 || sync_count < 0) {
+    ins_mp4_release_sample_tables(&tables, allocator);
+    return kInsFileErrorMediaCorrupted;
+  }
+
+  trim->has_tables = 1;
+  trim->timescale = track->timescale;
+  trim->samples_count = (uint32_t)samples_count;
+
+  uint64_t first, end;
+  uint64_t samples_end = samples_count + 1;
+
+  if (!video) {
+    /* last sample started at or before start, moved back to keyframe */
+    uint64_t start_time = start_seconds > 0 ? (uint64_t)(start_seconds * track->timescale) : 0;
+    if (start_time >= ins_trim_sample_time(tables.stts, stts_count, (uint32_t)samples_end)) {
+      ins_mp4_release_sample_tables(&tables, allocator);
+      return kInsFileErrorInvalidArgument;
+    }
+
+    first = ins_trim_sample_at_time(tables.stts, stts_count, start_time + 1);
+    first = first > 1 ? first - 1 : 1;
+    if (tables.stss && first < samples_end)
+      first = ins_trim_sync_before(tables.stss, sync_count, (uint32_t)first);
+
+    end = samples_end;
+    if (end_seconds > 0) {
+      end = ins_trim_sample_at_time(tables.stts, stts_count, (uint64_t)(end_seconds * track->timescale + 0.5));
+      if (tables.stss && end < samples_end)
+        end = ins_trim_sync_after(tables.stss, sync_count, (uint32_t)end, (uint32_t)samples_end);
+    }
+
+    if (end > samples_end)
+      end = samples_end;
+    if (first >= end) {
+      ins_mp4_release_sample_tables(&tables, allocator);
+      return kInsFileErrorInvalidArgument;
+    }
+  } else {
+    /* video range converted to track timescale */
+    first = ins_trim_sample_at_time(tables.stts, stts_count, video->first_time * track->timescale / video->timescale);
+    end = video->end_sample == video->samples_count + 1 ? samples_end :
+      ins_trim_sample_at_time(tables.stts, stts_count, video->end_time * track->timescale / video->timescale);
+
+    if (end > samples_end)
+      end = samples_end;
+    if (first > end)
+      first = end;
+  }
+
+  trim->first_sample = (uint32_t)first;
+  trim->end_sample = (uint32_t)end;
+  trim->first_time = ins_trim_sample_time(tables.stts, stts_count, trim->first_sample);
+  trim->end_time = ins_trim_sample_time(tables.stts, stts_count, trim->end_sample);
+  trim->data_begin = trim->data_end = 0;
+
+  result = ins_trim_clip_runs(allocator, tables.stts, stts_count, trim->first_sample, trim->end_sample, &trim->stts);
+
+  if (!result && tables.ctts)
+    result = ins_trim_clip_runs(allocator, tables.ctts, ctts_count, trim->first_sample, trim->end_sample, &trim->ctts);
+
+  /* stss: sync samples renumbered from first kept sample */
+  if (!result && tables.stss) {
+    uint32_t entries = 0;
+    result = ins_trim_begin_table(allocator, &trim->stss, tables.stss);
+
+    for (int64_t i = 0; i < sync_count && !result; i++) {
+      uint32_t sample = ins_mp4_read_u32(tables.stss + 8 + i * 4);
+      if (sample < trim->first_sample || sample >= trim->end_sample)
+        continue;
+
+      result = ins_bytes_append_u32(allocator, &trim->stss, sample - trim->first_sample + 1);
+      entries++;
+    }
+
+    if (!result)
+      ins_mp4_write_u32(trim->stss.a + 4, entries);
+  }
+
+  /* stsz: version and flags, default size, kept sample count, kept sizes */
+  if (!result) {
+    result = ins_bytes_append(allocator, &trim->stsz, tables.stsz, 8);
+    if (!result)
+      result = ins_bytes_append_u32(allocator, &trim->stsz, trim->end_sample - trim->first_sample);
+    if (!result && !default_size)
+      result = ins_bytes_append(allocator, &trim->stsz, tables.stsz + 12 + (int64_t)(trim->first_sample - 1) * 4,
+        (size_t)(trim->end_sample - trim->first_sample) * 4);
+  }
+
+  if (!result)
+    result = ins_trim_begin_table(allocator, &trim->stsc, tables.stsc);
+
+  /* chunks: kept part of each chunk becomes new chunk, its offset is offset of first kept sample.
+     stsc runs are rebuilt from kept samples per chunk */
+  const uint8_t* stsz_entries = tables.stsz + 12;
+  int64_t stsc_next = 0;
+  uint32_t samples_per_chunk = 0, description = 0;
+  uint32_t run_samples = 0, run_description = 0, stsc_entries = 0;
+  uint32_t sample = 1;
+
+  for (int64_t chunk = 1; chunk <= chunks_count && !result; chunk++) {
+    while (stsc_next < stsc_count && ins_mp4_read_u32(tables.stsc + 8 + stsc_next * 12) <= chunk) {
+      samples_per_chunk = ins_mp4_read_u32(tables.stsc + 8 + stsc_next * 12 + 4);
+      description = ins_mp4_read_u32(tables.stsc + 8 + (stsc_next++) * 12 + 8);
+    }
+
+    const uint8_t* chunk_offset_data = tables.stco + 8 + (chunk - 1) * tables.chunk_offset_size;
+    int64_t offset = tables.chunk_offset_size == 8 ? (int64_t)ins_mp4_read_u64(chunk_offset_data) : ins_mp4_read_u32(chunk_offset_data);
+    int64_t kept_offset = 0;
+    uint32_t kept = 0;
+
+    for (uint32_t i = 0; i < samples_per_chunk; i++, sample++) {
+      if (sample > samples_count) {
+        result = kInsFileErrorMediaCorrupted;
+        break;
+      }
+
+      uint32_t size = default_size ? default_size : ins_mp4_read_u32(stsz_entries + (int64_t)(sample - 1) * 4);
+
+      if (sample >= trim->first_sample && sample < trim->end_sample) {
+        if (offset < 0 || offset + size > context->info.media_size) {
+          result = kInsFileErrorMediaCorrupted;
+          break;
+        }
+
+        if (!kept++)
+          kept_offset = offset;
+
+        if (trim->data_begin == trim->data_end) {
+          trim->data_begin = offset;
+          trim->data_end = offset + size;
+        } else {
+          if (offset < trim->data_begin)
+            trim->data_begin = offset;
+          if (offset + size > trim->data_end)
+            trim->data_end = offset + size;
+        }
+      }
+
+      offset += size;
+    }
+
+    if (result || !kept)
+      continue;
+
+    if (ins_vector_reserve(int64_t, allocator, &trim->chunk_offsets, 1) < 0) {
+      result = kInsFileErrorNoMemory;
+      break;
+    }
+    trim->chunk_offsets.a[trim->chunk_offsets.n++] = kept_offset;
+
+    if (kept != run_samples || description != run_description) {
+      run_samples = kept;
+      run_description = description;
+      stsc_entries++;
+
+      result = ins_bytes_append_u32(allocator, &trim->stsc, (uint32_t)vector_size(&trim->chunk_offsets));
+      if (!result)
+        result = ins_bytes_append_u32(allocator, &trim->stsc, kept);
+      if (!result)
+        result = ins_bytes_append_u32(allocator, &trim->stsc, description);
+    }
+  }
+
+  if (!result && sample != samples_count + 1)
+    result = kInsFileErrorMediaCorrupted;
+
+  if (!result)
+    ins_mp4_write_u32(trim->stsc.a + 4, stsc_entries);
+
+  ins_mp4_release_sample_tables(&tables, allocator);
+  return result;
+}
+
+static void ins_trim_track_destroy(InsTrimTrackType* trim, const InsAllocatorType* allocator) {
+  ins_vector_destroy(allocator, &trim->stts);
+  ins_vector_destroy(allocator, &trim->ctts);
+  ins_vector_destroy(allocator, &trim->stss);
+  ins_vector_destroy(allocator, &trim->stsc);
+  ins_vector_destroy(allocator, &trim->stsz);
+  ins_vector_destroy(allocator, &trim->chunk_offsets);
+}
+
+/** Append box header with size placeholder, box size is written by ins_trim_end_box */
+static int ins_trim_begin_box(InsTrimContextType* context, uint32_t type, int32_t* out_position) {
+  *out_position = context->moov.n;
+  if (ins_bytes_append_u32(context->allocator, &context->moov, 0) < 0 || ins_bytes_append_u32(context->allocator, &context->moov, type) < 0)
+    return kInsFileErrorNoMemory;
+  return 0;
+}
+
+static void ins_trim_end_box(InsTrimContextType* context, int32_t position) {
+  ins_mp4_write_u32(context->moov.a + position, (uint32_t)(context->moov.n - position));
+}
+
+static int ins_trim_append_box(InsTrimContextType* context, uint32_t type, const uint8_t* data, size_t size, int32_t* out_position) {
+  int result = ins_trim_begin_box(context, type, out_position);
+  if (!result)
+    result = ins_bytes_append(context->allocator, &context->moov, data, size);
+  if (!result)
+    ins_trim_end_box(context, *out_position);
+  return result;
+}
+
+/** Patch duration field of mvhd, tkhd or mdhd box written at position */
+static void ins_trim_patch_duration(InsTrimContextType* context, int32_t position, uint32_t type, uint64_t duration) {
+  uint8_t* data = context->moov.a + position + kInsMp4BoxHeaderSize;
+  uint32_t size = (uint32_t)(context->moov.n - position - kInsMp4BoxHeaderSize);
+  int version = size ? data[0] : 0;
+
+  /* version 1 has 64-bit creation and modification times, tkhd has track id and reserved field before duration */
+  uint32_t field = type == kInsMp4BoxTkhd ? (version ? 28 : 20) : (version ? 24 : 16);
+
+  if (version == 1 && size >= field + 8)
+    ins_mp4_write_u64(data + field, duration);
+  else if (!version && size >= field + 4)
+    ins_mp4_write_u32(data + field, duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration);
+}
+
+static int ins_trim_write_chunk_offsets(InsTrimContextType* context, const InsTrimTrackType* trim) {
+  const InsAllocatorType* allocator = context->allocator;
+  int32_t count = vector_size(&trim->chunk_offsets);
+  int32_t position;
+
+  int result = ins_trim_begin_box(context, context->wide_offsets ? kInsMp4BoxCo64 : kInsMp4BoxStco, &position);
+  if (!result)
+    result = ins_bytes_append_u32(allocator, &context->moov, 0);
+  if (!result)
+    result = ins_bytes_append_u32(allocator, &context->moov, (uint32_t)count);
+
+  for (int32_t i = 0; i < count && !result; i++) {
+    int64_t offset = vector_at(&trim->chunk_offsets, i) - context->data_begin + context->data_offset;
+    result = context->wide_offsets ? ins_bytes_append_u64(allocator, &context->moov, (uint64_t)offset) :
+      ins_bytes_append_u32(allocator, &context->moov, (uint32_t)offset);
+  }
+
+  if (!result)
+    ins_trim_end_box(context, position);
+  return result;
+}
+
+/** Copy stbl children, replace sample tables by rebuilt ones */
+static int ins_trim_write_stbl(InsTrimContextType* context, const InsTrimTrackType* trim, InsByteViewType parent) {
+  InsMp4BoxViewType box;
+  uint32_t read_position = 0;
+  int32_t position;
+  int result;
+
+  while ((result = ins_mp4_view_next_box(parent, &read_position, &box)) > 0) {
+    const InsByteVector* table = NULL;
+
+    switch (box.type) {
+      case kInsMp4BoxStts: table = &trim->stts; break;
+      case kInsMp4BoxCtts: table = &trim->ctts; break;
+      case kInsMp4BoxStss: table = &trim->stss; break;
+      case kInsMp4BoxStsc: table = &trim->stsc; break;
+      case kInsMp4BoxStsz: table = &trim->stsz; break;
+      case kInsMp4BoxStco:
+      case kInsMp4BoxCo64:
+        result = ins_trim_write_chunk_offsets(context, trim);
+        break;
+      case kInsMp4BoxSdtp:
+      case kInsMp4BoxSbgp:
+      case kInsMp4BoxStps:
+        /* per-sample tables of removed samples are dropped */
+        break;
+      default:
+        result = ins_trim_append_box(context, box.type, box.data.data, box.data.size, &position);
+        break;
+    }
+
+    if (table)
+      result = ins_trim_append_box(context, box.type, table->a, (size_t)table->n, &position);
+
+    if (result < 0)
+      return result;
+  }
+
+  return result;
+}
+
+/** Copy children of moov, trak, mdia or minf, rebuild sample tables and durations */
+static int ins_trim_write_children(InsTrimContextType* context, InsByteViewType parent) {
+  const InsTrimTrackType* trim = context->track_index > 0 ? &context->tracks[context->track_index - 1] : NULL;
+  InsMp4BoxViewType box;
+  uint32_t read_position = 0;
+  int32_t position;
+  int result;
+
+  while ((result = ins_mp4_view_next_box(parent, &read_position, &box)) > 0) {
+    if (box.type == kInsMp4BoxTrak && !context->tracks[context->track_index++].has_tables) {
+      result = ins_trim_append_box(context, box.type, box.data.data, box.data.size, &position);
+    } else if (box.type == kInsMp4BoxTrak || box.type == kInsMp4BoxMdia || box.type == kInsMp4BoxMinf ||
+               box.type == kInsMp4BoxStbl) {
+      result = ins_trim_begin_box(context, box.type, &position);
+      if (!result && box.type == kInsMp4BoxStbl)
+        result = ins_trim_write_stbl(context, trim, box.data);
+      else if (!result)
+        result = ins_trim_write_children(context, box.data);
+      if (!result)
+        ins_trim_end_box(context, position);
+    } else if (box.type == kInsMp4BoxEdts) {
+      /* edit list refers to input timeline */
+      continue;
+    } else {
+      result = ins_trim_append_box(context, box.type, box.data.data, box.data.size, &position);
+      if (result)
+        return result;
+
+      if (box.type == kInsMp4BoxMvhd)
+        ins_trim_patch_duration(context, position, box.type, context->movie_duration);
+      else if (box.type == kInsMp4BoxTkhd && trim)
+        ins_trim_patch_duration(context, position, box.type,
+          (trim->end_time - trim->first_time) * context->info.timescale / (trim->timescale ? trim->timescale : 1));
+      else if (box.type == kInsMp4BoxMdhd && trim)
+        ins_trim_patch_duration(context, position, box.type, trim->end_time - trim->first_time);
+    }
+
+    if (result < 0)
+      return result;
+  }
+
+  return result;
+}
+
+static int ins_trim_build_moov(InsTrimContextType* context, InsByteViewType moov_data) {
+  int32_t position;
+
+  context->moov.n = 0;
+  context->track_index = 0;
+
+  int result = ins_trim_begin_box(context, kInsMp4BoxMoov, &position);
+  if (!result)
+    result = ins_trim_write_children(context, moov_data);
+  if (!result)
+    ins_trim_end_box(context, position);
+  return result;
+}
+
+/** Read little endian timecode of trailer record */
+static int ins_trim_read_timecode(FILE* file, int64_t offset, uint32_t size, uint64_t* out_value) {
+  uint8_t data[8];
+
+  if (ins_fseek64(file, offset, SEEK_SET) || fread(data, 1, size, file) != size)
+    return kInsFileErrorIo;
+
+  *out_value = 0;
+  for (uint32_t i = size; i > 0; i--)
+    *out_value = (*out_value << 8) | data[i - 1];
+  return 0;
+}
+
+/** First record of trailer entry with timecode at or after time, records are sorted by timecode */
+static int64_t ins_trim_find_record(FILE* file, const InsTrailerEntryLocationType* location, uint32_t record_size,
+  uint32_t timecode_size, uint64_t time) {
+  int64_t low = 0, high = location->length / record_size;
+
+  while (low < high) {
+    int64_t middle = low + (high - low) / 2;
+    uint64_t timecode;
+
+    if (ins_trim_read_timecode(file, location->file_offset + middle * record_size, timecode_size, &timecode) < 0)
+      return kInsFileErrorIo;
+
+    if (timecode < time)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+/** Find trailer entry in plan */
+static InsTrailerEntryLocationType* ins_trim_plan_entry(InsTrailerReadPlanType* plan, uint16_t type) {
+  for (int i = 0; i < ins_small_vector_size(&plan->entries); i++) {
+    if (ins_small_vector_at(&plan->entries, i).type == type)
+      return &ins_small_vector_at(&plan->entries, i);
+  }
+  return NULL;
+}
+
+/** Trailer entries with camera clock timecodes (uint64 ms at record start), preferred clock source last */
+static const struct { uint16_t type; uint32_t record_size; } kInsCameraClockStreams[] = {
+  { kInsTrailerEntryTypeImu, kInsImuRecordSize },
+  { kInsTrailerEntryTypeExposure, kInsExposureRecordSize },
+  { kInsTrailerEntryTypeTimestamps, kInsTimestampRecordSize }
+};
+
+#define kInsCameraClockStreamsCount  ((int)(sizeof(kInsCameraClockStreams) / sizeof(kInsCameraClockStreams[0])))
+
+/** Camera clock source of trailer: 0x600 frame timestamps, otherwise 0x400 or 0x300, with at least one record */
+static InsTrailerEntryLocationType* ins_trim_camera_clock_entry(InsTrailerReadPlanType* plan, uint32_t* out_record_size) {
+  for (int i = kInsCameraClockStreamsCount - 1; i >= 0; i--) {
+    InsTrailerEntryLocationType* location = ins_trim_plan_entry(plan, kInsCameraClockStreams[i].type);
+
+    if (location && location->length >= kInsCameraClockStreams[i].record_size) {
+      if (out_record_size)
+        *out_record_size = kInsCameraClockStreams[i].record_size;
+      return location;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * \brief    Cut time-series entries of read plan to kept video range, entry locations are changed in place.
+ *           Camera clock window is taken from 0x600 frame timestamps when they match video samples, otherwise
+ *           from first record timecode plus video time. GPS window is first GPS time plus video time
+ */
+static int ins_trim_slice_trailer(FILE* file, InsTrailerReadPlanType* plan, const InsTrimTrackType* video) {
+  int open_start = video->first_sample == 1;
+  int open_end = video->end_sample == video->samples_count + 1;
+  if (open_start && open_end)
+    return 0;
+
+  InsTrailerEntryLocationType* timestamps = ins_trim_plan_entry(plan, kInsTrailerEntryTypeTimestamps);
+  InsTrailerEntryLocationType* gps = ins_trim_plan_entry(plan, kInsTrailerEntryTypeGps);
+  uint64_t camera_begin = 0, camera_end = UINT64_MAX;
+  int result = 0;
+
+  if (timestamps && timestamps->length / kInsTimestampRecordSize == video->samples_count) {
+    if (!open_start)
+      result = ins_trim_read_timecode(file, timestamps->file_offset + (int64_t)(video->first_sample - 1) * kInsTimestampRecordSize,
+        kInsTimestampRecordSize, &camera_begin);
+    if (!result && !open_end)
+      result = ins_trim_read_timecode(file, timestamps->file_offset + (int64_t)(video->end_sample - 1) * kInsTimestampRecordSize,
+        kInsTimestampRecordSize, &camera_end);
+  } else {
+    InsTrailerEntryLocationType* origin_entry = ins_trim_camera_clock_entry(plan, NULL);
+    uint64_t origin = 0;
+
+    if (origin_entry)
+      result = ins_trim_read_timecode(file, origin_entry->file_offset, 8, &origin);
+
+    if (!open_start)
+      camera_begin = origin + video->first_time * 1000 / video->timescale;
+    if (!open_end)
+      camera_end = origin + video->end_time * 1000 / video->timescale;
+  }
+
+  for (int i = 0; i < kInsCameraClockStreamsCount && !result; i++) {
+    InsTrailerEntryLocationType* location = ins_trim_plan_entry(plan, kInsCameraClockStreams[i].type);
+    if (!location)
+      continue;
+
+    int64_t first = ins_trim_find_record(file, location, kInsCameraClockStreams[i].record_size, 8, camera_begin);
+    int64_t end = ins_trim_find_record(file, location, kInsCameraClockStreams[i].record_size, 8, camera_end);
+    if (first < 0 || end < 0)
+      return kInsFileErrorIo;
+
+    location->file_offset += first * kInsCameraClockStreams[i].record_size;
+    location->length = (uint32_t)((end - first) * kInsCameraClockStreams[i].record_size);
+  }
+
+  if (!result && gps && gps->length >= kInsGpsRecordSize) {
+    uint64_t gps_origin = 0;
+    uint64_t gps_begin = 0, gps_end = UINT64_MAX;
+
+    result = ins_trim_read_timecode(file, gps->file_offset, 4, &gps_origin);
+    if (!open_start)
+      gps_begin = gps_origin + video->first_time / video->timescale;
+    if (!open_end)
+      gps_end = gps_origin + (video->end_time + video->timescale - 1) / video->timescale;
+
+    int64_t first = result ? 0 : ins_trim_find_record(file, gps, kInsGpsRecordSize, 4, gps_begin);
+    int64_t end = result ? 0 : ins_trim_find_record(file, gps, kInsGpsRecordSize, 4, gps_end);
+    if (first < 0 || end < 0)
+      return kInsFileErrorIo;
+
+    gps->file_offset += first * kInsGpsRecordSize;
+    gps->length = (uint32_t)((end - first) * kInsGpsRecordSize);
+  }
+
+  return result;
+}
+
+/** Write entries of read plan in file order, empty time-series entries are dropped */
+static int ins_trim_write_trailer(FILE* file, const InsTrailerReadPlanType* plan, FILE* file_out, const InsAllocatorType* io_allocator) {
+  uint32_t entries_size = 0;
+  int result = 0;
+
+  for (int i = ins_small_vector_size(&plan->entries) - 1; i >= 0 && !result; i--) {
+    const InsTrailerEntryLocationType* location = &ins_small_vector_at(&plan->entries, i);
+    if (!location->length)
+      continue;
+
+    result = ins_copy_file_region(file, location->file_offset, location->length, file_out, io_allocator);
+    if (!result)
+      result = ins_write_trailer_entry_header(file_out, location->type, location->length);
+    entries_size += location->length + sizeof(InsFileTrailerEntryHeaderType);
+  }
+
+  if (!result)
+    result = ins_write_trailer_end(file_out, entries_size, plan->trailer_info.trailer_version);
+  return result;
+}
+
+static void ins_trim_context_destroy(InsTrimContextType* context) {
+  ins_vector_destroy(context->allocator, &context->moov);
+  for (int i = 0; i < kInsMp4MaxTracks; i++)
+    ins_trim_track_destroy(&context->tracks[i], context->allocator);
+}
+
+/**
+ * \brief    Read media structure and sample tables of file, cut video track to requested range and other
+ *           tracks to video range, find data range of kept samples and movie duration
+ * \return   Video track index - success, negative - error code
+ */
+static int ins_trim_open(InsTrimContextType* context, FILE* file, const InsAllocatorType* allocator,
+  double start_seconds, double end_seconds) {
+  memset(context, 0, sizeof(*context));
+  context->allocator = allocator;
+
+  int64_t media_size = ins_get_media_size(file);
+  if (media_size < 0)
+    return (int)media_size;
+
+  int result = ins_mp4_read_info(file, media_size, allocator, &context->info);
+  if (result < 0)
+    return result;
+
+  if (context->info.tracks_count > kInsMp4MaxTracks)
+    return kInsFileErrorInvalidArgument;
+
+  int video_index = ins_mp4_find_track(&context->info, kInsMp4HandlerVideo);
+  if (video_index < 0)
+    return video_index;
+
+  result = ins_trim_track(context, file, video_index, NULL, start_seconds, end_seconds);
+  const InsTrimTrackType* video = &context->tracks[video_index];
+
+  for (int i = 0; i < context->info.tracks_count && !result; i++) {
+    if (i != video_index)
+      result = ins_trim_track(context, file, i, video, 0, 0);
+  }
+
+  if (result < 0)
+    return result;
+
+  context->data_begin = video->data_begin;
+  context->data_end = video->data_end;
+
+  for (int i = 0; i < context->info.tracks_count; i++) {
+    const InsTrimTrackType* trim = &context->tracks[i];
+    if (trim->data_begin == trim->data_end)
+      continue;
+    if (trim->data_begin < context->data_begin)
+      context->data_begin = trim->data_begin;
+    if (trim->data_end > context->data_end)
+      context->data_end = trim->data_end;
+
+    uint64_t duration = (trim->end_time - trim->first_time) * context->info.timescale / (trim->timescale ? trim->timescale : 1);
+    if (duration > context->movie_duration)
+      context->movie_duration = duration;
+  }
+
+  return video_index;
+}
+
+/**
+ * \brief    Write ftyp, rebuilt moov and mdat header of data_size bytes. moov of file is used as template,
+ *           chunk offsets are placed after mdat header
+ */
+static int ins_trim_write_media_head(InsTrimContextType* context, FILE* file, int64_t data_size, FILE* file_out,
+  const InsAllocatorType* io_allocator) {
+  const InsAllocatorType* allocator = context->allocator;
+  uint8_t* moov_data;
+
+  int64_t moov_size = ins_mp4_read_box_data(file, &context->info.moov, allocator, &moov_data);
+  if (moov_size < 0)
+    return (int)moov_size;
+
+  /* moov size does not depend on chunk offset values, only on their width: first pass finds size */
+  int64_t ftyp_size = context->info.ftyp.type ? context->info.ftyp.size : 0;
+  uint32_t mdat_header_size = data_size + kInsMp4BoxHeaderSize > UINT32_MAX ? kInsMp4LargeBoxHeaderSize : kInsMp4BoxHeaderSize;
+  InsByteViewType moov_view = ins_byte_view(moov_data, (uint32_t)moov_size);
+
+  int result = ins_trim_build_moov(context, moov_view);
+
+  if (!result && ftyp_size + context->moov.n + mdat_header_size + data_size > UINT32_MAX) {
+    context->wide_offsets = 1;
+    result = ins_trim_build_moov(context, moov_view);
+  }
+
+  if (!result) {
+    context->data_offset = ftyp_size + context->moov.n + mdat_header_size;
+    result = ins_trim_build_moov(context, moov_view);
+  }
+
+  ins_release(allocator, moov_data);
+
+  if (!result && ftyp_size)
+    result = ins_copy_file_region(file, context->info.ftyp.offset, ftyp_size, file_out, io_allocator);
+
+  if (!result && fwrite(context->moov.a, 1, (size_t)context->moov.n, file_out) != (size_t)context->moov.n)
+    result = kInsFileErrorIo;
+
+  if (!result) {
+    uint8_t header[kInsMp4LargeBoxHeaderSize];
+    uint64_t mdat_size = (uint64_t)data_size + mdat_header_size;
+
+    ins_mp4_write_u32(header, mdat_header_size == kInsMp4LargeBoxHeaderSize ? 1 : (uint32_t)mdat_size);
+    ins_mp4_write_u32(header + 4, kInsMp4BoxMdat);
+    if (mdat_header_size == kInsMp4LargeBoxHeaderSize)
+      ins_mp4_write_u64(header + 8, mdat_size);
+
+    if (fwrite(header, 1, mdat_header_size, file_out) != mdat_header_size)
+      result = kInsFileErrorIo;
+  }
+
+  return result;
+}
+
+int ins_write_trimmed(FILE* file, double start_seconds, double end_seconds, FILE* file_out,
+  const InsAllocatorType* allocator, const InsAllocatorType* io_allocator, InsTrimResultType* out_result) {
+  InsTrimContextType context;
+  InsTrailerReadPlanType plan;
+
+  if (!io_allocator)
+    io_allocator = allocator;
+
+  if (end_seconds > 0 && end_seconds <= start_seconds)
+    return kInsFileErrorInvalidArgument;
+
+  ins_trailer_read_plan_init(&plan, allocator);
+
+  /* everything is read and checked before first byte is written: video range, other tracks, trailer cut */
+  int result = ins_trim_open(&context, file, allocator, start_seconds, end_seconds);
+  int video_index = result;
+  const InsTrimTrackType* video = &context.tracks[video_index >= 0 ? video_index : 0];
+
+  if (result >= 0)
+    result = ins_plan_trailer_reads(file, 0, &plan);
+
+  if (!result)
+    result = ins_trim_slice_trailer(file, &plan, video);
+
+  /* new layout: ftyp, moov, mdat with kept sample data, trailer */
+  int64_t data_size = context.data_end - context.data_begin;
+
+  if (!result)
+    result = ins_trim_write_media_head(&context, file, data_size, file_out, io_allocator);
+
+  if (!result)
+    result = ins_copy_file_region(file, context.data_begin, data_size, file_out, io_allocator);
+
+  if (!result)
+    result = ins_trim_write_trailer(file, &plan, file_out, io_allocator);
+
+  if (!result && out_result) {
+    out_result->start = (double)video->first_time / video->timescale;
+    out_result->end = (double)video->end_time / video->timescale;
+    out_result->video_samples = video->end_sample - video->first_sample;
+    out_result->media_size = context.data_offset + data_size;
+  }
+
+  ins_trim_context_destroy(&context);
+  ins_trailer_read_plan_destroy(&plan);
+  return result;
+}
+
+/** Split recording segment */
+typedef struct _InsConcatSegmentType {
+  InsTrimContextType media;                  /** Sample tables of all samples */
+  InsTrailerReadPlanType plan;               /** Trailer entries */
+  int64_t data_position;                     /** Segment sample data start in joined mdat data */
+  int64_t clock_shift;                       /** Added to camera clock timecodes of segment */
+} InsConcatSegmentType;
+
+/** Segments are joined only when track structure is the same */
+static int ins_concat_same_tracks(const InsTrimContextType* first, const InsTrimContextType* segment) {
+  if (first->info.tracks_count != segment->info.tracks_count)
+    return 0;
+
+  for (int i = 0; i < first->info.tracks_count; i++) {
+    const InsMp4TrackType* a = &first->info.tracks[i];
+    const InsMp4TrackType* b = &segment->info.tracks[i];
+
+    if (a->handler != b->handler || a->codec != b->codec || a->timescale != b->timescale || a->width != b->width ||
+        a->height != b->height || first->tracks[i].has_tables != segment->tracks[i].has_tables)
+      return 0;
+  }
+
+  return 1;
+}
+
+/** Sample descriptions of first segment (avcC/hvcC with SPS/PPS, profile, bit depth) describe all joined samples,
+    so every segment must have the same stsd payload byte for byte */
+static int ins_concat_same_descriptions(FILE* first_file, const InsTrimContextType* first, FILE* file,
+  const InsTrimContextType* segment) {
+  const InsAllocatorType* allocator = first->allocator;
+  int result = 0;
+
+  for (int i = 0; i < first->info.tracks_count && i < kInsMp4MaxTracks && !result; i++) {
+    const InsMp4BoxType* first_stsd = &first->info.tracks[i].stsd;
+    const InsMp4BoxType* stsd = &segment->info.tracks[i].stsd;
+    uint8_t* first_data = NULL;
+    uint8_t* data = NULL;
+
+    if (first_stsd->type != stsd->type || first_stsd->size - first_stsd->header_size != stsd->size - stsd->header_size)
+      return kInsMp4ErrorCodecMismatch;
+
+    if (!stsd->type)
+      continue;
+
+    int64_t first_size = ins_mp4_read_box_data(first_file, first_stsd, allocator, &first_data);
+    int64_t size = first_size < 0 ? first_size : ins_mp4_read_box_data(file, stsd, allocator, &data);
+
+    if (first_size < 0 || size < 0)
+      result = (int)(first_size < 0 ? first_size : size);
+    else if (size != first_size || memcmp(first_data, data, (size_t)size))
+      result = kInsMp4ErrorCodecMismatch;
+
+    if (first_data)
+      ins_release(allocator, first_data);
+    if (data)
+      ins_release(allocator, data);
+  }
+
+  return result;
+}
+
+/** Start joined track: ctts and stss are written when any segment has them, stsz default size is kept when
+    all segments have the same one */
+static int ins_concat_begin_track(const InsAllocatorType* allocator, InsTrimTrackType* joined,
+  const InsConcatSegmentType* segments, int segments_count, int track_index) {
+  const InsTrimTrackType* first = &segments[0].media.tracks[track_index];
+  const uint8_t* ctts = NULL;
+  int has_stss = 0;
+  uint32_t default_size = ins_mp4_read_u32(first->stsz.a + 4);
+
+  for (int k = 0; k < segments_count; k++) {
+    const InsTrimTrackType* track = &segments[k].media.tracks[track_index];
+    if (!ctts && track->ctts.n)
+      ctts = track->ctts.a;
+    if (track->stss.n)
+      has_stss = 1;
+    if (ins_mp4_read_u32(track->stsz.a + 4) != default_size)
+      default_size = 0;
+  }
+
+  joined->has_tables = 1;
+  joined->timescale = first->timescale;
+  joined->first_sample = joined->end_sample = 1;
+
+  int result = ins_trim_begin_table(allocator, &joined->stts, first->stts.a);
+  if (!result && ctts)
+    result = ins_trim_begin_table(allocator, &joined->ctts, ctts);
+  if (!result && has_stss)
+    result = ins_trim_begin_table(allocator, &joined->stss, NULL);
+  if (!result)
+    result = ins_trim_begin_table(allocator, &joined->stsc, first->stsc.a);
+
+  /* stsz: version and flags, default size, sample count */
+  if (!result)
+    result = ins_bytes_append(allocator, &joined->stsz, first->stsz.a, 4);
+  if (!result)
+    result = ins_bytes_append_u32(allocator, &joined->stsz, default_size);
+  if (!result)
+    result = ins_bytes_append_u32(allocator, &joined->stsz, 0);
+
+  return result;
+}
+
+/** Append sample tables of segment track to joined track: sample and chunk numbers continue after previous
+    segments, chunk offsets become offsets in joined mdat data */
+static int ins_concat_append_track(const InsAllocatorType* allocator, InsTrimTrackType* joined,
+  const InsTrimTrackType* segment, int64_t segment_data_begin, int64_t data_position) {
+  uint32_t samples = segment->end_sample - segment->first_sample;
+  uint32_t sample_base = joined->end_sample - 1;
+  uint32_t chunk_base = (uint32_t)vector_size(&joined->chunk_offsets);
+  uint32_t count = ins_mp4_read_u32(segment->stts.a + 4);
+  int result = 0;
+
+  if (samples > UINT32_MAX - 1 - sample_base)
+    return kInsFileErrorInvalidArgument;
+
+  for (uint32_t i = 0; i < count && !result; i++)
+    result = ins_trim_append_run(allocator, &joined->stts, ins_mp4_read_u32(segment->stts.a + 8 + i * 8),
+      ins_mp4_read_u32(segment->stts.a + 12 + i * 8));
+
+  /* segment without ctts has zero composition offsets */
+  if (joined->ctts.n && segment->ctts.n) {
+    count = ins_mp4_read_u32(segment->ctts.a + 4);
+    for (uint32_t i = 0; i < count && !result; i++)
+      result = ins_trim_append_run(allocator, &joined->ctts, ins_mp4_read_u32(segment->ctts.a + 8 + i * 8),
+        ins_mp4_read_u32(segment->ctts.a + 12 + i * 8));
+  } else if (joined->ctts.n && samples && !result) {
+    result = ins_trim_append_run(allocator, &joined->ctts, samples, 0);
+  }
+
+  /* segment without stss has sync samples only */
+  if (joined->stss.n && !result) {
+    count = segment->stss.n ? ins_mp4_read_u32(segment->stss.a + 4) : samples;
+    for (uint32_t i = 0; i < count && !result; i++)
+      result = ins_bytes_append_u32(allocator, &joined->stss, sample_base + (segment->stss.n ? ins_mp4_read_u32(segment->stss.a + 8 + i * 4) : i + 1));
+    if (!result)
+      ins_mp4_write_u32(joined->stss.a + 4, ins_mp4_read_u32(joined->stss.a + 4) + count);
+  }
+
+  /* stsz: sizes are listed when segments have different default sizes */
+  if (!ins_mp4_read_u32(joined->stsz.a + 4) && !result) {
+    uint32_t default_size = ins_mp4_read_u32(segment->stsz.a + 4);
+    if (default_size) {
+      for (uint32_t i = 0; i < samples && !result; i++)
+        result = ins_bytes_append_u32(allocator, &joined->stsz, default_size);
+    } else {
+      result = ins_bytes_append(allocator, &joined->stsz, segment->stsz.a + 12, (size_t)samples * 4);
+    }
+  }
+  if (!result)
+    ins_mp4_write_u32(joined->stsz.a + 8, sample_base + samples);
+
+  count = ins_mp4_read_u32(segment->stsc.a + 4);
+  for (uint32_t i = 0; i < count && !result; i++) {
+    const uint8_t* entry = segment->stsc.a + 8 + i * 12;
+    uint32_t entries = ins_mp4_read_u32(joined->stsc.a + 4);
+    const uint8_t* last = joined->stsc.a + joined->stsc.n - 12;
+
+    /* run continues when previous segment ends with the same samples per chunk and description */
+    if (entries && !memcmp(last + 4, entry + 4, 8))
+      continue;
+
+    result = ins_bytes_append_u32(allocator, &joined->stsc, chunk_base + ins_mp4_read_u32(entry));
+    if (!result)
+      result = ins_bytes_append(allocator, &joined->stsc, entry + 4, 8);
+    if (!result)
+      ins_mp4_write_u32(joined->stsc.a + 4, entries + 1);
+  }
+
+  int32_t chunks_count = vector_size(&segment->chunk_offsets);
+  if (!result && ins_vector_reserve(int64_t, allocator, &joined->chunk_offsets, chunks_count) < 0)
+    result = kInsFileErrorNoMemory;
+
+  for (int32_t i = 0; i < chunks_count && !result; i++)
+    joined->chunk_offsets.a[joined->chunk_offsets.n++] = vector_at(&segment->chunk_offsets, i) - segment_data_begin + data_position;
+
+  joined->samples_count += samples;
+  joined->end_sample += samples;
+  joined->end_time += segment->end_time - segment->first_time;
+  return result;
+}
+
+/**
+ * \brief    Choose camera clock shift of each segment. Segment which clock continues after previous segment
+ *           keeps shift of previous segment, segment with restarted clock is rebased to its start in joined video
+ */
+static int ins_concat_clock_shifts(FILE* const* files, InsConcatSegmentType* segments, int segments_count, int video_index) {
+  uint64_t origin = 0, previous_last = 0, video_time = 0;
+  int64_t shift = 0;
+  int have_clock = 0;
+
+  for (int k = 0; k < segments_count; k++) {
+    InsConcatSegmentType* segment = &segments[k];
+    const InsTrimTrackType* video = &segment->media.tracks[video_index];
+    uint32_t record_size;
+    uint64_t first, last;
+
+    InsTrailerEntryLocationType* clock = ins_trim_camera_clock_entry(&segment->plan, &record_size);
+    segment->clock_shift = shift;
+
+    if (clock) {
+      int result = ins_trim_read_timecode(files[k], clock->file_offset, 8, &first);
+      if (!result)
+        result = ins_trim_read_timecode(files[k], clock->file_offset + (clock->length / record_size - 1) * record_size, 8, &last);
+      if (result < 0)
+        return result;
+
+      if (!have_clock) {
+        /* timeline starts at clock of first segment with clock, video time before it is counted */
+        origin = first - (video_time < first ? video_time : first);
+        have_clock = 1;
+      } else if (first + shift <= previous_last) {
+        shift = (int64_t)(origin + video_time) - (int64_t)first;
+      }
+
+      segment->clock_shift = shift;
+      previous_last = last + shift;
+    }
+
+    video_time += (video->end_time - video->first_time) * 1000 / video->timescale;
+  }
+
+  return 0;
+}
+
+/** Copy whole records of trailer entry, camera clock timecode at record start is shifted */
+static int ins_concat_write_records(FILE* file, const InsTrailerEntryLocationType* location, uint32_t record_size,
+  int64_t shift, FILE* file_out, const InsAllocatorType* io_allocator) {
+  int64_t length = location->length / record_size * record_size;
+
+  if (!shift)
+    return ins_copy_file_region(file, location->file_offset, length, file_out, io_allocator);
+
+  size_t buffer_size = kInsCopyRegionBufferSize / record_size * record_size;
+  uint8_t* buffer = (uint8_t*)ins_allocate(io_allocator, buffer_size);
+  if (!buffer)
+    return kInsFileErrorNoMemory;
+
+  int result = ins_fseek64(file, location->file_offset, SEEK_SET) ? kInsFileErrorIo : 0;
+
+  for (int64_t done = 0; done < length && !result; ) {
+    size_t size = length - done < (int64_t)buffer_size ? (size_t)(length - done) : buffer_size;
+
+    if (fread(buffer, 1, size, file) != size) {
+      result = kInsFileErrorIo;
+      break;
+    }
+
+    for (size_t offset = 0; offset < size; offset += record_size) {
+      uint64_t timecode = 0;
+      for (int i = 7; i >= 0; i--)
+        timecode = (timecode << 8) | buffer[offset + i];
+
+      timecode += (uint64_t)shift;
+      for (int i = 0; i < 8; i++)
+        buffer[offset + i] = (uint8_t)(timecode >> (i * 8));
+    }
+
+    if (fwrite(buffer, 1, size, file_out) != size)
+      result = kInsFileErrorIo;
+    done += size;
+  }
+
+  ins_release(io_allocator, buffer);
+  return result;
+}
+
+/** Record size of joined time-series entry, 0 - entry is taken from first segment */
+static uint32_t ins_concat_record_size(uint16_t type) {
+  for (int i = 0; i < kInsCameraClockStreamsCount; i++) {
+    if (kInsCameraClockStreams[i].type == type)
+      return kInsCameraClockStreams[i].record_size;
+  }
+  return type == kInsTrailerEntryTypeGps ? kInsGpsRecordSize : 0;
+}
+
+/** Write trailer of joined file in entry order of first segment */
+static int ins_concat_write_trailer(FILE* const* files, InsConcatSegmentType* segments, int segments_count,
+  FILE* file_out, const InsAllocatorType* io_allocator) {
+  InsTrailerReadPlanType* first_plan = &segments[0].plan;
+  int64_t entries_size = 0;
+  int result = 0;
+
+  for (int i = ins_small_vector_size(&first_plan->entries) - 1; i >= 0 && !result; i--) {
+    const InsTrailerEntryLocationType* location = &ins_small_vector_at(&first_plan->entries, i);
+    uint32_t record_size = ins_concat_record_size(location->type);
+    int64_t length = 0;
+
+    if (!record_size) {
+      length = location->length;
+      result = ins_copy_file_region(files[0], location->file_offset, length, file_out, io_allocator);
+    }
+
+    for (int k = 0; k < segments_count && record_size && !result; k++) {
+      const InsTrailerEntryLocationType* segment_location = ins_trim_plan_entry(&segments[k].plan, location->type);
+      if (!segment_location)
+        continue;
+
+      /* GPS time is unix time, it is not rebased */
+      int64_t shift = location->type == kInsTrailerEntryTypeGps ? 0 : segments[k].clock_shift;
+      result = ins_concat_write_records(files[k], segment_location, record_size, shift, file_out, io_allocator);
+      length += segment_location->length / record_size * record_size;
+    }
+
+    if (!result)
+      result = ins_write_trailer_entry_header(file_out, location->type, (uint32_t)length);
+    entries_size += length + sizeof(InsFileTrailerEntryHeaderType);
+  }
+
+  if (!result)
+    result = ins_write_trailer_end(file_out, (uint32_t)entries_size, first_plan->trailer_info.trailer_version);
+  return result;
+}
+
+/** Joined trailer size must fit 32-bit entry lengths and trailer length */
+static int ins_concat_check_trailer(InsConcatSegmentType* segments, int segments_count) {
+  InsTrailerReadPlanType* first_plan = &segments[0].plan;
+  int64_t entries_size = kInsFileMinHeaderLength;
+
+  for (int i = 0; i < ins_small_vector_size(&first_plan->entries); i++) {
+    const InsTrailerEntryLocationType* location = &ins_small_vector_at(&first_plan->entries, i);
+    uint32_t record_size = ins_concat_record_size(location->type);
+    int64_t length = record_size ? 0 : location->length;
+
+    for (int k = 0; k < segments_count && record_size; k++) {
+      const InsTrailerEntryLocationType* segment_location = ins_trim_plan_entry(&segments[k].plan, location->type);
+      if (segment_location)
+        length += segment_location->length / record_size * record_size;
+    }
+
+    if (length > UINT32_MAX)
+      return kInsFileErrorInvalidArgument;
+    entries_size += length + sizeof(InsFileTrailerEntryHeaderType);
+  }
+
+  return entries_size > UINT32_MAX ? kInsFileErrorInvalidArgument : 0;
+}
+
+int ins_write_concat(FILE* const* files, int files_count, FILE* file_out, const InsAllocatorType* allocator,
+  const InsAllocatorType* io_allocator, InsTrimResultType* out_result) {
+  InsConcatSegmentType* segments;
+  InsTrimContextType joined;
+  int64_t data_size = 0;
+  int video_index = 0;
+  int result = 0;
+
+  if (!io_allocator)
+    io_allocator = allocator;
+
+  if (files_count < 1)
+    return kInsFileErrorInvalidArgument;
+
+  segments = (InsConcatSegmentType*)ins_allocate(allocator, sizeof(InsConcatSegmentType) * files_count);
+  if (!segments)
+    return kInsFileErrorNoMemory;
+
+  memset(segments, 0, sizeof(InsConcatSegmentType) * files_count);
+  memset(&joined, 0, sizeof(joined));
+  joined.allocator = allocator;
+
+  for (int k = 0; k < files_count; k++) {
+    segments[k].media.allocator = allocator;
+    ins_trailer_read_plan_init(&segments[k].plan, allocator);
+  }
+
+  /* everything is read and checked before first byte is written: sample tables and trailers of all segments */
+  for (int k = 0; k < files_count && !result; k++) {
+    InsConcatSegmentType* segment = &segments[k];
+
+    result = ins_trim_open(&segment->media, files[k], allocator, 0, 0);
+    if (result >= 0 && k && (result != video_index || !ins_concat_same_tracks(&segments[0].media, &segment->media)))
+      result = kInsFileErrorInvalidArgument;
+    if (result < 0)
+      break;
+
+    video_index = result;
+    if (k)
+      result = ins_concat_same_descriptions(files[0], &segments[0].media, files[k], &segment->media);
+    if (result < 0)
+      break;
+
+    segment->data_position = data_size;
+    data_size += segment->media.data_end - segment->media.data_begin;
+    result = ins_plan_trailer_reads(files[k], 0, &segment->plan);
+  }
+
+  /* moov of first segment is template, chunk offsets of joined tracks are relative to joined data */
+  if (!result) {
+    joined.info = segments[0].media.info;
+    joined.data_begin = 0;
+  }
+
+  for (int i = 0; i < joined.info.tracks_count && !result; i++) {
+    InsTrimTrackType* track = &joined.tracks[i];
+    if (!segments[0].media.tracks[i].has_tables)
+      continue;
+
+    result = ins_concat_begin_track(allocator, track, segments, files_count, i);
+    for (int k = 0; k < files_count && !result; k++)
+      result = ins_concat_append_track(allocator, track, &segments[k].media.tracks[i], segments[k].media.data_begin, segments[k].data_position);
+
+    uint64_t duration = track->end_time * joined.info.timescale / (track->timescale ? track->timescale : 1);
+    if (duration > joined.movie_duration)
+      joined.movie_duration = duration;
+  }
+
+  if (!result)
+    result = ins_concat_clock_shifts(files, segments, files_count, video_index);
+
+  if (!result)
+    result = ins_concat_check_trailer(segments, files_count);
+
+  /* new layout: ftyp, moov, mdat with sample data of all segments, trailer */
+  if (!result)
+    result = ins_trim_write_media_head(&joined, files[0], data_size, file_out, io_allocator);
+
+  for (int k = 0; k < files_count && !result; k++) {
+    const InsTrimContextType* media = &segments[k].media;
+    result = ins_copy_file_region(files[k], media->data_begin, media->data_end - media->data_begin, file_out, io_allocator);
+  }
+
+  if (!result)
+    result = ins_concat_write_trailer(files, segments, files_count, file_out, io_allocator);
+
+  if (!result && out_result) {
+    const InsTrimTrackType* video = &joined.tracks[video_index];
+    out_result->start = 0;
+    out_result->end = (double)video->end_time / video->timescale;
+    out_result->video_samples = video->samples_count;
+    out_result->media_size = joined.data_offset + data_size;
+  }
+
+  ins_trim_context_destroy(&joined);
+  for (int k = 0; k < files_count; k++) {
+    ins_trim_context_destroy(&segments[k].media);
+    ins_trailer_read_plan_destroy(&segments[k].plan);
+  }
+  ins_release(allocator, segments);
+  return result;
+}
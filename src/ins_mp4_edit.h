@@ -0,0 +1,78 @@
+#ifndef INS_MP4_EDIT_HEADER
+#define INS_MP4_EDIT_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+#include "ins_mp4.h"
+
+// Editing of INSV media region. Output file is written in one pass: media boxes are copied by kernel where
+// possible (see ins_copy_file_region), changed boxes are written from memory, Insta360 trailer is rebuilt
+// by ins_write_trailer, so trailer entries are kept unchanged.
+
+#define kInsMp4AlreadyFastStart       1    /* moov is already before mdat, nothing is written */
+#define kInsMp4ErrorCodecMismatch   (-100) /* segment sample descriptions (codec configuration) differ from first segment */
+
+/** Kept range of trimmed or joined file */
+typedef struct _InsTrimResultType {
+  double start;                              /** Kept range start, seconds: sync sample at or before requested start */
+  double end;                                /** Kept range end, seconds: sync sample at or after requested end */
+  uint32_t video_samples;                    /** Kept video samples */
+  int64_t media_size;                        /** Output media region size */
+} InsTrimResultType;
+
+/**
+ * \brief    Write file with moov moved before mdat (fast start), so players can start playback after reading
+ *           file head. Chunk offsets (stco/co64) are shifted by moov size
+ * \param    file          [in]  Input file handle
+ * \param    file_out      [in]  Output file handle
+ * \param    allocator     [in]  Allocator of moov and trailer buffers
+ * \param    io_allocator  [in]  Allocator of copy buffer, used when kernel copy is not available, may be NULL
+ * \return   0 - success, kInsMp4AlreadyFastStart, kInsFileErrorNotFound - media is not mp4,
+ *           kInsFileErrorInvalidArgument - shifted offset does not fit 32-bit stco table,
+ *           kInsFileErrorMediaCorrupted, other negative - error code
+ */
+int ins_write_faststart(FILE* file, FILE* file_out, const InsAllocatorType* allocator, const InsAllocatorType* io_allocator);
+
+/**
+ * \brief    Write file trimmed to time range without re-encoding. Video is cut at sync samples, so kept range
+ *           starts at keyframe at or before start and ends before keyframe at or after end. Other tracks keep
+ *           samples decoded inside kept range. Sample tables are rebuilt, edit lists are dropped, kept sample
+ *           data is copied as one region. Time-series trailer entries (0x300, 0x400, 0x600, 0x700) are cut to
+ *           kept range, other trailer entries are copied unchanged
+ * \param    file           [in]  Input file handle
+ * \param    start_seconds  [in]  Range start
+ * \param    end_seconds    [in]  Range end, 0 or negative - up to media end
+ * \param    file_out       [in]  Output file handle
+ * \param    allocator      [in]  Allocator of moov, sample tables and rebuilt moov
+ * \param    io_allocator   [in]  Allocator of copy buffer, used when kernel copy is not available, may be NULL
+ * \param    out_result     [out] Kept range, may be NULL
+ * \return   0 - success, kInsFileErrorNotFound - media is not mp4 or has no video track,
+ *           kInsFileErrorInvalidArgument - empty range or more than kInsMp4MaxTracks tracks,
+ *           kInsFileErrorMediaCorrupted, other negative - error code
+ */
+int ins_write_trimmed(FILE* file, double start_seconds, double end_seconds, FILE* file_out,
+  const InsAllocatorType* allocator, const InsAllocatorType* io_allocator, InsTrimResultType* out_result);
+
+/**
+ * \brief    Join split recording segments into one file. Sample tables of all segments are joined into one moov
+ *           (moov of first segment is template), media data of segments is copied by kernel where possible.
+ *           Time-series trailer entries are joined: when camera clock of segment restarts, its timecodes are
+ *           rebased to continue after previous segment. Other trailer entries (0x101, preview) are taken from
+ *           first segment
+ * \param    files          [in]  Segment file handles in recording order
+ * \param    files_count    [in]  Segments count
+ * \param    file_out       [in]  Output file handle
+ * \param    allocator      [in]  Allocator of moov, sample tables and segment list
+ * \param    io_allocator   [in]  Allocator of copy buffer, used when kernel copy is not available and for
+ *                                 rebased trailer records, may be NULL
+ * \param    out_result     [out] Joined range, may be NULL
+ * \return   0 - success, kInsFileErrorNotFound - segment media is not mp4 or has no video track,
+ *           kInsFileErrorInvalidArgument - segments have different tracks or joined trailer exceeds 4 GB,
+ *           kInsMp4ErrorCodecMismatch - segments have different sample descriptions (SPS/PPS, profile, ...),
+ *           kInsFileErrorMediaCorrupted, other negative - error code
+ */
+int ins_write_concat(FILE* const* files, int files_count, FILE* file_out, const InsAllocatorType* allocator,
+  const InsAllocatorType* io_allocator, InsTrimResultType* out_result);
+
+#endif  // INS_MP4_EDIT_HEADER
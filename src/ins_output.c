@@ -0,0 +1,132 @@
+#include <string.h>
+#include "ins_output.h"
+#include "ins_file_format.h"
+
+/* 1 - byte must be escaped in JSON string: control characters, quote, backslash and DEL.
+   Bytes 0x80..0xFF are UTF-8 sequences, JSON text is UTF-8, so they are written as is */
+static const uint8_t kInsJsonEscapeTable[256] = {
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+  0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+};
+
+static const char kInsHexDigits[] = "0123456789ABCDEF";
+
+void ins_output_init(InsOutputBufferType* out, FILE* file, char* buffer, size_t capacity) {
+  out->data = buffer;
+  out->size = 0;
+  out->capacity = capacity;
+  out->file = file;
+  out->error = 0;
+}
+
+int ins_output_flush(InsOutputBufferType* out) {
+  if (out->size && fwrite(out->data, 1, out->size, out->file) != out->size)
+    out->error = 1;
+
+  out->size = 0;
+  return out->error ? kInsFileErrorIo : 0;
+}
+
+void ins_output_write(InsOutputBufferType* out, const char* data, size_t size) {
+  while (size) {
+    if (out->size == out->capacity)
+      ins_output_flush(out);
+
+    size_t chunk = out->capacity - out->size;
+    if (chunk > size)
+      chunk = size;
+
+    memcpy(out->data + out->size, data, chunk);
+    out->size += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+}
+
+void ins_output_string(InsOutputBufferType* out, const char* str) {
+  ins_output_write(out, str, strlen(str));
+}
+
+void ins_output_int64(InsOutputBufferType* out, int64_t value) {
+  char digits[24];
+  int pos = sizeof(digits);
+  uint64_t abs_value = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+
+  do {
+    digits[--pos] = (char)('0' + abs_value % 10);
+    abs_value /= 10;
+  } while (abs_value);
+
+  if (value < 0)
+    digits[--pos] = '-';
+
+  ins_output_write(out, digits + pos, sizeof(digits) - pos);
+}
+
+void ins_output_hex16(InsOutputBufferType* out, uint16_t value) {
+  char digits[4] = {
+    kInsHexDigits[(value >> 12) & 0xF], kInsHexDigits[(value >> 8) & 0xF],
+    kInsHexDigits[(value >> 4) & 0xF], kInsHexDigits[value & 0xF] };
+
+  ins_output_write(out, digits, sizeof(digits));
+}
+
+void ins_output_json_string(InsOutputBufferType* out, const char* data, size_t size) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  size_t run_start = 0;
+
+  ins_output_char(out, '"');
+
+  for (size_t i = 0; i < size; i++) {
+    if (!kInsJsonEscapeTable[bytes[i]])
+      continue;
+
+    /* copy plain run, then escape one byte */
+    ins_output_write(out, data + run_start, i - run_start);
+    run_start = i + 1;
+
+    char escape[6] = { '\\', 'u', '0', '0', kInsHexDigits[bytes[i] >> 4], kInsHexDigits[bytes[i] & 0xF] };
+
+    if (bytes[i] == '"' || bytes[i] == '\\') {
+      escape[1] = (char)bytes[i];
+      ins_output_write(out, escape, 2);
+    } else if (bytes[i] == '\n') {
+      ins_output_write(out, "\\n", 2);
+    } else {
+      ins_output_write(out, escape, sizeof(escape));
+    }
+  }
+
+  ins_output_write(out, data + run_start, size - run_start);
+  ins_output_char(out, '"');
+}
+
+void ins_output_csv_field(InsOutputBufferType* out, const char* data, size_t size) {
+  if (!memchr(data, ',', size) && !memchr(data, '"', size) && !memchr(data, '\n', size) && !memchr(data, '\r', size)) {
+    ins_output_write(out, data, size);
+    return;
+  }
+
+  ins_output_char(out, '"');
+
+  /* quotes are doubled: copy runs between quotes */
+  const char* end = data + size;
+  while (data < end) {
+    const char* quote = (const char*)memchr(data, '"', end - data);
+    const char* run_end = quote ? quote + 1 : end;
+
+    ins_output_write(out, data, run_end - data);
+    if (quote)
+      ins_output_char(out, '"');
+
+    data = run_end;
+  }
+
+  ins_output_char(out, '"');
+}
@@ -0,0 +1,72 @@
+#ifndef INS_OUTPUT_HEADER
+#define INS_OUTPUT_HEADER
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Buffered text output for machine readable formats (JSON, CSV). All writes go to one caller supplied
+// buffer which is written to file when full, escaping copies runs of plain bytes with one memcpy.
+
+/** Output buffer */
+typedef struct _InsOutputBufferType {
+  char* data;                                /** Buffer */
+  size_t size;                               /** Used bytes */
+  size_t capacity;                           /** Buffer size */
+  FILE* file;                                /** Output file */
+  int error;                                 /** Non-zero after write error */
+} InsOutputBufferType;
+
+/**
+ * \brief    Initialize output buffer
+ * \param    out        [out] Output buffer
+ * \param    file       [in]  Output file
+ * \param    buffer     [in]  Buffer memory, must live while output is used
+ * \param    capacity   [in]  Buffer size, at least 64 bytes
+ */
+void ins_output_init(InsOutputBufferType* out, FILE* file, char* buffer, size_t capacity);
+
+/**
+ * \brief    Write buffered data to file
+ * \param    out   [in]  Output buffer
+ * \return   0 - success, kInsFileErrorIo - write error (now or before)
+ */
+int ins_output_flush(InsOutputBufferType* out);
+
+/** Append bytes */
+void ins_output_write(InsOutputBufferType* out, const char* data, size_t size);
+
+/** Append zero-terminated string as is */
+void ins_output_string(InsOutputBufferType* out, const char* str);
+
+/** Append one character */
+static inline void ins_output_char(InsOutputBufferType* out, char c) {
+  if (out->size == out->capacity)
+    ins_output_flush(out);
+  out->data[out->size++] = c;
+}
+
+/** Append signed decimal integer */
+void ins_output_int64(InsOutputBufferType* out, int64_t value);
+
+/** Append 16-bit value as 4 uppercase hex digits */
+void ins_output_hex16(InsOutputBufferType* out, uint16_t value);
+
+/**
+ * \brief    Append JSON string literal with quotes. Quote, backslash, control characters and DEL are escaped
+ *           (\u00XX), bytes above 0x7F are written as is, so UTF-8 text passes through unchanged
+ * \param    out    [in]  Output buffer
+ * \param    data   [in]  String bytes
+ * \param    size   [in]  Bytes count
+ */
+void ins_output_json_string(InsOutputBufferType* out, const char* data, size_t size);
+
+/**
+ * \brief    Append CSV field (RFC 4180). Field is quoted when it contains separator, quote or line break
+ * \param    out    [in]  Output buffer
+ * \param    data   [in]  Field bytes
+ * \param    size   [in]  Bytes count
+ */
+void ins_output_csv_field(InsOutputBufferType* out, const char* data, size_t size);
+
+#endif  // INS_OUTPUT_HEADER
@@ -0,0 +1,485 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* copy_file_range */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "ins_platform.h"
+#include "ins_file_format.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define INS_HAVE_COPY_FILE_RANGE
+#endif
+#endif
+
+int ins_enum_directory(const char* dir_path, InsEnumDirectoryCallback callback, void* ctx) {
+  int result = 0;
+
+#ifdef _WIN32
+  char pattern[MAX_PATH];
+  WIN32_FIND_DATAA find_data;
+
+  if (ins_join_path(pattern, sizeof(pattern), dir_path, "*", NULL) < 0)
+    return -1;
+
+  HANDLE find_handle = FindFirstFileA(pattern, &find_data);
+  if (find_handle == INVALID_HANDLE_VALUE)
+    return -1;
+
+  do {
+    if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      continue;
+
+    if (callback(dir_path, find_data.cFileName, ctx)) {
+      result = 1;
+      break;
+    }
+  } while (FindNextFileA(find_handle, &find_data));
+
+  FindClose(find_handle);
+#else
+  DIR* dir = opendir(dir_path);
+  if (!dir)
+    return -1;
+
+  struct dirent* entry;
+  char path[4096];
+
+  while ((entry = readdir(dir)) != NULL) {
+    struct stat st;
+
+    if (ins_join_path(path, sizeof(path), dir_path, entry->d_name, NULL) < 0)
+      continue;
+
+    if (stat(path, &st) || !S_ISREG(st.st_mode))
+      continue;
+
+    if (callback(dir_path, entry->d_name, ctx)) {
+      result = 1;
+      break;
+    }
+  }
+
+  closedir(dir);
+#endif
+
+  return result;
+}
+
+int ins_is_media_file_name(const char* file_name) {
+  size_t len = strlen(file_name);
+  if (len < 5 || file_name[len - 5] != '.')
+    return 0;
+
+  const char* ext = file_name + len - 4;
+
+  if (tolower((unsigned char)ext[0]) != 'i' || tolower((unsigned char)ext[1]) != 'n' || tolower((unsigned char)ext[2]) != 's')
+    return 0;
+
+  return tolower((unsigned char)ext[3]) == 'v' || tolower((unsigned char)ext[3]) == 'p';
+}
+
+int ins_lens_file_name(const char* file_name, char* out_partner, size_t out_partner_size) {
+  const char* ext = strrchr(file_name, '.');
+  const char* number = ext;
+
+  /* lens is two digits between underscores before sequence number: _00_001.insv */
+  while (number && number > file_name && isdigit((unsigned char)number[-1]))
+    number--;
+
+  if (!number || number == ext || number - file_name < 4 || number[-1] != '_' || number[-4] != '_' || number[-2] != '0' ||
+      (number[-3] != '0' && number[-3] != '1'))
+    return -1;
+
+  size_t len = strlen(file_name);
+  if (len >= out_partner_size)
+    return -1;
+
+  int lens = number[-3] == '1';
+  memcpy(out_partner, file_name, len + 1);
+  out_partner[number - 3 - file_name] = lens ? '0' : '1';
+  return lens;
+}
+
+int ins_join_path(char* out_path, size_t out_path_size, const char* dir_path, const char* file_name, const char* suffix) {
+  size_t dir_len = strlen(dir_path);
+  int need_separator = dir_len > 0 && dir_path[dir_len - 1] != '/' && dir_path[dir_len - 1] != '\\';
+
+  int written = snprintf(out_path, out_path_size, "%s%s%s%s",
+    dir_path, need_separator ? kInsPathSeparator : "", file_name, suffix ? suffix : "");
+
+  if (written < 0 || (size_t)written >= out_path_size)
+    return -1;
+
+  return 0;
+}
+
+int ins_copy_file_region(FILE* file_in, int64_t offset, int64_t length, FILE* file_out, const InsAllocatorType* allocator) {
+  if (fflush(file_out))
+    return kInsFileErrorIo;
+
+#ifdef __linux__
+  {
+    /* kernel copies from page cache to output, no user space buffers */
+    off_t in_offset = (off_t)offset;
+    int64_t left = length;
+    int fd_in = fileno(file_in);
+    int fd_out = fileno(file_out);
+
+    /* make output descriptor position match stdio position */
+    if (lseek(fd_out, ins_ftell64(file_out), SEEK_SET) < 0)
+      return kInsFileErrorIo;
+
+#ifdef INS_HAVE_COPY_FILE_RANGE
+    /* same filesystem: data may be shared (reflink) or copied inside filesystem, fails with EXDEV on older kernels */
+    while (left > 0) {
+      ssize_t copied = copy_file_range(fd_in, &in_offset, fd_out, NULL, (size_t)(left > 0x40000000 ? 0x40000000 : left), 0);
+      if (copied <= 0)
+        break;
+      left -= copied;
+    }
+#endif
+
+    while (left > 0) {
+      ssize_t sent = sendfile(fd_out, fd_in, &in_offset, (size_t)(left > 0x40000000 ? 0x40000000 : left));
+      if (sent <= 0)
+        break;
+      left -= sent;
+    }
+
+    if (left == 0)
+      return ins_fseek64(file_out, 0, SEEK_CUR) ? kInsFileErrorIo : 0;
+
+    /* sendfile not supported for these descriptors, continue with buffered copy */
+    if (ins_fseek64(file_out, 0, SEEK_CUR))
+      return kInsFileErrorIo;
+
+    offset += length - left;
+    length = left;
+  }
+#endif
+
+  char* buffer = (char*)ins_allocate(allocator, kInsCopyRegionBufferSize);
+  if (!buffer)
+    return kInsFileErrorNoMemory;
+
+  int result = 0;
+
+  if (ins_fseek64(file_in, offset, SEEK_SET))
+    result = kInsFileErrorIo;
+
+  while (!result && length > 0) {
+    size_t chunk = (size_t)(length > kInsCopyRegionBufferSize ? kInsCopyRegionBufferSize : length);
+
+    if (fread(buffer, 1, chunk, file_in) != chunk)
+      result = kInsFileErrorIo;
+    else if (fwrite(buffer, 1, chunk, file_out) != chunk)
+      result = kInsFileErrorIo;
+
+    length -= chunk;
+  }
+
+  ins_release(allocator, buffer);
+  return result;
+}
+
+int ins_truncate_file(FILE* file, int64_t size) {
+  if (fflush(file))
+    return kInsFileErrorIo;
+
+#ifdef _WIN32
+  return _chsize_s(_fileno(file), size) ? kInsFileErrorIo : 0;
+#else
+  return ftruncate(fileno(file), (off_t)size) ? kInsFileErrorIo : 0;
+#endif
+}
+
+void* ins_alloc_pages(size_t size, int huge_pages, int* out_is_huge) {
+  void* ptr;
+
+  if (out_is_huge)
+    *out_is_huge = 0;
+
+#ifdef _WIN32
+  if (huge_pages) {
+    /* works only when process has SeLockMemoryPrivilege, otherwise regular pages are used */
+    SIZE_T large_page = GetLargePageMinimum();
+
+    if (large_page && size % large_page == 0) {
+      ptr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+      if (ptr) {
+        if (out_is_huge)
+          *out_is_huge = 1;
+        return ptr;
+      }
+    }
+  }
+
+  return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+#ifdef MAP_HUGETLB
+  if (huge_pages) {
+    /* fails when no huge pages are reserved (vm.nr_hugepages), then transparent huge pages are requested */
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      if (out_is_huge)
+        *out_is_huge = 1;
+      return ptr;
+    }
+  }
+#endif
+
+  ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    return NULL;
+
+#ifdef MADV_HUGEPAGE
+  if (huge_pages)
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+  return ptr;
+#endif
+}
+
+void ins_free_pages(void* ptr, size_t size) {
+  if (!ptr)
+    return;
+
+#ifdef _WIN32
+  (void)size;
+  VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+  munmap(ptr, size);
+#endif
+}
+
+int ins_map_file_region(FILE* file, int64_t offset, uint64_t size, int populate, InsMappedRegionType* out_region) {
+  if (size == 0 || offset < 0)
+    return kInsFileErrorIo;
+
+#ifdef _WIN32
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+
+  uint64_t aligned_offset = (uint64_t)offset & ~((uint64_t)system_info.dwAllocationGranularity - 1);
+  uint64_t map_size = (uint64_t)offset - aligned_offset + size;
+
+  HANDLE file_handle = (HANDLE)_get_osfhandle(_fileno(file));
+  if (file_handle == INVALID_HANDLE_VALUE)
+    return kInsFileErrorIo;
+
+  HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping_handle)
+    return kInsFileErrorIo;
+
+  void* map_base = MapViewOfFile(mapping_handle, FILE_MAP_READ, 
+    (DWORD)(aligned_offset >> 32), (DWORD)(aligned_offset & 0xFFFFFFFF), (SIZE_T)map_size);
+
+  if (!map_base) {
+    CloseHandle(mapping_handle);
+    return kInsFileErrorIo;
+  }
+
+  (void)populate; /* pages are read on first access */
+  out_region->mapping_handle = mapping_handle;
+#else
+  uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t aligned_offset = (uint64_t)offset & ~(page_size - 1);
+  uint64_t map_size = (uint64_t)offset - aligned_offset + size;
+  int flags = MAP_SHARED;
+
+#ifdef MAP_POPULATE
+  if (populate)
+    flags |= MAP_POPULATE;
+#endif
+
+  void* map_base = mmap(NULL, (size_t)map_size, PROT_READ, flags, fileno(file), (off_t)aligned_offset);
+  if (map_base == MAP_FAILED)
+    return kInsFileErrorIo;
+
+#ifndef MAP_POPULATE
+  if (populate)
+    madvise(map_base, (size_t)map_size, MADV_WILLNEED);
+#endif
+#endif
+
+  out_region->map_base = map_base;
+  out_region->map_size = map_size;
+  out_region->data = (const uint8_t*)map_base + ((uint64_t)offset - aligned_offset);
+  out_region->size = size;
+
+  return 0;
+}
+
+void ins_advise_file_region(const InsMappedRegionType* region, uint64_t offset, uint64_t size) {
+#ifndef _WIN32
+  uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)(region->data + offset);
+  uintptr_t aligned_start = start & ~(uintptr_t)(page_size - 1);
+
+  if (offset + size > region->size || size == 0)
+    return;
+
+  madvise((void*)aligned_start, (size_t)(start - aligned_start + size), MADV_WILLNEED);
+#else
+  (void)region;
+  (void)offset;
+  (void)size;
+#endif
+}
+
+void ins_unmap_file_region(InsMappedRegionType* region) {
+  if (!region->map_base)
+    return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(region->map_base);
+  CloseHandle((HANDLE)region->mapping_handle);
+#else
+  munmap(region->map_base, (size_t)region->map_size);
+#endif
+
+  region->map_base = NULL;
+  region->data = NULL;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI ins_thread_proc(LPVOID param) {
+  InsThreadType* thread = (InsThreadType*)param;
+  thread->result = thread->func(thread->ctx);
+  return 0;
+}
+#else
+static void* ins_thread_proc(void* param) {
+  InsThreadType* thread = (InsThreadType*)param;
+  thread->result = thread->func(thread->ctx);
+  return NULL;
+}
+#endif
+
+int ins_thread_create(InsThreadType* thread, InsThreadFunc func, void* ctx) {
+  thread->func = func;
+  thread->ctx = ctx;
+  thread->result = 0;
+
+#ifdef _WIN32
+  thread->handle = CreateThread(NULL, 0, ins_thread_proc, thread, 0, NULL);
+  return thread->handle ? 0 : -1;
+#else
+  return pthread_create(&thread->thread, NULL, ins_thread_proc, thread) ? -1 : 0;
+#endif
+}
+
+int ins_thread_join(InsThreadType* thread) {
+#ifdef _WIN32
+  WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+  CloseHandle((HANDLE)thread->handle);
+#else
+  pthread_join(thread->thread, NULL);
+#endif
+
+  return thread->result;
+}
+
+void ins_mutex_init(InsMutexType* mutex) {
+#ifdef _WIN32
+  InitializeSRWLock((PSRWLOCK)&mutex->srw_lock);
+#else
+  pthread_mutex_init(&mutex->mutex, NULL);
+#endif
+}
+
+void ins_mutex_destroy(InsMutexType* mutex) {
+#ifdef _WIN32
+  (void)mutex; /* SRW lock has no resources */
+#else
+  pthread_mutex_destroy(&mutex->mutex);
+#endif
+}
+
+void ins_mutex_lock(InsMutexType* mutex) {
+#ifdef _WIN32
+  AcquireSRWLockExclusive((PSRWLOCK)&mutex->srw_lock);
+#else
+  pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+void ins_mutex_unlock(InsMutexType* mutex) {
+#ifdef _WIN32
+  ReleaseSRWLockExclusive((PSRWLOCK)&mutex->srw_lock);
+#else
+  pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
+
+void ins_condition_init(InsConditionType* condition) {
+#ifdef _WIN32
+  InitializeConditionVariable((PCONDITION_VARIABLE)&condition->condition_variable);
+#else
+  pthread_cond_init(&condition->condition, NULL);
+#endif
+}
+
+void ins_condition_destroy(InsConditionType* condition) {
+#ifdef _WIN32
+  (void)condition; /* condition variable has no resources */
+#else
+  pthread_cond_destroy(&condition->condition);
+#endif
+}
+
+void ins_condition_wait(InsConditionType* condition, InsMutexType* mutex) {
+#ifdef _WIN32
+  SleepConditionVariableSRW((PCONDITION_VARIABLE)&condition->condition_variable, (PSRWLOCK)&mutex->srw_lock, INFINITE, 0);
+#else
+  pthread_cond_wait(&condition->condition, &mutex->mutex);
+#endif
+}
+
+void ins_condition_broadcast(InsConditionType* condition) {
+#ifdef _WIN32
+  WakeAllConditionVariable((PCONDITION_VARIABLE)&condition->condition_variable);
+#else
+  pthread_cond_broadcast(&condition->condition);
+#endif
+}
+
+int64_t ins_monotonic_time_us(void) {
+#ifdef _WIN32
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (int64_t)(counter.QuadPart / frequency.QuadPart * 1000000 + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+int ins_cpu_count(void) {
+#ifdef _WIN32
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  return system_info.dwNumberOfProcessors > 0 ? (int)system_info.dwNumberOfProcessors : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int)count : 1;
+#endif
+}
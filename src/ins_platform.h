@@ -0,0 +1,211 @@
+#ifndef INS_PLATFORM_HEADER
+#define INS_PLATFORM_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#ifdef _WIN32
+#define ins_fseek64 _fseeki64
+#define ins_ftell64 _ftelli64
+#define kInsPathSeparator "\\"
+#else
+#define ins_fseek64 fseeko
+#define ins_ftell64 ftello
+#define kInsPathSeparator "/"
+#endif
+
+/** Callback for ins_enum_directory, called for each regular file. Return non-zero to stop enumeration */
+typedef int (*InsEnumDirectoryCallback)(const char* dir_path, const char* file_name, void* ctx);
+
+/**
+ * \brief    Enumerate regular files in directory (not recursive)
+ * \param    dir_path   [in]  Directory path
+ * \param    callback   [in]  Function called for each file
+ * \param    ctx        [in]  User context passed to callback
+ * \return   0 - success, positive - stopped by callback, negative - cannot open directory
+ */
+int ins_enum_directory(const char* dir_path, InsEnumDirectoryCallback callback, void* ctx);
+
+/**
+ * \brief    Check file name has INSV or INSP extension (case insensitive)
+ * \param    file_name  [in]  File name
+ * \return   1 - Insta360 media file name, 0 - other file
+ */
+int ins_is_media_file_name(const char* file_name);
+
+/**
+ * \brief    Get lens of dual-lens file name and name of the other lens file. Cameras writing one file per lens
+ *           name them ..._00_NNN.insv (lens 0) and ..._10_NNN.insv (lens 1)
+ * \param    file_name           [in]  File name
+ * \param    out_partner         [out] Name of the other lens file
+ * \param    out_partner_size    [in]  Output buffer size
+ * \return   0 or 1 - lens of file, -1 - name has no lens number or output buffer too small
+ */
+int ins_lens_file_name(const char* file_name, char* out_partner, size_t out_partner_size);
+
+/**
+ * \brief    Build path from directory, file name and optional suffix
+ * \param    out_path       [out] Output buffer
+ * \param    out_path_size  [in]  Output buffer size
+ * \param    dir_path       [in]  Directory path
+ * \param    file_name      [in]  File name
+ * \param    suffix         [in]  Suffix appended to file name, may be NULL
+ * \return   0 - success, negative - output buffer too small
+ */
+int ins_join_path(char* out_path, size_t out_path_size, const char* dir_path, const char* file_name, const char* suffix);
+
+#define kInsCopyRegionBufferSize  (1024*1024) /* Buffer size for copy when kernel copy is not available */
+
+/**
+ * \brief    Copy file region to current position of output file. Uses copy_file_range or sendfile where available,
+ *           so data does not pass through user space buffers (and may be shared by filesystem). Input file
+ *           position is not used
+ * \param    file_in    [in]  Input file
+ * \param    offset     [in]  Region offset in input file
+ * \param    length     [in]  Region length
+ * \param    file_out   [in]  Output file
+ * \param    allocator  [in]  Allocator of copy buffer (kInsCopyRegionBufferSize bytes), used only when kernel copy
+ *                            is not available
+ * \return   0 - success, kInsFileErrorIo - read or write error, kInsFileErrorNoMemory
+ */
+int ins_copy_file_region(FILE* file_in, int64_t offset, int64_t length, FILE* file_out, const InsAllocatorType* allocator);
+
+/**
+ * \brief    Flush output file and set its size, data after new size is discarded
+ * \param    file   [in]  File opened for writing
+ * \param    size   [in]  New file size
+ * \return   0 - success, kInsFileErrorIo
+ */
+int ins_truncate_file(FILE* file, int64_t size);
+
+/**
+ * \brief    Allocate page-aligned memory directly from OS
+ * \param    size          [in]  Size, multiple of huge page size when huge pages are requested
+ * \param    huge_pages    [in]  Non-zero - try huge pages (MAP_HUGETLB / MEM_LARGE_PAGES), then transparent huge pages
+ * \param    out_is_huge   [out] Function saves 1 when memory is backed by explicit huge pages, may be NULL
+ * \return   Pointer to memory, NULL on fail
+ */
+void* ins_alloc_pages(size_t size, int huge_pages, int* out_is_huge);
+
+/**
+ * \brief    Free memory allocated by ins_alloc_pages
+ * \param    ptr    [in]  Memory
+ * \param    size   [in]  Size passed to ins_alloc_pages
+ */
+void ins_free_pages(void* ptr, size_t size);
+
+/** Read-only memory mapped file region */
+typedef struct _InsMappedRegionType {
+  const uint8_t* data;                       /** Requested region start */
+  uint64_t size;                             /** Requested region size */
+  void* map_base;                            /** Mapping start, aligned to page or allocation granularity */
+  uint64_t map_size;                         /** Mapping size */
+#ifdef _WIN32
+  void* mapping_handle;                      /** File mapping object */
+#endif
+} InsMappedRegionType;
+
+/**
+ * \brief    Map file region to memory, read-only. Pages are shared with page cache and other processes
+ * \param    file         [in]  File handle
+ * \param    offset       [in]  Region offset in file
+ * \param    size         [in]  Region size, must be greater than zero
+ * \param    populate     [in]  Non-zero - read all region pages during mapping (whole region will be used)
+ * \param    out_region   [out] Mapped region
+ * \return   0 - success, negative - mapping is not supported or failed, caller should use regular read
+ */
+int ins_map_file_region(FILE* file, int64_t offset, uint64_t size, int populate, InsMappedRegionType* out_region);
+
+/**
+ * \brief    Tell OS that part of mapped region will be used soon, so pages are read ahead in one request
+ * \param    region   [in]  Mapped region
+ * \param    offset   [in]  Offset from region data start
+ * \param    size     [in]  Bytes count
+ */
+void ins_advise_file_region(const InsMappedRegionType* region, uint64_t offset, uint64_t size);
+
+/**
+ * \brief    Unmap region mapped by ins_map_file_region
+ * \param    region   [in]  Mapped region
+ */
+void ins_unmap_file_region(InsMappedRegionType* region);
+
+/** Thread function, return value is available after ins_thread_join */
+typedef int (*InsThreadFunc)(void* ctx);
+
+/** Thread */
+typedef struct _InsThreadType {
+#ifdef _WIN32
+  void* handle;                              /** Thread handle */
+#else
+  pthread_t thread;                          /** POSIX thread */
+#endif
+  InsThreadFunc func;                        /** Thread function */
+  void* ctx;                                 /** Thread function context */
+  int result;                                /** Thread function result */
+} InsThreadType;
+
+/** Mutex */
+typedef struct _InsMutexType {
+#ifdef _WIN32
+  void* srw_lock;                            /** SRWLOCK, pointer sized */
+#else
+  pthread_mutex_t mutex;                     /** POSIX mutex */
+#endif
+} InsMutexType;
+
+/** Condition variable, used with InsMutexType */
+typedef struct _InsConditionType {
+#ifdef _WIN32
+  void* condition_variable;                  /** CONDITION_VARIABLE, pointer sized */
+#else
+  pthread_cond_t condition;                  /** POSIX condition variable */
+#endif
+} InsConditionType;
+
+/**
+ * \brief    Start thread
+ * \param    thread   [out] Thread, must stay valid until ins_thread_join
+ * \param    func     [in]  Thread function
+ * \param    ctx      [in]  Thread function context
+ * \return   0 - success, negative - cannot create thread
+ */
+int ins_thread_create(InsThreadType* thread, InsThreadFunc func, void* ctx);
+
+/**
+ * \brief    Wait for thread end
+ * \param    thread   [in]  Thread started by ins_thread_create
+ * \return   Thread function result
+ */
+int ins_thread_join(InsThreadType* thread);
+
+void ins_mutex_init(InsMutexType* mutex);
+void ins_mutex_destroy(InsMutexType* mutex);
+void ins_mutex_lock(InsMutexType* mutex);
+void ins_mutex_unlock(InsMutexType* mutex);
+
+void ins_condition_init(InsConditionType* condition);
+void ins_condition_destroy(InsConditionType* condition);
+
+/**
+ * \brief    Unlock mutex, wait for signal and lock mutex again. Wakeup may be spurious, caller checks its state in loop
+ * \param    condition   [in]  Condition variable
+ * \param    mutex       [in]  Mutex locked by caller
+ */
+void ins_condition_wait(InsConditionType* condition, InsMutexType* mutex);
+
+/** Wake all threads waiting for condition */
+void ins_condition_broadcast(InsConditionType* condition);
+
+/** Monotonic time in microseconds from unspecified start, for measuring intervals */
+int64_t ins_monotonic_time_us(void);
+
+/** Number of logical processors, at least 1 */
+int ins_cpu_count(void);
+
+#endif  // INS_PLATFORM_HEADER
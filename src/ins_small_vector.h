@@ -0,0 +1,82 @@
+#ifndef INS_SMALL_VECTOR_HEADER
+#define INS_SMALL_VECTOR_HEADER
+
+#include <stdint.h>
+#include <string.h>
+#include "ins_allocator.h"
+#include "ins_file_format.h"
+
+// Vector with inline storage for first items, heap storage is allocated only when vector grows beyond it.
+// Inline capacity is chosen per list from real trailers, so typical files never allocate.
+// Struct does not point to itself: items are in inline_items while heap is NULL, so vector can be moved
+// by plain assignment (ins_small_vector_move resets source).
+
+#define ins_small_vector_t(type, inline_capacity) \
+  struct {                                        \
+    int32_t n, m;                                 \
+    type* heap;                                   \
+    type inline_items[inline_capacity];           \
+  }
+
+#define ins_small_vector_inline_capacity(v)  ((int32_t)(sizeof((v)->inline_items) / sizeof((v)->inline_items[0])))
+
+#define ins_small_vector_init(v)  ((v)->n = 0, (v)->m = ins_small_vector_inline_capacity(v), (v)->heap = NULL)
+#define ins_small_vector_destroy(allocator, v)  (ins_release((allocator), (v)->heap), ins_small_vector_init(v))
+#define ins_small_vector_clear(v)  ((v)->n = 0)
+#define ins_small_vector_size(v)  ((v)->n)
+#define ins_small_vector_data(v)  ((v)->heap ? (v)->heap : (v)->inline_items)
+#define ins_small_vector_at(v, i)  (ins_small_vector_data(v)[(i)])
+
+/** Typed iterators: pointers to first and past last item, valid until vector grows */
+#define ins_small_vector_begin(v)  (ins_small_vector_data(v))
+#define ins_small_vector_end(v)  (ins_small_vector_data(v) + (v)->n)
+
+/** Move items from src to dst, dst must be empty or destroyed. Source is left empty */
+#define ins_small_vector_move(dst, src)  (*(dst) = *(src), ins_small_vector_init(src))
+
+/** Make sure vector has space for count more items. Evaluates to 0 - success, kInsFileErrorNoMemory */
+#define ins_small_vector_reserve(allocator, v, count)                                                 \
+  (((v)->n + (count) > (v)->m)                                                                        \
+     ? ins_small_vector_grow((allocator), (void**)&(v)->heap, (v)->inline_items, &(v)->m, (v)->n,     \
+                             sizeof((v)->inline_items[0]), (v)->n + (count))                          \
+     : 0)
+
+/** Append item. Evaluates to 0 - success, kInsFileErrorNoMemory */
+#define ins_small_vector_push(allocator, v, x)                                                        \
+  (ins_small_vector_reserve((allocator), (v), 1) < 0                                                  \
+     ? kInsFileErrorNoMemory                                                                          \
+     : (ins_small_vector_data(v)[(v)->n++] = (x), 0))
+
+/** Move items to larger heap storage, capacity grows geometrically */
+static inline int ins_small_vector_grow(
+  const InsAllocatorType* allocator, 
+  void** heap, 
+  const void* inline_items, 
+  int32_t* capacity, 
+  int32_t size, 
+  size_t item_size, 
+  int32_t required) {
+
+  int32_t new_capacity = *capacity * 2;
+  if (new_capacity < required)
+    new_capacity = required;
+
+  void* new_heap;
+
+  if (*heap) {
+    new_heap = ins_reallocate(allocator, *heap, item_size * (size_t)*capacity, item_size * (size_t)new_capacity);
+  } else {
+    new_heap = ins_allocate(allocator, item_size * (size_t)new_capacity);
+    if (new_heap)
+      memcpy(new_heap, inline_items, item_size * (size_t)size);
+  }
+
+  if (!new_heap)
+    return kInsFileErrorNoMemory;
+
+  *heap = new_heap;
+  *capacity = new_capacity;
+  return 0;
+}
+
+#endif  // INS_SMALL_VECTOR_HEADER
@@ -0,0 +1,123 @@
+#include <math.h>
+#include <string.h>
+#include "ins_stats.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INS_STATS_USE_SSE2
+#endif
+
+void ins_compute_stats(const double* values, int32_t count, InsStatsType* out) {
+  memset(out, 0, sizeof(*out));
+  if (count <= 0)
+    return;
+
+  double sum = 0.0;
+  double min = values[0];
+  double max = values[0];
+  int32_t i = 0;
+
+#ifdef INS_STATS_USE_SSE2
+  __m128d sum2 = _mm_setzero_pd();
+  __m128d min2 = _mm_set1_pd(values[0]);
+  __m128d max2 = min2;
+  double lanes[2];
+
+  for (; i + 1 < count; i += 2) {
+    __m128d v = _mm_loadu_pd(values + i);
+    sum2 = _mm_add_pd(sum2, v);
+    min2 = _mm_min_pd(min2, v);
+    max2 = _mm_max_pd(max2, v);
+  }
+
+  _mm_storeu_pd(lanes, sum2);
+  sum = lanes[0] + lanes[1];
+  _mm_storeu_pd(lanes, min2);
+  min = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+  _mm_storeu_pd(lanes, max2);
+  max = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+#endif
+
+  for (; i < count; i++) {
+    sum += values[i];
+    if (values[i] < min)
+      min = values[i];
+    if (values[i] > max)
+      max = values[i];
+  }
+
+  double mean = sum / count;
+  double squares = 0.0;
+  i = 0;
+
+  /* second pass over deviations, no cancellation as in sum of squares minus squared sum */
+#ifdef INS_STATS_USE_SSE2
+  __m128d mean2 = _mm_set1_pd(mean);
+  __m128d squares2 = _mm_setzero_pd();
+
+  for (; i + 1 < count; i += 2) {
+    __m128d d = _mm_sub_pd(_mm_loadu_pd(values + i), mean2);
+    squares2 = _mm_add_pd(squares2, _mm_mul_pd(d, d));
+  }
+
+  _mm_storeu_pd(lanes, squares2);
+  squares = lanes[0] + lanes[1];
+#endif
+
+  for (; i < count; i++) {
+    double d = values[i] - mean;
+    squares += d * d;
+  }
+
+  out->count = count;
+  out->mean = mean;
+  out->stddev = count > 1 ? sqrt(squares / (count - 1)) : 0.0;
+  out->min = min;
+  out->max = max;
+}
+
+int ins_find_outliers(
+  const double* values,
+  int32_t count,
+  const InsStatsType* stats,
+  double threshold_sigma,
+  const InsAllocatorType* allocator,
+  InsInt32Vector* out_indices) {
+
+  const double limit = fabs(threshold_sigma) * stats->stddev;
+  int found = 0;
+  int32_t i = 0;
+
+  /* all values are equal */
+  if (limit <= 0.0)
+    return 0;
+
+#ifdef INS_STATS_USE_SSE2
+  const __m128d mean2 = _mm_set1_pd(stats->mean);
+  const __m128d limit2 = _mm_set1_pd(limit);
+  const __m128d sign_mask = _mm_set1_pd(-0.0);
+
+  /* distance to mean of two values per step, indices are appended only for steps with outlier */
+  for (; i + 1 < count; i += 2) {
+    __m128d distance = _mm_andnot_pd(sign_mask, _mm_sub_pd(_mm_loadu_pd(values + i), mean2));
+    int mask = _mm_movemask_pd(_mm_cmpgt_pd(distance, limit2));
+
+    if (mask) {
+      int result = ins_append_mask_indices((uint32_t)mask, i, allocator, out_indices);
+      if (result < 0)
+        return result;
+      found += result;
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    if (fabs(values[i] - stats->mean) > limit) {
+      if (ins_append_mask_indices(1, i, allocator, out_indices) < 0)
+        return kInsFileErrorNoMemory;
+      found++;
+    }
+  }
+
+  return found;
+}
@@ -0,0 +1,46 @@
+#ifndef INS_STATS_HEADER
+#define INS_STATS_HEADER
+
+#include <stdint.h>
+#include "ins_allocator.h"
+#include "ins_trailer_streams.h"
+
+// Column statistics for fleet-wide analysis (one value per file). Reductions process two values per
+// SSE2 instruction, lanes are combined in fixed order, so results do not depend on threads or timing.
+
+/** Statistics of values column */
+typedef struct _InsStatsType {
+  int32_t count;                             /** Values count */
+  double mean;                               /** Mean value */
+  double stddev;                             /** Sample standard deviation, 0 for less than 2 values */
+  double min;                                /** Minimum value */
+  double max;                                /** Maximum value */
+} InsStatsType;
+
+/**
+ * \brief    Compute mean, standard deviation (two passes, numerically stable), minimum and maximum
+ * \param    values   [in]  Values array
+ * \param    count    [in]  Values count, may be 0
+ * \param    out      [out] Statistics, all zero for empty array
+ */
+void ins_compute_stats(const double* values, int32_t count, InsStatsType* out);
+
+/**
+ * \brief    Find values farther from mean than threshold standard deviations
+ * \param    values           [in]  Values array
+ * \param    count            [in]  Values count
+ * \param    stats            [in]  Statistics of values from ins_compute_stats
+ * \param    threshold_sigma  [in]  Threshold in standard deviations
+ * \param    allocator        [in]  Allocator of indices vector
+ * \param    out_indices      [out] Function appends indices of outliers
+ * \return   Found outliers count, kInsFileErrorNoMemory
+ */
+int ins_find_outliers(
+  const double* values,
+  int32_t count,
+  const InsStatsType* stats,
+  double threshold_sigma,
+  const InsAllocatorType* allocator,
+  InsInt32Vector* out_indices);
+
+#endif  // INS_STATS_HEADER
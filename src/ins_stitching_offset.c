@@ -0,0 +1,296 @@
+#include <string.h>
+#include "ins_stitching_offset.h"
+#include "ins_hash.h"
+
+#define kInsLensFieldsCount   6
+#define kInsTailFieldsCount   3
+
+static const int64_t kInsPow10[kInsStitchingOffsetMaxDigits + 1] = {
+  1ll, 10ll, 100ll, 1000ll, 10000ll, 100000ll, 1000000ll, 10000000ll, 100000000ll, 1000000000ll,
+  10000000000ll, 100000000000ll, 1000000000000ll, 10000000000000ll, 100000000000000ll,
+  1000000000000000ll, 10000000000000000ll, 100000000000000000ll, 1000000000000000000ll
+};
+
+/* parse plain decimal number in [p, end), returns 0 or kInsFileErrorInvalidArgument */
+static int ins_parse_decimal(const char* p, const char* end, InsDecimalType* out) {
+  uint64_t mantissa = 0;
+  int negative = 0;
+  int int_digits = 0;
+  int decimals = -1; /* -1 until point is found */
+
+  if (p < end && *p == '-') {
+    negative = 1;
+    p++;
+  }
+
+  const char* digits_start = p;
+
+  for (; p < end; p++) {
+    unsigned digit = (unsigned)(*p - '0');
+
+    if (digit <= 9) {
+      if (int_digits + (decimals > 0 ? decimals : 0) >= kInsStitchingOffsetMaxDigits)
+        return kInsFileErrorInvalidArgument;
+
+      mantissa = mantissa * 10 + digit;
+      if (decimals < 0)
+        int_digits++;
+      else
+        decimals++;
+    } else if (*p == '.' && decimals < 0 && int_digits) {
+      decimals = 0;
+    } else {
+      return kInsFileErrorInvalidArgument;
+    }
+  }
+
+  /* "1." and leading zeros ("01.5") would not survive round trip */
+  if (!int_digits || !decimals || (int_digits > 1 && *digits_start == '0'))
+    return kInsFileErrorInvalidArgument;
+
+  out->mantissa = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+  out->decimals = (uint8_t)(decimals < 0 ? 0 : decimals);
+  out->negative = (uint8_t)negative;
+  return 0;
+}
+
+static int ins_parse_uint32(const char* p, const char* end, uint32_t* out) {
+  InsDecimalType value;
+
+  if (ins_parse_decimal(p, end, &value) < 0 || value.decimals || value.negative || value.mantissa > 0xFFFFFFFFll)
+    return kInsFileErrorInvalidArgument;
+
+  *out = (uint32_t)value.mantissa;
+  return 0;
+}
+
+int ins_parse_stitching_offset(const char* str, size_t length, InsStitchingOffsetType* out) {
+  const char* end = str + length;
+  const char* token = str;
+  uint32_t lens_count = 0;
+  int fields_count = 0;
+  int expected_count = 1;
+
+  memset(out, 0, sizeof(*out));
+
+  while (token <= end) {
+    const char* token_end = (const char*)memchr(token, '_', (size_t)(end - token));
+    if (!token_end)
+      token_end = end;
+
+    if (fields_count >= expected_count)
+      return kInsFileErrorInvalidArgument; /* too many fields */
+
+    int result;
+    int index = fields_count - 1;
+    int tail_index = fields_count - 1 - (int)lens_count * kInsLensFieldsCount;
+
+    if (fields_count == 0) {
+      result = ins_parse_uint32(token, token_end, &lens_count);
+      if (!result && (lens_count < 1 || lens_count > kInsStitchingOffsetMaxLenses))
+        result = kInsFileErrorInvalidArgument;
+
+      out->lens_count = (int)lens_count;
+      expected_count = 1 + (int)lens_count * kInsLensFieldsCount + kInsTailFieldsCount;
+    } else if (tail_index < 0) {
+      InsStitchingLensType* lens = &out->lenses[index / kInsLensFieldsCount];
+      InsDecimalType* fields[kInsLensFieldsCount] = {
+        &lens->center_x, &lens->center_y, &lens->radius, &lens->rotation[0], &lens->rotation[1], &lens->rotation[2]
+      };
+
+      result = ins_parse_decimal(token, token_end, fields[index % kInsLensFieldsCount]);
+    } else {
+      uint32_t* fields[kInsTailFieldsCount] = { &out->width, &out->height, &out->id };
+      result = ins_parse_uint32(token, token_end, fields[tail_index]);
+    }
+
+    if (result < 0)
+      return result;
+
+    fields_count++;
+    token = token_end + 1;
+  }
+
+  return fields_count == expected_count ? 0 : kInsFileErrorInvalidArgument;
+}
+
+/* integer and fraction parts, fraction scaled to 18 digits: numerically equal decimals give equal parts */
+static void ins_decimal_split(InsDecimalType value, int64_t* int_part, int64_t* frac_part) {
+  int64_t scale = kInsPow10[value.decimals];
+  *int_part = value.mantissa / scale;
+  *frac_part = (value.mantissa % scale) * kInsPow10[kInsStitchingOffsetMaxDigits - value.decimals];
+}
+
+static int ins_decimal_compare(InsDecimalType a, InsDecimalType b) {
+  int64_t a_int, a_frac, b_int, b_frac;
+
+  ins_decimal_split(a, &a_int, &a_frac);
+  ins_decimal_split(b, &b_int, &b_frac);
+
+  /* both parts have sign of value, so lexicographic order is numeric order */
+  if (a_int != b_int)
+    return a_int < b_int ? -1 : 1;
+  if (a_frac != b_frac)
+    return a_frac < b_frac ? -1 : 1;
+  return 0;
+}
+
+static InsDecimalType ins_decimal_from_int(int64_t value) {
+  InsDecimalType result;
+  result.mantissa = value;
+  result.decimals = 0;
+  result.negative = value < 0;
+  return result;
+}
+
+static int ins_decimal_in_range(InsDecimalType value, int64_t min, int64_t max) {
+  return ins_decimal_compare(value, ins_decimal_from_int(min)) >= 0 && ins_decimal_compare(value, ins_decimal_from_int(max)) <= 0;
+}
+
+int ins_validate_stitching_offset(const InsStitchingOffsetType* offset) {
+  char formatted[kInsStitchingOffsetMaxSize];
+
+  if (offset->lens_count < 1 || offset->lens_count > kInsStitchingOffsetMaxLenses || !offset->width || !offset->height)
+    return kInsFileErrorInvalidArgument;
+
+  /* lens circles are given in sensor coordinates, which may be rotated relative to image */
+  int64_t max_size = offset->width > offset->height ? offset->width : offset->height;
+
+  for (int i = 0; i < offset->lens_count; i++) {
+    const InsStitchingLensType* lens = &offset->lenses[i];
+
+    if (!ins_decimal_in_range(lens->center_x, 0, max_size) ||
+        !ins_decimal_in_range(lens->center_y, 0, max_size) ||
+        !ins_decimal_in_range(lens->radius, 0, max_size) || !lens->radius.mantissa)
+      return kInsFileErrorInvalidArgument;
+
+    for (int j = 0; j < 3; j++) {
+      if (!ins_decimal_in_range(lens->rotation[j], -360, 360))
+        return kInsFileErrorInvalidArgument;
+    }
+  }
+
+  return ins_format_stitching_offset(offset, formatted, sizeof(formatted)) < 0 ? kInsFileErrorInvalidArgument : 0;
+}
+
+int ins_format_decimal(InsDecimalType value, char* out) {
+  char digits[kInsStitchingOffsetMaxDigits + 2];
+  uint64_t mantissa = value.mantissa < 0 ? (uint64_t)0 - (uint64_t)value.mantissa : (uint64_t)value.mantissa;
+  int count = 0;
+  int length = 0;
+
+  do {
+    digits[count++] = (char)('0' + mantissa % 10);
+    mantissa /= 10;
+  } while (mantissa);
+
+  /* at least one digit before point */
+  while (count <= value.decimals)
+    digits[count++] = '0';
+
+  if (value.negative || value.mantissa < 0)
+    out[length++] = '-';
+
+  for (int i = count - 1; i >= 0; i--) {
+    out[length++] = digits[i];
+    if (i == value.decimals && i)
+      out[length++] = '.';
+  }
+
+  return length;
+}
+
+int ins_format_stitching_offset(const InsStitchingOffsetType* offset, char* out, size_t out_size) {
+  /* longest decimal with separator is 23 characters */
+  char buffer[(1 + kInsStitchingOffsetMaxLenses * kInsLensFieldsCount + kInsTailFieldsCount) * 24];
+  int length = 0;
+
+  if (offset->lens_count < 1 || offset->lens_count > kInsStitchingOffsetMaxLenses)
+    return kInsFileErrorInvalidArgument;
+
+  length += ins_format_decimal(ins_decimal_from_int(offset->lens_count), buffer + length);
+
+  for (int i = 0; i < offset->lens_count; i++) {
+    const InsStitchingLensType* lens = &offset->lenses[i];
+    const InsDecimalType fields[kInsLensFieldsCount] = {
+      lens->center_x, lens->center_y, lens->radius, lens->rotation[0], lens->rotation[1], lens->rotation[2]
+    };
+
+    for (int j = 0; j < kInsLensFieldsCount; j++) {
+      buffer[length++] = '_';
+      length += ins_format_decimal(fields[j], buffer + length);
+    }
+  }
+
+  const uint32_t tail[kInsTailFieldsCount] = { offset->width, offset->height, offset->id };
+  for (int j = 0; j < kInsTailFieldsCount; j++) {
+    buffer[length++] = '_';
+    length += ins_format_decimal(ins_decimal_from_int(tail[j]), buffer + length);
+  }
+
+  if ((size_t)length >= out_size)
+    return kInsFileErrorInvalidArgument;
+
+  memcpy(out, buffer, length);
+  out[length] = 0;
+  return length;
+}
+
+int ins_stitching_offset_compare(const InsStitchingOffsetType* a, const InsStitchingOffsetType* b) {
+  if (a->lens_count != b->lens_count)
+    return a->lens_count < b->lens_count ? -1 : 1;
+
+  for (int i = 0; i < a->lens_count; i++) {
+    const InsStitchingLensType* lens_a = &a->lenses[i];
+    const InsStitchingLensType* lens_b = &b->lenses[i];
+    int result;
+
+    if ((result = ins_decimal_compare(lens_a->center_x, lens_b->center_x)) != 0 ||
+        (result = ins_decimal_compare(lens_a->center_y, lens_b->center_y)) != 0 ||
+        (result = ins_decimal_compare(lens_a->radius, lens_b->radius)) != 0 ||
+        (result = ins_decimal_compare(lens_a->rotation[0], lens_b->rotation[0])) != 0 ||
+        (result = ins_decimal_compare(lens_a->rotation[1], lens_b->rotation[1])) != 0 ||
+        (result = ins_decimal_compare(lens_a->rotation[2], lens_b->rotation[2])) != 0)
+      return result;
+  }
+
+  if (a->width != b->width)
+    return a->width < b->width ? -1 : 1;
+  if (a->height != b->height)
+    return a->height < b->height ? -1 : 1;
+  if (a->id != b->id)
+    return a->id < b->id ? -1 : 1;
+
+  return 0;
+}
+
+static uint64_t ins_fnv_update_decimal(uint64_t hash, InsDecimalType value) {
+  int64_t int_part, frac_part;
+
+  ins_decimal_split(value, &int_part, &frac_part);
+  return ins_fnv1a_update_u64(ins_fnv1a_update_u64(hash, (uint64_t)int_part), (uint64_t)frac_part);
+}
+
+uint64_t ins_stitching_offset_hash(const InsStitchingOffsetType* offset) {
+  uint64_t hash = ins_fnv1a_update_u64(kInsFnvOffsetBasis, (uint64_t)offset->lens_count);
+
+  for (int i = 0; i < offset->lens_count; i++) {
+    const InsStitchingLensType* lens = &offset->lenses[i];
+
+    hash = ins_fnv_update_decimal(hash, lens->center_x);
+    hash = ins_fnv_update_decimal(hash, lens->center_y);
+    hash = ins_fnv_update_decimal(hash, lens->radius);
+    for (int j = 0; j < 3; j++)
+      hash = ins_fnv_update_decimal(hash, lens->rotation[j]);
+  }
+
+  hash = ins_fnv1a_update_u64(hash, offset->width);
+  hash = ins_fnv1a_update_u64(hash, offset->height);
+  return ins_fnv1a_update_u64(hash, offset->id);
+}
+
+double ins_decimal_to_double(InsDecimalType value) {
+  /* powers of ten up to 10^18 are exact doubles, so result is correctly rounded for mantissa below 2^53 */
+  double result = (double)value.mantissa / (double)kInsPow10[value.decimals];
+  return value.negative && result == 0.0 ? -0.0 : result;
+}
@@ -0,0 +1,99 @@
+#ifndef INS_STITCHING_OFFSET_HEADER
+#define INS_STITCHING_OFFSET_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ins_file_format.h"
+
+// Stitching offset (specific header tag 0x2A) typed model.
+// String fields are separated by '_':
+// 0         lens count           (integer)
+// 1         lens 0 center x, center y, radius, rotation x, rotation y, rotation z   (6 decimals)
+// 7         lens 1 center x, center y, radius, rotation x, rotation y, rotation z   (6 decimals)
+// .........................
+// 1+6*N     image width, image height, calibration id                            (3 integers)
+//
+// Decimals are kept as integer mantissa and count of digits after point, so formatting parsed offset
+// gives exactly the same string ("0.0" and "0.000" stay different), and compare does not depend on float rounding.
+
+#define kInsStitchingOffsetMaxLenses    4
+#define kInsStitchingOffsetMaxDigits    18   /* Mantissa digits, fits int64 */
+#define kInsStitchingOffsetMaxLength    255  /* Tag data size is one byte */
+#define kInsStitchingOffsetMaxSize      (kInsStitchingOffsetMaxLength+1)
+
+/** Exact decimal number: mantissa * 10^-decimals */
+typedef struct _InsDecimalType {
+  int64_t mantissa;                          /** Value digits with sign */
+  uint8_t decimals;                          /** Digits after decimal point, 0 - integer */
+  uint8_t negative;                          /** Minus sign, kept for negative zero ("-0.000") */
+} InsDecimalType;
+
+/** Lens calibration */
+typedef struct _InsStitchingLensType {
+  InsDecimalType center_x;                   /** Lens circle center, pixels */
+  InsDecimalType center_y;                   /** Lens circle center, pixels */
+  InsDecimalType radius;                     /** Lens circle radius, pixels */
+  InsDecimalType rotation[3];                /** Lens rotation angles, degrees */
+} InsStitchingLensType;
+
+/** Parsed stitching offset */
+typedef struct _InsStitchingOffsetType {
+  int lens_count;                            /** Lenses count, 1..kInsStitchingOffsetMaxLenses */
+  InsStitchingLensType lenses[kInsStitchingOffsetMaxLenses];  /** Lens calibrations */
+  uint32_t width;                            /** Image width */
+  uint32_t height;                           /** Image height */
+  uint32_t id;                               /** Calibration id, last field */
+} InsStitchingOffsetType;
+
+/**
+ * \brief    Parse stitching offset string. Only syntax is checked: field count and plain decimal numbers
+ *           (no exponent, no '+', no leading zeros), see ins_validate_stitching_offset for value ranges
+ * \param    str      [in]  Offset string, not zero-terminated (tag data can be used directly)
+ * \param    length   [in]  String length
+ * \param    out      [out] Parsed offset
+ * \return   0 - success, kInsFileErrorInvalidArgument - wrong format
+ */
+int ins_parse_stitching_offset(const char* str, size_t length, InsStitchingOffsetType* out);
+
+/**
+ * \brief    Check offset values are in valid ranges: positive image size, lens circles inside image bounds,
+ *           rotation angles within +-360 degrees, formatted string fits the tag
+ * \param    offset   [in]  Parsed offset
+ * \return   0 - success, kInsFileErrorInvalidArgument - value out of range
+ */
+int ins_validate_stitching_offset(const InsStitchingOffsetType* offset);
+
+/**
+ * \brief    Format decimal number
+ * \param    value     [in]  Decimal
+ * \param    out       [out] Output buffer, at least 22 bytes, result is not zero-terminated
+ * \return   Written characters count
+ */
+int ins_format_decimal(InsDecimalType value, char* out);
+
+/**
+ * \brief    Format stitching offset, result equals string the offset was parsed from
+ * \param    offset     [in]  Offset
+ * \param    out        [out] Output buffer, result is zero-terminated
+ * \param    out_size   [in]  Output buffer size, kInsStitchingOffsetMaxSize is enough for valid offsets
+ * \return   String length - success, kInsFileErrorInvalidArgument - buffer too small
+ */
+int ins_format_stitching_offset(const InsStitchingOffsetType* offset, char* out, size_t out_size);
+
+/**
+ * \brief    Compare offsets numerically: "0.0" equals "0.000", lens count is compared first, then fields in order
+ * \return   Negative, zero or positive like strcmp
+ */
+int ins_stitching_offset_compare(const InsStitchingOffsetType* a, const InsStitchingOffsetType* b);
+
+/**
+ * \brief    Hash of offset value for grouping, numerically equal offsets have equal hash
+ * \param    offset   [in]  Offset
+ * \return   64-bit FNV-1a hash
+ */
+uint64_t ins_stitching_offset_hash(const InsStitchingOffsetType* offset);
+
+/** Convert decimal to nearest double */
+double ins_decimal_to_double(InsDecimalType value);
+
+#endif  // INS_STITCHING_OFFSET_HEADER
@@ -0,0 +1,228 @@
+#include <string.h>
+#include "ins_tee.h"
+#include "ins_file.h"
+
+typedef struct _InsTeeContextType InsTeeContextType;
+
+/** Writer of one destination */
+typedef struct _InsTeeWriterType {
+  InsTeeContextType* tee;
+  FILE* file;
+  InsThreadType thread;
+  int started;                               /** Thread is running, must be joined */
+  int active;                                /** Writer takes buffers, reader waits for it */
+  int64_t consumed;                          /** Blocks written, guarded by tee mutex */
+  InsTeeResultType result;
+} InsTeeWriterType;
+
+/** Shared ring state, counters and flags are guarded by mutex */
+struct _InsTeeContextType {
+  InsMutexType mutex;
+  InsConditionType condition;                /** Signaled when block is produced, consumed or writer stops */
+  uint8_t* buffers[kInsTeeBuffersCount];
+  size_t sizes[kInsTeeBuffersCount];
+  int64_t produced;                          /** Blocks read */
+  int finished;                              /** Reader will not produce more blocks */
+  int64_t start_time;
+  InsTeeWriterType writers[kInsTeeMaxDestinations];
+  int writers_count;
+};
+
+/** Writer thread: write blocks in order until reader finishes, then flush */
+static int ins_tee_writer_proc(void* ctx) {
+  InsTeeWriterType* writer = (InsTeeWriterType*)ctx;
+  InsTeeContextType* tee = writer->tee;
+  int error = 0;
+
+  ins_mutex_lock(&tee->mutex);
+
+  for (;;) {
+    while (writer->consumed == tee->produced && !tee->finished)
+      ins_condition_wait(&tee->condition, &tee->mutex);
+
+    if (writer->consumed == tee->produced)
+      break;
+
+    int slot = (int)(writer->consumed % kInsTeeBuffersCount);
+    ins_mutex_unlock(&tee->mutex);
+
+    /* buffer is not reused until this writer increments consumed counter */
+    error = fwrite(tee->buffers[slot], 1, tee->sizes[slot], writer->file) != tee->sizes[slot];
+
+    ins_mutex_lock(&tee->mutex);
+
+    if (error)
+      break;
+
+    writer->result.bytes += tee->sizes[slot];
+    writer->consumed++;
+    ins_condition_broadcast(&tee->condition);
+  }
+
+  /* failed destination does not hold reader anymore */
+  writer->active = 0;
+  ins_condition_broadcast(&tee->condition);
+  ins_mutex_unlock(&tee->mutex);
+
+  if (!error && fflush(writer->file))
+    error = 1;
+
+  writer->result.error = error ? kInsFileErrorIo : 0;
+  writer->result.elapsed_us = ins_monotonic_time_us() - tee->start_time;
+  return 0;
+}
+
+/** Single destination copy, keeps kernel copy path */
+static int ins_tee_copy_single(FILE* file_in, int64_t offset, int64_t length, FILE* file_out,
+  const InsAllocatorType* allocator, InsTeeResultType* out_result) {
+
+  int64_t start_time = ins_monotonic_time_us();
+  int result = ins_copy_file_region(file_in, offset, length, file_out, allocator);
+
+  if (!result && fflush(file_out))
+    result = kInsFileErrorIo;
+
+  out_result->error = result;
+  out_result->bytes = result ? 0 : length;
+  out_result->elapsed_us = ins_monotonic_time_us() - start_time;
+
+  return result < 0 ? result : 1;
+}
+
+int ins_tee_copy_region(
+  FILE* file_in,
+  int64_t offset,
+  int64_t length,
+  FILE* const* files_out,
+  int files_count,
+  const InsAllocatorType* allocator,
+  InsDigestType* digest,
+  InsTeeResultType* out_results) {
+
+  InsTeeContextType tee;
+  int result = 0;
+
+  if (files_count < 1 || files_count > kInsTeeMaxDestinations)
+    return kInsFileErrorInvalidArgument;
+
+  memset(out_results, 0, sizeof(*out_results) * files_count);
+
+  /* kernel copy does not pass data through user space, digest needs buffers */
+  if (files_count == 1 && !digest)
+    return ins_tee_copy_single(file_in, offset, length, files_out[0], allocator, out_results);
+
+  memset(&tee, 0, sizeof(tee));
+
+  for (int i = 0; i < kInsTeeBuffersCount && !result; i++) {
+    tee.buffers[i] = (uint8_t*)ins_allocate(allocator, kInsTeeBufferSize);
+    if (!tee.buffers[i])
+      result = kInsFileErrorNoMemory;
+  }
+
+  if (!result && ins_fseek64(file_in, offset, SEEK_SET))
+    result = kInsFileErrorIo;
+
+  if (result < 0) {
+    for (int i = 0; i < kInsTeeBuffersCount; i++)
+      if (tee.buffers[i])
+        ins_release(allocator, tee.buffers[i]);
+    return result;
+  }
+
+  ins_mutex_init(&tee.mutex);
+  ins_condition_init(&tee.condition);
+  tee.start_time = ins_monotonic_time_us();
+  tee.writers_count = files_count;
+
+  for (int i = 0; i < files_count; i++) {
+    InsTeeWriterType* writer = &tee.writers[i];
+
+    writer->tee = &tee;
+    writer->file = files_out[i];
+    writer->active = 1;
+
+    if (ins_thread_create(&writer->thread, ins_tee_writer_proc, writer) == 0) {
+      writer->started = 1;
+    } else {
+      writer->active = 0;
+      writer->result.error = kInsFileErrorNoMemory;
+    }
+  }
+
+  int64_t left = length;
+
+  while (left > 0) {
+    int slot = (int)(tee.produced % kInsTeeBuffersCount);
+    int active_count = 0;
+
+    /* slot is free when every active writer has written block which used it before */
+    ins_mutex_lock(&tee.mutex);
+
+    for (;;) {
+      int busy = 0;
+      active_count = 0;
+
+      for (int i = 0; i < tee.writers_count; i++) {
+        if (!tee.writers[i].active)
+          continue;
+        active_count++;
+        busy |= tee.produced - tee.writers[i].consumed >= kInsTeeBuffersCount;
+      }
+
+      if (!busy)
+        break;
+      ins_condition_wait(&tee.condition, &tee.mutex);
+    }
+
+    ins_mutex_unlock(&tee.mutex);
+
+    if (!active_count)
+      break;
+
+    size_t size = left < kInsTeeBufferSize ? (size_t)left : kInsTeeBufferSize;
+
+    if (fread(tee.buffers[slot], 1, size, file_in) != size) {
+      result = kInsFileErrorIo;
+      break;
+    }
+
+    /* writers of previous blocks run meanwhile */
+    if (digest)
+      ins_digest_update(digest, tee.buffers[slot], size);
+
+    ins_mutex_lock(&tee.mutex);
+    tee.sizes[slot] = size;
+    tee.produced++;
+    ins_condition_broadcast(&tee.condition);
+    ins_mutex_unlock(&tee.mutex);
+
+    left -= size;
+  }
+
+  ins_mutex_lock(&tee.mutex);
+  tee.finished = 1;
+  ins_condition_broadcast(&tee.condition);
+  ins_mutex_unlock(&tee.mutex);
+
+  int written_count = 0;
+
+  for (int i = 0; i < files_count; i++) {
+    InsTeeWriterType* writer = &tee.writers[i];
+
+    if (writer->started)
+      ins_thread_join(&writer->thread);
+
+    out_results[i] = writer->result;
+    if (result < 0 && !out_results[i].error)
+      out_results[i].error = result;
+    written_count += !out_results[i].error;
+  }
+
+  ins_condition_destroy(&tee.condition);
+  ins_mutex_destroy(&tee.mutex);
+
+  for (int i = 0; i < kInsTeeBuffersCount; i++)
+    ins_release(allocator, tee.buffers[i]);
+
+  return result < 0 ? result : written_count;
+}
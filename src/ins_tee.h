@@ -0,0 +1,51 @@
+#ifndef INS_TEE_HEADER
+#define INS_TEE_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ins_platform.h"
+#include "ins_digest.h"
+
+// Copy of one file region to several output files from a single read. Reader fills ring of
+// kInsTeeBuffersCount buffers, each destination has its own writer thread which writes all buffers in
+// order. Buffer is reused when every writer has written it, so a slow destination may lag behind a fast one
+// by the whole ring before reader waits for it. Destination with write error is dropped, others continue.
+// Reader may add each block to a digest, so copied data is hashed without reading it again.
+
+#define kInsTeeMaxDestinations  8
+#define kInsTeeBuffersCount     8                         /* Ring size, allowed lag of slow destination */
+#define kInsTeeBufferSize       kInsCopyRegionBufferSize  /* Size of one read */
+
+/** Result of one destination */
+typedef struct _InsTeeResultType {
+  int error;                                 /** 0 - success, kInsFileErrorIo - write error, kInsFileErrorNoMemory -
+                                                 writer thread not started */
+  int64_t bytes;                             /** Bytes written */
+  int64_t elapsed_us;                        /** Time from copy start to last flushed write of destination */
+} InsTeeResultType;
+
+/**
+ * \brief    Copy file region to current position of all output files, input region is read once. One destination
+ *           is copied by ins_copy_file_region (kernel copy where available) unless digest is requested
+ * \param    file_in       [in]  Input file
+ * \param    offset        [in]  Region offset in input file
+ * \param    length        [in]  Region length
+ * \param    files_out     [in]  Output files
+ * \param    files_count   [in]  Output files count, 1..kInsTeeMaxDestinations
+ * \param    allocator     [in]  Allocator of ring buffers
+ * \param    digest        [in]  Digest which gets region data, NULL - no digest
+ * \param    out_results   [out] Result of each destination, files_count items
+ * \return   Number of destinations written successfully, kInsFileErrorIo - read error (no destination is complete),
+ *           kInsFileErrorNoMemory, kInsFileErrorInvalidArgument - wrong files count
+ */
+int ins_tee_copy_region(
+  FILE* file_in,
+  int64_t offset,
+  int64_t length,
+  FILE* const* files_out,
+  int files_count,
+  const InsAllocatorType* allocator,
+  InsDigestType* digest,
+  InsTeeResultType* out_results);
+
+#endif  // INS_TEE_HEADER
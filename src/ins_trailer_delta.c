@@ -0,0 +1,394 @@
+#include <string.h>
+#include "ins_trailer_delta.h"
+#include "ins_file.h"
+
+int ins_media_fingerprint(FILE* file, int64_t media_size, int algorithm, const InsAllocatorType* io_allocator,
+  InsDigestType* out_digest) {
+
+  ins_digest_init(out_digest, algorithm);
+
+  if (!ins_digest_name(algorithm) || media_size < 0)
+    return kInsFileErrorInvalidArgument;
+
+  uint8_t* buffer = (uint8_t*)ins_allocate(io_allocator, kInsCopyRegionBufferSize);
+  if (!buffer)
+    return kInsFileErrorNoMemory;
+
+  int result = ins_fseek64(file, 0, SEEK_SET) ? kInsFileErrorIo : 0;
+
+  for (int64_t left = media_size; left > 0 && !result; ) {
+    size_t size = left < kInsCopyRegionBufferSize ? (size_t)left : kInsCopyRegionBufferSize;
+
+    if (fread(buffer, 1, size, file) != size) {
+      result = kInsFileErrorIo;
+      break;
+    }
+
+    ins_digest_update(out_digest, buffer, size);
+    left -= size;
+  }
+
+  ins_release(io_allocator, buffer);
+  return result;
+}
+
+/** Loaded delta, entries, stored data and trailer end point into one buffer */
+typedef struct _InsTrailerDeltaType {
+  InsTrailerDeltaHeaderType header;
+  const InsTrailerDeltaEntryType* entries;
+  const uint8_t* stored_data;
+  const uint8_t* trailer_end;                /** kInsFileMinHeaderLength bytes */
+  uint8_t* buffer;
+} InsTrailerDeltaType;
+
+/** Entries rewritten by trailer edits are stored in delta, record streams and preview are kept */
+static int ins_delta_entry_stored(uint16_t type) {
+  return !(ins_get_trailer_entry_desc(type)->flags & kInsEntryLoadFlagStreamable);
+}
+
+/** Add entry header and data to kept entries digest, header has the same bytes as in trailer */
+static void ins_delta_digest_entry(InsDigestType* digest, uint16_t type, const uint8_t* data, uint32_t length) {
+  InsFileTrailerEntryHeaderType entry_hdr;
+
+  entry_hdr.type = type;
+  entry_hdr.length = length;
+
+  ins_digest_update(digest, &entry_hdr, sizeof(entry_hdr));
+  ins_digest_update(digest, data, length);
+}
+
+/** Collect entry views in trailer order (from trailer start), entries must fill the whole trailer */
+static int ins_delta_collect_entries(const InsTrailerViewType* view, const InsAllocatorType* allocator,
+  InsEntryViewType** out_entries, uint32_t* out_count) {
+
+  InsEntryViewType entry;
+  uint32_t position = ins_trailer_view_begin(view);
+  uint32_t count = 0;
+  int result;
+
+  while ((result = ins_trailer_view_next_entry(view, &position, &entry)) > 0)
+    count++;
+
+  if (result < 0)
+    return kInsFileErrorCorrupted;
+
+  InsEntryViewType* entries = (InsEntryViewType*)ins_allocate(allocator, sizeof(InsEntryViewType) * (count ? count : 1));
+  if (!entries)
+    return kInsFileErrorNoMemory;
+
+  /* view enumerates entries from trailer end */
+  position = ins_trailer_view_begin(view);
+  for (uint32_t i = count; i > 0 && ins_trailer_view_next_entry(view, &position, &entry) > 0; i--)
+    entries[i - 1] = entry;
+
+  *out_entries = entries;
+  *out_count = count;
+  return 0;
+}
+
+int ins_write_trailer_delta(FILE* file, int algorithm, const InsAllocatorType* allocator, FILE* delta_out) {
+  InsTrailerDeltaHeaderType header;
+  InsFileTrailerHeaderType trailer_info;
+  InsTrailerViewType view;
+  InsDigestType digest;
+  InsDigestType kept_digest;
+  InsEntryViewType* entries = NULL;
+  uint32_t entries_count = 0;
+  uint8_t* trailer_data;
+
+  int result = ins_read_allocate_trailer(file, allocator, &trailer_data, &trailer_info);
+  if (result < 0)
+    return result;
+
+  int64_t media_size = ins_get_file_size(file) - trailer_info.trailer_len;
+
+  if (ins_trailer_view_init(&view, trailer_data, trailer_info.trailer_len) < 0)
+    result = kInsFileErrorCorrupted;
+
+  if (!result)
+    result = ins_delta_collect_entries(&view, allocator, &entries, &entries_count);
+
+  if (!result)
+    result = ins_media_fingerprint(file, media_size, algorithm, allocator, &digest);
+
+  if (!result) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kInsTrailerDeltaMagic, kInsTrailerDeltaMagicLength);
+    header.version = kInsTrailerDeltaVersion;
+    header.digest_algorithm = (uint32_t)algorithm;
+    header.media_size = media_size;
+    ins_digest_final(&digest, header.media_digest);
+    header.trailer_len = trailer_info.trailer_len;
+    header.entries_count = entries_count;
+
+    ins_digest_init(&kept_digest, algorithm);
+
+    for (uint32_t i = 0; i < entries_count; i++) {
+      if (ins_delta_entry_stored(entries[i].type))
+        header.stored_size += entries[i].data.size;
+      else
+        ins_delta_digest_entry(&kept_digest, entries[i].type, entries[i].data.data, entries[i].data.size);
+    }
+
+    ins_digest_final(&kept_digest, header.kept_digest);
+
+    if (fwrite(&header, 1, sizeof(header), delta_out) != sizeof(header))
+      result = kInsFileErrorIo;
+  }
+
+  for (uint32_t i = 0; i < entries_count && !result; i++) {
+    InsTrailerDeltaEntryType delta_entry;
+
+    delta_entry.type = entries[i].type;
+    delta_entry.flags = ins_delta_entry_stored(entries[i].type) ? kInsTrailerDeltaEntryStored : kInsTrailerDeltaEntryKept;
+    delta_entry.length = entries[i].data.size;
+
+    if (fwrite(&delta_entry, 1, sizeof(delta_entry), delta_out) != sizeof(delta_entry))
+      result = kInsFileErrorIo;
+  }
+
+  for (uint32_t i = 0; i < entries_count && !result; i++) {
+    if (ins_delta_entry_stored(entries[i].type) &&
+        fwrite(entries[i].data.data, 1, entries[i].data.size, delta_out) != entries[i].data.size)
+      result = kInsFileErrorIo;
+  }
+
+  if (!result && fwrite(view.bytes.data + view.bytes.size - kInsFileMinHeaderLength, 1, kInsFileMinHeaderLength,
+      delta_out) != kInsFileMinHeaderLength)
+    result = kInsFileErrorIo;
+
+  ins_release(allocator, entries);
+  ins_free_trailer_buffer(allocator, trailer_data);
+  return result;
+}
+
+/** Read and validate delta: entries must build trailer of header length ending with trailer end */
+static int ins_read_trailer_delta(FILE* delta, const InsAllocatorType* allocator, InsTrailerDeltaType* out_delta) {
+  InsTrailerDeltaHeaderType* header = &out_delta->header;
+  InsFileTrailerHeaderType end_info;
+
+  if (fread(header, 1, sizeof(*header), delta) != sizeof(*header) ||
+      memcmp(header->magic, kInsTrailerDeltaMagic, kInsTrailerDeltaMagicLength) ||
+      header->version != kInsTrailerDeltaVersion || !ins_digest_name((int)header->digest_algorithm) ||
+      header->media_size < 0 || header->trailer_len < kInsFileMinHeaderLength ||
+      header->entries_count > (header->trailer_len - kInsFileMinHeaderLength) / sizeof(InsFileTrailerEntryHeaderType) ||
+      header->stored_size > header->trailer_len)
+    return kInsFileErrorCorrupted;
+
+  size_t entries_size = (size_t)header->entries_count * sizeof(InsTrailerDeltaEntryType);
+  size_t size = entries_size + header->stored_size + kInsFileMinHeaderLength;
+
+  uint8_t* buffer = (uint8_t*)ins_allocate(allocator, size);
+  if (!buffer)
+    return kInsFileErrorNoMemory;
+
+  int result = fread(buffer, 1, size, delta) == size ? 0 : kInsFileErrorCorrupted;
+
+  out_delta->buffer = buffer;
+  out_delta->entries = (const InsTrailerDeltaEntryType*)buffer;
+  out_delta->stored_data = buffer + entries_size;
+  out_delta->trailer_end = buffer + entries_size + header->stored_size;
+
+  uint64_t trailer_len = kInsFileMinHeaderLength;
+  uint64_t stored_size = 0;
+
+  for (uint32_t i = 0; i < header->entries_count && !result; i++) {
+    const InsTrailerDeltaEntryType* entry = &out_delta->entries[i];
+
+    if (entry->flags != kInsTrailerDeltaEntryKept && entry->flags != kInsTrailerDeltaEntryStored)
+      result = kInsFileErrorCorrupted;
+
+    trailer_len += sizeof(InsFileTrailerEntryHeaderType) + (uint64_t)entry->length;
+    if (entry->flags == kInsTrailerDeltaEntryStored)
+      stored_size += entry->length;
+  }
+
+  if (!result && (trailer_len != header->trailer_len || stored_size != header->stored_size))
+    result = kInsFileErrorCorrupted;
+
+  /* header is not aligned in buffer */
+  if (!result) {
+    memcpy(&end_info, out_delta->trailer_end + kInsFileMinHeaderLength - kInsFileSignatureLength - sizeof(end_info),
+      sizeof(end_info));
+
+    if (memcmp(out_delta->trailer_end + kInsFileMinHeaderLength - kInsFileSignatureLength, kInsFileSignature,
+          kInsFileSignatureLength) || end_info.trailer_len != header->trailer_len)
+      result = kInsFileErrorCorrupted;
+  }
+
+  if (result < 0) {
+    ins_release(allocator, buffer);
+    out_delta->buffer = NULL;
+  }
+
+  return result;
+}
+
+/** Find data of each new trailer entry: stored in delta or n-th target entry of its type, check kept entries digest */
+static int ins_delta_match_entries(const InsTrailerDeltaType* delta, const InsEntryViewType* target_entries,
+  uint32_t target_count, const uint8_t** out_sources) {
+
+  const InsTrailerDeltaHeaderType* header = &delta->header;
+  InsDigestType digest;
+  uint8_t digest_value[kInsDigestMaxSize];
+  const uint8_t* stored = delta->stored_data;
+
+  ins_digest_init(&digest, (int)header->digest_algorithm);
+
+  for (uint32_t i = 0; i < header->entries_count; i++) {
+    const InsTrailerDeltaEntryType* entry = &delta->entries[i];
+
+    if (entry->flags == kInsTrailerDeltaEntryStored) {
+      out_sources[i] = stored;
+      stored += entry->length;
+      continue;
+    }
+
+    /* kept entry is matched by order among entries of the same type */
+    uint32_t same_type_index = 0;
+    for (uint32_t j = 0; j < i; j++)
+      same_type_index += delta->entries[j].type == entry->type && delta->entries[j].flags == kInsTrailerDeltaEntryKept;
+
+    const InsEntryViewType* target_entry = NULL;
+    for (uint32_t j = 0; j < target_count && !target_entry; j++) {
+      if (target_entries[j].type == entry->type && !same_type_index--)
+        target_entry = &target_entries[j];
+    }
+
+    if (!target_entry || target_entry->data.size != entry->length)
+      return kInsFileErrorNotFound;
+
+    out_sources[i] = target_entry->data.data;
+    ins_delta_digest_entry(&digest, entry->type, target_entry->data.data, entry->length);
+  }
+
+  memset(digest_value, 0, sizeof(digest_value));
+  ins_digest_final(&digest, digest_value);
+
+  return memcmp(digest_value, header->kept_digest, kInsDigestMaxSize) ? kInsFileErrorNotFound : 0;
+}
+
+/** Check new trailer has the same bytes as old one */
+static int ins_delta_trailer_unchanged(const InsTrailerDeltaType* delta, const uint8_t* const* sources,
+  const InsTrailerViewType* old_view) {
+
+  const uint8_t* old_data = old_view->bytes.data;
+  uint32_t position = 0;
+
+  if (old_view->bytes.size != delta->header.trailer_len)
+    return 0;
+
+  for (uint32_t i = 0; i < delta->header.entries_count; i++) {
+    const InsTrailerDeltaEntryType* entry = &delta->entries[i];
+    InsFileTrailerEntryHeaderType entry_hdr;
+
+    entry_hdr.type = entry->type;
+    entry_hdr.length = entry->length;
+
+    if (memcmp(old_data + position, sources[i], entry->length) ||
+        memcmp(old_data + position + entry->length, &entry_hdr, sizeof(entry_hdr)))
+      return 0;
+
+    position += entry->length + sizeof(entry_hdr);
+  }
+
+  return !memcmp(old_data + position, delta->trailer_end, kInsFileMinHeaderLength);
+}
+
+/** Write new trailer at current file position, kept entries data is in old trailer buffer */
+static int ins_delta_write_trailer(const InsTrailerDeltaType* delta, const uint8_t* const* sources, FILE* target) {
+  for (uint32_t i = 0; i < delta->header.entries_count; i++) {
+    const InsTrailerDeltaEntryType* entry = &delta->entries[i];
+
+    if (fwrite(sources[i], 1, entry->length, target) != entry->length ||
+        ins_write_trailer_entry_header(target, entry->type, entry->length) < 0)
+      return kInsFileErrorIo;
+  }
+
+  if (fwrite(delta->trailer_end, 1, kInsFileMinHeaderLength, target) != kInsFileMinHeaderLength)
+    return kInsFileErrorIo;
+
+  return fflush(target) ? kInsFileErrorIo : 0;
+}
+
+int ins_apply_trailer_delta(FILE* delta, FILE* target, const InsAllocatorType* allocator, InsTrailerDeltaResultType* out_result) {
+  InsTrailerDeltaType delta_data;
+  InsFileTrailerHeaderType old_info;
+  InsTrailerViewType old_view;
+  InsDigestType digest;
+  uint8_t digest_value[kInsDigestMaxSize];
+  InsEntryViewType* target_entries = NULL;
+  uint32_t target_count = 0;
+  const uint8_t** sources = NULL;
+  uint8_t* old_trailer;
+
+  memset(out_result, 0, sizeof(*out_result));
+
+  int result = ins_read_trailer_delta(delta, allocator, &delta_data);
+  if (result < 0)
+    return result;
+
+  result = ins_read_allocate_trailer(target, allocator, &old_trailer, &old_info);
+  if (result < 0) {
+    ins_release(allocator, delta_data.buffer);
+    return result;
+  }
+
+  int64_t media_size = ins_get_file_size(target) - old_info.trailer_len;
+
+  out_result->old_trailer_len = old_info.trailer_len;
+  out_result->new_trailer_len = delta_data.header.trailer_len;
+
+  if (ins_trailer_view_init(&old_view, old_trailer, old_info.trailer_len) < 0)
+    result = kInsFileErrorCorrupted;
+
+  if (!result)
+    result = ins_delta_collect_entries(&old_view, allocator, &target_entries, &target_count);
+
+  if (!result) {
+    sources = (const uint8_t**)ins_allocate(allocator, sizeof(const uint8_t*) * (delta_data.header.entries_count + 1));
+    if (!sources)
+      result = kInsFileErrorNoMemory;
+  }
+
+  /* size and kept entries are compared first, so file of other recording is rejected without reading its media */
+  if (!result && media_size != delta_data.header.media_size)
+    result = kInsFileErrorNotFound;
+
+  if (!result)
+    result = ins_delta_match_entries(&delta_data, target_entries, target_count, sources);
+
+  if (!result)
+    result = ins_media_fingerprint(target, media_size, (int)delta_data.header.digest_algorithm, allocator, &digest);
+
+  if (!result) {
+    memset(digest_value, 0, sizeof(digest_value));
+    ins_digest_final(&digest, digest_value);
+
+    if (memcmp(digest_value, delta_data.header.media_digest, kInsDigestMaxSize))
+      result = kInsFileErrorNotFound;
+  }
+
+  if (!result)
+    out_result->unchanged = ins_delta_trailer_unchanged(&delta_data, sources, &old_view);
+
+  /* same size trailer is overwritten, shorter one leaves old tail which is cut off. Kept entries are written
+     from old trailer buffer, so overwriting their file bytes is safe */
+  if (!result && !out_result->unchanged) {
+    result = ins_fseek64(target, media_size, SEEK_SET) ? kInsFileErrorIo : 0;
+
+    if (!result)
+      result = ins_delta_write_trailer(&delta_data, sources, target);
+
+    if (!result && delta_data.header.trailer_len < old_info.trailer_len) {
+      result = ins_truncate_file(target, media_size + delta_data.header.trailer_len);
+      out_result->truncated = !result;
+    }
+  }
+
+  ins_release(allocator, (void*)sources);
+  ins_release(allocator, target_entries);
+  ins_free_trailer_buffer(allocator, old_trailer);
+  ins_release(allocator, delta_data.buffer);
+  return result;
+}
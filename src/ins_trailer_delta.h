@@ -0,0 +1,105 @@
+#ifndef INS_TRAILER_DELTA_HEADER
+#define INS_TRAILER_DELTA_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ins_allocator.h"
+#include "ins_digest.h"
+
+// Trailer delta: entries of changed file trailer which trailer edits rewrite, plus fingerprints of its media
+// region and of trailer entries which are not stored, so a copy of the file at other place can be updated by
+// patching its trailer instead of transferring the whole file. Stitching offset change rewrites 0x101 entry
+// only, record streams (0x300, 0x400, 0x600, 0x700) and preview image are large and kept as is, so delta
+// stores entries without kInsEntryLoadFlagStreamable and takes the others from target trailer.
+//
+// Delta is applied only when media region of target has the same size and digest and target has every kept
+// entry (n-th entry of type in trailer order) with the same length and combined digest. New trailer is
+// rebuilt in place from stored and kept entries: it is written at media region end, file is truncated when
+// new trailer is shorter than old one. Interrupted patch leaves file with broken trailer, media data is never
+// changed.
+//
+// Delta file structure (little endian)
+// 0         InsTrailerDeltaHeaderType   (104 bytes)       magic "INSTDL01", media and kept entries digests
+// 104       InsTrailerDeltaEntryType    (8 bytes each)    all entries of new trailer, from trailer start
+// XXX       stored entries data         (stored_size)     data of stored entries in the same order
+// YYY       trailer end                 (72 bytes)        padding, trailer header and signature of new trailer
+
+#define kInsTrailerDeltaMagic        "INSTDL01"
+#define kInsTrailerDeltaMagicLength  8
+#define kInsTrailerDeltaVersion      2
+
+/** Delta entry flags */
+enum InsTrailerDeltaEntryFlags {
+  kInsTrailerDeltaEntryKept                    = 0,  /** Entry data is taken from target trailer */
+  kInsTrailerDeltaEntryStored                  = 1   /** Entry data is stored in delta */
+};
+
+#pragma pack(push,1)
+
+/** Delta file header */
+typedef struct _InsTrailerDeltaHeaderType {
+  char magic[kInsTrailerDeltaMagicLength];   /** kInsTrailerDeltaMagic, not zero-terminated */
+  uint32_t version;                          /** kInsTrailerDeltaVersion */
+  uint32_t digest_algorithm;                 /** InsDigestAlgorithm of media and kept entries digests */
+  int64_t media_size;                        /** Key: media region size */
+  uint8_t media_digest[kInsDigestMaxSize];   /** Key: media region digest, unused bytes are zero */
+  uint8_t kept_digest[kInsDigestMaxSize];    /** Key: digest of kept entries headers and data in trailer order */
+  uint32_t trailer_len;                      /** New trailer length */
+  uint32_t entries_count;                    /** InsTrailerDeltaEntryType items following header */
+  uint32_t stored_size;                      /** Stored entries data bytes */
+  uint32_t reserved;                         /** Zero */
+} InsTrailerDeltaHeaderType;
+
+/** Entry of new trailer */
+typedef struct _InsTrailerDeltaEntryType {
+  uint16_t type;                             /** Trailer entry type */
+  uint16_t flags;                            /** Value from enum InsTrailerDeltaEntryFlags */
+  uint32_t length;                           /** Entry data length */
+} InsTrailerDeltaEntryType;
+
+#pragma pack(pop)
+
+/** Result of delta apply */
+typedef struct _InsTrailerDeltaResultType {
+  uint32_t old_trailer_len;                  /** Target trailer length before patch */
+  uint32_t new_trailer_len;                  /** Target trailer length after patch */
+  int unchanged;                             /** Target already had delta trailer, nothing was written */
+  int truncated;                             /** New trailer is shorter, file was truncated */
+} InsTrailerDeltaResultType;
+
+/**
+ * \brief    Compute digest of media region (file data before trailer)
+ * \param    file           [in]  Input file
+ * \param    media_size     [in]  Media region size
+ * \param    algorithm      [in]  InsDigestAlgorithm
+ * \param    io_allocator   [in]  Allocator of read buffer (kInsCopyRegionBufferSize bytes)
+ * \param    out_digest     [out] Digest of media region
+ * \return   0 - success, kInsFileErrorIo, kInsFileErrorNoMemory
+ */
+int ins_media_fingerprint(FILE* file, int64_t media_size, int algorithm, const InsAllocatorType* io_allocator,
+  InsDigestType* out_digest);
+
+/**
+ * \brief    Write delta of file: stored trailer entries and fingerprints of media region and kept entries
+ * \param    file           [in]  Changed file
+ * \param    algorithm      [in]  InsDigestAlgorithm of fingerprints
+ * \param    allocator      [in]  Allocator of trailer and read buffers
+ * \param    delta_out      [in]  Output delta file
+ * \return   0 - success, kInsFileErrorNotInsFile, kInsFileErrorCorrupted, kInsFileErrorIo, kInsFileErrorNoMemory
+ */
+int ins_write_trailer_delta(FILE* file, int algorithm, const InsAllocatorType* allocator, FILE* delta_out);
+
+/**
+ * \brief    Rebuild trailer of target file from delta and target kept entries, when target media region and
+ *           kept entries match delta fingerprints
+ * \param    delta          [in]  Delta file written by ins_write_trailer_delta
+ * \param    target         [in]  Target file opened for update ("rb+")
+ * \param    allocator      [in]  Allocator of trailer and read buffers
+ * \param    out_result     [out] Patch result
+ * \return   0 - success, kInsFileErrorNotFound - target media region or kept entries differ,
+ *           kInsFileErrorCorrupted - wrong delta or target trailer, kInsFileErrorNotInsFile - target has no trailer,
+ *           kInsFileErrorIo, kInsFileErrorNoMemory
+ */
+int ins_apply_trailer_delta(FILE* delta, FILE* target, const InsAllocatorType* allocator, InsTrailerDeltaResultType* out_result);
+
+#endif  // INS_TRAILER_DELTA_HEADER
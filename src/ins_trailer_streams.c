@@ -0,0 +1,166 @@
+#include <string.h>
+#include <math.h>
+#include "ins_trailer_streams.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INS_STREAMS_USE_SSE2
+#endif
+
+int ins_append_mask_indices(uint32_t mask, int32_t first_index, const InsAllocatorType* allocator, InsInt32Vector* out_indices) {
+  int count = 0;
+
+  for (uint32_t bits = mask; bits; bits &= bits - 1)
+    count++;
+
+  if (ins_vector_reserve(int32_t, allocator, out_indices, count) < 0)
+    return kInsFileErrorNoMemory;
+
+  for (int32_t index = first_index; mask; mask >>= 1, index++)
+    if (mask & 1)
+      out_indices->a[out_indices->n++] = index;
+
+  return count;
+}
+
+void ins_exposure_stream_init(InsExposureStreamType* stream, const InsAllocatorType* allocator) {
+  vector_init(&stream->timecodes);
+  vector_init(&stream->exposures);
+  stream->allocator = allocator;
+}
+
+void ins_exposure_stream_destroy(InsExposureStreamType* stream) {
+  ins_vector_destroy(stream->allocator, &stream->timecodes);
+  ins_vector_destroy(stream->allocator, &stream->exposures);
+  ins_exposure_stream_init(stream, stream->allocator);
+}
+
+void ins_frame_exposure_table_init(InsFrameExposureTableType* table, const InsAllocatorType* allocator) {
+  vector_init(&table->timestamps);
+  vector_init(&table->exposures);
+  table->allocator = allocator;
+}
+
+void ins_frame_exposure_table_destroy(InsFrameExposureTableType* table) {
+  ins_vector_destroy(table->allocator, &table->timestamps);
+  ins_vector_destroy(table->allocator, &table->exposures);
+  ins_frame_exposure_table_init(table, table->allocator);
+}
+
+int ins_decode_exposure_entry(const uint8_t* data, uint32_t size, InsExposureStreamType* out_stream) {
+  if (size % kInsExposureRecordSize)
+    return kInsFileErrorCorrupted; /* entry size is not multiple of record size */
+
+  int32_t count = (int32_t)(size / kInsExposureRecordSize);
+
+  if (ins_vector_reserve(int64_t, out_stream->allocator, &out_stream->timecodes, count) < 0 ||
+      ins_vector_reserve(double, out_stream->allocator, &out_stream->exposures, count) < 0)
+    return kInsFileErrorNoMemory;
+
+  /* records are not aligned in trailer buffer, use memcpy for each field */
+  for (int32_t i = 0; i < count; i++) {
+    const uint8_t* record = data + (size_t)i * kInsExposureRecordSize;
+    uint64_t timecode;
+    double exposure;
+
+    memcpy(&timecode, record, sizeof(timecode));
+    memcpy(&exposure, record + sizeof(timecode), sizeof(exposure));
+
+    out_stream->timecodes.a[out_stream->timecodes.n++] = (int64_t)timecode;
+    out_stream->exposures.a[out_stream->exposures.n++] = exposure;
+  }
+
+  return count;
+}
+
+int ins_decode_timestamp_entry(const uint8_t* data, uint32_t size, const InsAllocatorType* allocator, InsInt64Vector* out_timestamps) {
+  if (size % kInsTimestampRecordSize)
+    return kInsFileErrorCorrupted;
+
+  int32_t count = (int32_t)(size / kInsTimestampRecordSize);
+
+  if (ins_vector_reserve(int64_t, allocator, out_timestamps, count) < 0)
+    return kInsFileErrorNoMemory;
+  memcpy(out_timestamps->a + out_timestamps->n, data, (size_t)count * kInsTimestampRecordSize);
+  out_timestamps->n += count;
+
+  return count;
+}
+
+int ins_join_frame_exposure(
+  const InsInt64Vector* timestamps,
+  const InsExposureStreamType* exposure,
+  InsFrameExposureTableType* out_table) {
+
+  int32_t exposure_count = vector_size(&exposure->timecodes);
+  int32_t frames_count = vector_size(timestamps);
+
+  if (exposure_count == 0)
+    return kInsFileErrorNotFound;
+
+  if (ins_vector_reserve(int64_t, out_table->allocator, &out_table->timestamps, frames_count) < 0 ||
+      ins_vector_reserve(double, out_table->allocator, &out_table->exposures, frames_count) < 0)
+    return kInsFileErrorNoMemory;
+
+  const int64_t* timecodes = exposure->timecodes.a;
+  int32_t j = 0;
+
+  for (int32_t i = 0; i < frames_count; i++) {
+    int64_t ts = vector_at(timestamps, i);
+
+    /* both streams are sorted: move forward while next record is not farther from frame than current */
+    while (j + 1 < exposure_count && llabs(timecodes[j + 1] - ts) <= llabs(timecodes[j] - ts))
+      j++;
+
+    out_table->timestamps.a[out_table->timestamps.n++] = ts;
+    out_table->exposures.a[out_table->exposures.n++] = vector_at(&exposure->exposures, j);
+  }
+
+  return frames_count;
+}
+
+int ins_find_exposure_jumps(
+  const double* exposures, 
+  int32_t count, 
+  double threshold_stops, 
+  const InsAllocatorType* allocator, 
+  InsInt32Vector* out_indices) {
+
+  const double ratio = pow(2.0, fabs(threshold_stops));
+  int found = 0;
+  int32_t i = 1;
+
+#ifdef INS_STREAMS_USE_SSE2
+  const __m128d ratio2 = _mm_set1_pd(ratio);
+
+  /* compare two frames per step, branch only when any of them is jump */
+  for (; i + 1 < count; i += 2) {
+    __m128d prev = _mm_loadu_pd(exposures + i - 1);
+    __m128d cur = _mm_loadu_pd(exposures + i);
+
+    __m128d up = _mm_cmpgt_pd(cur, _mm_mul_pd(prev, ratio2));
+    __m128d down = _mm_cmpgt_pd(prev, _mm_mul_pd(cur, ratio2));
+    int mask = _mm_movemask_pd(_mm_or_pd(up, down));
+
+    if (mask) {
+      int result = ins_append_mask_indices((uint32_t)mask, i, allocator, out_indices);
+      if (result < 0)
+        return result;
+      found += result;
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    double prev = exposures[i - 1];
+    double cur = exposures[i];
+
+    if (cur > prev * ratio || prev > cur * ratio) {
+      if (ins_append_mask_indices(1, i, allocator, out_indices) < 0)
+        return kInsFileErrorNoMemory;
+      found++;
+    }
+  }
+
+  return found;
+}
@@ -0,0 +1,106 @@
+#ifndef INS_TRAILER_STREAMS_HEADER
+#define INS_TRAILER_STREAMS_HEADER
+
+#include <stdint.h>
+#include "c_vector.h"
+#include "ins_allocator.h"
+#include "ins_file_format.h"
+
+// Time-series trailer entries, record layouts (little endian, packed, see ExifTool QuickTimeStream.pl)
+// 0x300     accelerometer, gyro  (56 bytes)    uint64 timecode (ms), double accel x/y/z (g), double angular velocity x/y/z (rad/s)
+// 0x400     exposure time        (16 bytes)    uint64 timecode (ms), double exposure time (seconds)
+// 0x600     video timestamps     (8 bytes)     uint64 frame timestamp (ms)
+// 0x700     GPS                  (53 bytes)    uint32 unix time (s), uint32 and uint16 unknown, char fix ('A' - valid),
+//                                              double latitude, char 'N'/'S', double longitude, char 'E'/'W',
+//                                              double speed (m/s), double track (deg), double altitude (m)
+//
+// Timecodes of 0x400 and 0x600 use the same camera clock, both streams are sorted by time.
+
+#define kInsImuRecordSize        56
+#define kInsExposureRecordSize   16
+#define kInsTimestampRecordSize  8
+#define kInsGpsRecordSize        53
+
+typedef vector_t(int64_t) InsInt64Vector;
+typedef vector_t(double) InsDoubleVector;
+typedef vector_t(int32_t) InsInt32Vector;
+
+/** Decoded 0x400 entry, stored column-wise */
+typedef struct _InsExposureStreamType {
+  InsInt64Vector timecodes;                  /** Record timecodes, ms */
+  InsDoubleVector exposures;                 /** Exposure time, seconds */
+  const InsAllocatorType* allocator;         /** Allocator of columns */
+} InsExposureStreamType;
+
+/** Per-frame exposure table, result of join 0x600 timestamps with 0x400 exposures */
+typedef struct _InsFrameExposureTableType {
+  InsInt64Vector timestamps;                 /** Frame timestamps from 0x600 entry, ms */
+  InsDoubleVector exposures;                 /** Exposure time of frame, seconds */
+  const InsAllocatorType* allocator;         /** Allocator of columns */
+} InsFrameExposureTableType;
+
+void ins_exposure_stream_init(InsExposureStreamType* stream, const InsAllocatorType* allocator);
+void ins_exposure_stream_destroy(InsExposureStreamType* stream);
+void ins_frame_exposure_table_init(InsFrameExposureTableType* table, const InsAllocatorType* allocator);
+void ins_frame_exposure_table_destroy(InsFrameExposureTableType* table);
+
+/**
+ * \brief    Append indices of set mask bits, used by two-lane compare loops after movemask
+ * \param    mask          [in]  Compare mask, bit k set - item first_index + k matches
+ * \param    first_index   [in]  Index of item of mask bit 0
+ * \param    allocator     [in]  Allocator of indices vector
+ * \param    out_indices   [out] Function appends indices of set bits in bit order
+ * \return   Appended indices count, kInsFileErrorNoMemory
+ */
+int ins_append_mask_indices(uint32_t mask, int32_t first_index, const InsAllocatorType* allocator, InsInt32Vector* out_indices);
+
+/**
+ * \brief    Decode exposure time entry (0x400)
+ * \param    data         [in]  Entry data in trailer buffer
+ * \param    size         [in]  Entry data size
+ * \param    out_stream   [out] Function appends decoded records to stream
+ * \return   Records count - success, kInsFileErrorCorrupted - wrong entry size, kInsFileErrorNoMemory
+ */
+int ins_decode_exposure_entry(const uint8_t* data, uint32_t size, InsExposureStreamType* out_stream);
+
+/**
+ * \brief    Decode video timestamps entry (0x600)
+ * \param    data            [in]  Entry data in trailer buffer
+ * \param    size            [in]  Entry data size
+ * \param    allocator       [in]  Allocator of timestamps vector
+ * \param    out_timestamps  [out] Function appends decoded timestamps to vector
+ * \return   Records count - success, kInsFileErrorCorrupted - wrong entry size, kInsFileErrorNoMemory
+ */
+int ins_decode_timestamp_entry(const uint8_t* data, uint32_t size, const InsAllocatorType* allocator, InsInt64Vector* out_timestamps);
+
+/**
+ * \brief    Join frame timestamps with exposure records in one pass over both sorted streams.
+ *           Each frame gets exposure of the record with nearest timecode
+ * \param    timestamps   [in]  Frame timestamps (0x600)
+ * \param    exposure     [in]  Exposure records (0x400)
+ * \param    out_table    [out] Function appends one row per frame
+ * \return   Rows count - success, kInsFileErrorNotFound - no exposure records, kInsFileErrorNoMemory
+ */
+int ins_join_frame_exposure(
+  const InsInt64Vector* timestamps,
+  const InsExposureStreamType* exposure,
+  InsFrameExposureTableType* out_table);
+
+/**
+ * \brief    Find exposure discontinuities: frames where exposure changed from previous frame
+ *           by more than threshold (in EV stops, either direction)
+ * \param    exposures        [in]  Exposure times array
+ * \param    count            [in]  Array items count
+ * \param    threshold_stops  [in]  Threshold in stops, 1.0 means exposure doubled or halved
+ * \param    allocator        [in]  Allocator of indices vector
+ * \param    out_indices      [out] Function appends indices of frames after jump
+ * \return   Found discontinuities count, kInsFileErrorNoMemory
+ */
+int ins_find_exposure_jumps(
+  const double* exposures, 
+  int32_t count, 
+  double threshold_stops, 
+  const InsAllocatorType* allocator, 
+  InsInt32Vector* out_indices);
+
+#endif  // INS_TRAILER_STREAMS_HEADER
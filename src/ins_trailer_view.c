@@ -0,0 +1,98 @@
+#include <string.h>
+#include "ins_trailer_view.h"
+
+#define kInsSpecificHeaderMaxTagsCount  4  /* Usually specific header contains 4 tags and tail data */
+
+int ins_trailer_view_init(InsTrailerViewType* out_view, const uint8_t* data, uint64_t size) {
+  if (size < kInsFileMinHeaderLength)
+    return kInsFileErrorNotInsFile;
+
+  if (memcmp(data + size - kInsFileSignatureLength, kInsFileSignature, kInsFileSignatureLength))
+    return kInsFileErrorNotInsFile;
+
+  /* header is not aligned in buffer */
+  memcpy(&out_view->info, data + size - kInsFileSignatureLength - sizeof(InsFileTrailerHeaderType), sizeof(InsFileTrailerHeaderType));
+
+  if (out_view->info.trailer_len < kInsFileMinHeaderLength || out_view->info.trailer_len > size)
+    return kInsFileErrorCorrupted;
+
+  out_view->bytes = ins_byte_view(data + size - out_view->info.trailer_len, out_view->info.trailer_len);
+  return 0;
+}
+
+int ins_trailer_view_next_entry(const InsTrailerViewType* view, uint32_t* position, InsEntryViewType* out_entry) {
+  InsFileTrailerEntryHeaderType entry_hdr;
+  uint32_t trailer_len = view->bytes.size;
+
+  if (*position == trailer_len)
+    return 0;
+
+  if (*position > trailer_len || trailer_len - *position < sizeof(InsFileTrailerEntryHeaderType))
+    return kInsFileErrorCorrupted;
+
+  memcpy(&entry_hdr, view->bytes.data + trailer_len - *position - sizeof(InsFileTrailerEntryHeaderType), sizeof(entry_hdr));
+
+  uint32_t entry_end = *position + sizeof(InsFileTrailerEntryHeaderType);
+  if (entry_hdr.length > trailer_len - entry_end)
+    return kInsFileErrorCorrupted; /* entry length greater than bytes left in trailer */
+
+  *position = entry_end + entry_hdr.length;
+
+  out_entry->type = entry_hdr.type;
+  out_entry->trailer_offset = trailer_len - *position;
+  out_entry->data = ins_byte_view_sub(view->bytes, out_entry->trailer_offset, entry_hdr.length);
+
+  return 1;
+}
+
+int ins_trailer_view_find_entry(const InsTrailerViewType* view, uint16_t type, InsEntryViewType* out_entry) {
+  uint32_t position = ins_trailer_view_begin(view);
+  int result;
+
+  while ((result = ins_trailer_view_next_entry(view, &position, out_entry)) > 0) {
+    if (out_entry->type == type)
+      return 0;
+  }
+
+  return result < 0 ? result : kInsFileErrorNotFound;
+}
+
+int ins_entry_view_next_tag(const InsEntryViewType* entry, InsTagIteratorType* iterator, InsTagViewType* out_tag) {
+  uint32_t size = entry->data.size;
+
+  if (iterator->index >= kInsSpecificHeaderMaxTagsCount || iterator->position >= size)
+    return 0;
+
+  if (size - iterator->position < sizeof(InsFileSpecificDataTagHeaderType))
+    return kInsFileErrorCorrupted;
+
+  InsFileSpecificDataTagHeaderType tag_hdr;
+  memcpy(&tag_hdr, entry->data.data + iterator->position, sizeof(tag_hdr));
+
+  uint32_t data_offset = iterator->position + sizeof(InsFileSpecificDataTagHeaderType);
+  if (tag_hdr.data_size > size - data_offset)
+    return kInsFileErrorCorrupted; /* tag size greater than bytes left in header buffer */
+
+  out_tag->type_code = tag_hdr.type_code;
+  out_tag->entry_offset = iterator->position;
+  out_tag->data = ins_byte_view_sub(entry->data, data_offset, tag_hdr.data_size);
+
+  iterator->position = data_offset + tag_hdr.data_size;
+  iterator->index++;
+
+  return 1;
+}
+
+int ins_entry_view_find_tag(const InsEntryViewType* entry, uint8_t type_code, InsTagViewType* out_tag) {
+  InsTagIteratorType iterator;
+  int result;
+
+  ins_tag_iterator_begin(&iterator);
+
+  while ((result = ins_entry_view_next_tag(entry, &iterator, out_tag)) > 0) {
+    if (out_tag->type_code == type_code)
+      return 0;
+  }
+
+  return result < 0 ? result : kInsFileErrorNotFound;
+}
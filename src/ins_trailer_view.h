@@ -0,0 +1,119 @@
+#ifndef INS_TRAILER_VIEW_HEADER
+#define INS_TRAILER_VIEW_HEADER
+
+#include <stdint.h>
+#include <assert.h>
+#include "ins_file_format.h"
+
+// Views point into trailer bytes (read buffer or mapped file) and never own or copy data.
+// Accessors check bounds in debug builds only, file data is validated when views are created.
+
+#define INS_VIEW_CHECK(cond)  assert(cond)
+
+/** Bytes range view */
+typedef struct _InsByteViewType {
+  const uint8_t* data;                       /** First byte */
+  uint32_t size;                             /** Bytes count */
+} InsByteViewType;
+
+/** Full trailer view, from first entry data to signature end */
+typedef struct _InsTrailerViewType {
+  InsByteViewType bytes;                     /** Trailer bytes, size equals info.trailer_len */
+  InsFileTrailerHeaderType info;             /** Trailer information */
+} InsTrailerViewType;
+
+/** Trailer entry view */
+typedef struct _InsEntryViewType {
+  uint16_t type;                             /** Trailer entry type (0x101, 0x200, ...) */
+  uint32_t trailer_offset;                   /** Offset to entry data from trailer start */
+  InsByteViewType data;                      /** Entry data, entry header is not included */
+} InsEntryViewType;
+
+/** Specific header (0x101) tag view */
+typedef struct _InsTagViewType {
+  uint8_t type_code;                         /** Tag type code, value from enum InsFileSpecificHeaderTagTypes */
+  uint32_t entry_offset;                     /** Offset to tag header from entry data start */
+  InsByteViewType data;                      /** Tag data */
+} InsTagViewType;
+
+/** Iterator over specific header tags */
+typedef struct _InsTagIteratorType {
+  uint32_t position;                         /** Offset of next tag in entry data, tail offset after last tag */
+  int index;                                 /** Next tag index */
+} InsTagIteratorType;
+
+static inline InsByteViewType ins_byte_view(const uint8_t* data, uint32_t size) {
+  InsByteViewType view;
+  view.data = data;
+  view.size = size;
+  return view;
+}
+
+static inline InsByteViewType ins_byte_view_sub(InsByteViewType view, uint32_t offset, uint32_t size) {
+  INS_VIEW_CHECK(offset <= view.size && size <= view.size - offset);
+  return ins_byte_view(view.data + offset, size);
+}
+
+/**
+ * \brief    Create trailer view over buffer which ends with Insta360 trailer (trailer buffer or mapped file tail)
+ * \param    out_view   [out] Trailer view
+ * \param    data       [in]  Buffer, trailer must end at buffer end
+ * \param    size       [in]  Buffer size, may be greater than trailer length
+ * \return   0 - success, kInsFileErrorNotInsFile - signature not found, kInsFileErrorCorrupted - wrong trailer length
+ */
+int ins_trailer_view_init(InsTrailerViewType* out_view, const uint8_t* data, uint64_t size);
+
+/** Start entries iteration, entries are enumerated from trailer end to start */
+static inline uint32_t ins_trailer_view_begin(const InsTrailerViewType* view) {
+  (void)view;
+  return kInsFileMinHeaderLength;
+}
+
+/**
+ * \brief    Get next trailer entry
+ * \param    view          [in]      Trailer view
+ * \param    position      [in,out]  Iterator from ins_trailer_view_begin, position from trailer end
+ * \param    out_entry     [out]     Entry view
+ * \return   1 - entry found, 0 - no more entries, kInsFileErrorCorrupted - trailer corrupted
+ */
+int ins_trailer_view_next_entry(const InsTrailerViewType* view, uint32_t* position, InsEntryViewType* out_entry);
+
+/**
+ * \brief    Find first entry with given type
+ * \param    view          [in]  Trailer view
+ * \param    type          [in]  Trailer entry type
+ * \param    out_entry     [out] Entry view
+ * \return   0 - success, kInsFileErrorNotFound, kInsFileErrorCorrupted
+ */
+int ins_trailer_view_find_entry(const InsTrailerViewType* view, uint16_t type, InsEntryViewType* out_entry);
+
+/** Start specific header (0x101) tags iteration */
+static inline void ins_tag_iterator_begin(InsTagIteratorType* iterator) {
+  iterator->position = 0;
+  iterator->index = 0;
+}
+
+/**
+ * \brief    Get next specific header tag. Usually header contains 4 tags followed by tail data
+ * \param    entry         [in]      Specific header entry view
+ * \param    iterator      [in,out]  Tags iterator
+ * \param    out_tag       [out]     Tag view
+ * \return   1 - tag found, 0 - no more tags (tail starts at iterator position), kInsFileErrorCorrupted - wrong format
+ */
+int ins_entry_view_next_tag(const InsEntryViewType* entry, InsTagIteratorType* iterator, InsTagViewType* out_tag);
+
+/** Tail data of specific header, iterator must be at the end of tags */
+static inline InsByteViewType ins_entry_view_tail(const InsEntryViewType* entry, const InsTagIteratorType* iterator) {
+  return ins_byte_view_sub(entry->data, iterator->position, entry->data.size - iterator->position);
+}
+
+/**
+ * \brief    Find specific header tag by type code
+ * \param    entry         [in]  Specific header entry view
+ * \param    type_code     [in]  Tag type code
+ * \param    out_tag       [out] Tag view
+ * \return   0 - success, kInsFileErrorNotFound, kInsFileErrorCorrupted
+ */
+int ins_entry_view_find_tag(const InsEntryViewType* entry, uint8_t type_code, InsTagViewType* out_tag);
+
+#endif  // INS_TRAILER_VIEW_HEADER